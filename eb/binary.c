@@ -196,14 +196,9 @@ width=%d, height=%d)",
     if (width == 0 && height == 0) {
 	char buffer[22];
 
-	if (zio_lseek(&book->subbook_current->text_zio,
+	if (zio_pread(&book->subbook_current->text_zio,
 	    ((off_t) position->page - 1) * EB_SIZE_PAGE + position->offset,
-	    SEEK_SET) < 0) {
-	    error_code = EB_ERR_FAIL_SEEK_BINARY;
-	    goto failed;
-	}
-
-	if (zio_read(&book->subbook_current->text_zio, buffer, 22) != 22) {
+	    buffer, 22) != 22) {
 	    error_code = EB_ERR_FAIL_READ_BINARY;
 	    goto failed;
 	}
@@ -297,14 +292,6 @@ width=%d, height=%d)",
     *buffer_p++ = (data_size >> 16) & 0xff;
     *buffer_p++ = (data_size >> 24) & 0xff;
 
-    /*
-     * Seek graphic file.
-     */
-    if (zio_lseek(context->zio, context->location, SEEK_SET) < 0) {
-	error_code = EB_ERR_FAIL_SEEK_BINARY;
-	goto failed;
-    }
-
     LOG(("out: eb_set_binary_mono_graphic() = %s",
 	eb_error_string(EB_SUCCESS)));
     eb_unlock(&book->lock);
@@ -449,14 +436,9 @@ width=%d, height=%d)",
     if (width == 0 && height == 0) {
 	char buffer[22];
 
-	if (zio_lseek(&book->subbook_current->text_zio,
+	if (zio_pread(&book->subbook_current->text_zio,
 	    ((off_t) position->page - 1) * EB_SIZE_PAGE + position->offset,
-	    SEEK_SET) < 0) {
-	    error_code = EB_ERR_FAIL_SEEK_BINARY;
-	    goto failed;
-	}
-
-	if (zio_read(&book->subbook_current->text_zio, buffer, 22) != 22) {
+	    buffer, 22) != 22) {
 	    error_code = EB_ERR_FAIL_READ_BINARY;
 	    goto failed;
 	}
@@ -546,14 +528,6 @@ width=%d, height=%d)",
     *buffer_p++ = (data_size >> 16) & 0xff;
     *buffer_p++ = (data_size >> 24) & 0xff;
 
-    /*
-     * Seek graphic file.
-     */
-    if (zio_lseek(context->zio, context->location, SEEK_SET) < 0) {
-	error_code = EB_ERR_FAIL_SEEK_BINARY;
-	goto failed;
-    }
-
     LOG(("out: eb_set_binary_gray_graphic() = %s",
 	eb_error_string(EB_SUCCESS)));
     eb_unlock(&book->lock);
@@ -656,33 +630,28 @@ end_position={%d,%d})",
      *                = 36 + data
      * data-part-size = length(data)
      */
-    if (zio_lseek(context->zio, context->location, SEEK_SET) < 0) {
-	error_code = EB_ERR_FAIL_SEEK_BINARY;
-	goto failed;
-    }
-    if (zio_read(context->zio, temporary_buffer, 4) != 4) {
+    if (zio_pread(context->zio, context->location, temporary_buffer, 4)
+	!= 4) {
 	error_code = EB_ERR_FAIL_READ_BINARY;
 	goto failed;
     }
 
     if (memcmp(temporary_buffer, "fmt ", 4) == 0) {
 	memcpy(context->cache_buffer + 12, temporary_buffer, 4);
-	if (zio_read(context->zio, context->cache_buffer + 16, 28) != 28) {
+	if (zio_pread(context->zio, context->location + 4,
+	    context->cache_buffer + 16, 28) != 28) {
 	    error_code = EB_ERR_FAIL_READ_BINARY;
 	    goto failed;
 	}
+	context->location += 32;
 	if (context->size >= 32)
 	    context->size -= 32;
 	else
 	    context->size = 0;
     } else {
-	if (zio_lseek(context->zio,
+	if (zio_pread(context->zio,
 	    ((off_t) book->subbook_current->sound.start_page - 1)
-		* EB_SIZE_PAGE + 32, SEEK_SET) < 0) {
-	    error_code = EB_ERR_FAIL_SEEK_BINARY;
-	    goto failed;
-	}
-	if (zio_read(context->zio, context->cache_buffer + 12, 28) != 28) {
+		* EB_SIZE_PAGE + 32, context->cache_buffer + 12, 28) != 28) {
 	    error_code = EB_ERR_FAIL_SEEK_BINARY;
 	    goto failed;
 	}
@@ -695,15 +664,6 @@ end_position={%d,%d})",
 	    = (context->size >> 16) & 0xff;
 	*(unsigned char *)(context->cache_buffer + 43)
 	    = (context->size >> 24) & 0xff;
-
-
-	/*
-	 * Seek sound file, again.
-	 */
-	if (zio_lseek(context->zio, context->location, SEEK_SET) < 0) {
-	    error_code = EB_ERR_FAIL_SEEK_BINARY;
-	    goto failed;
-	}
     }
     context->cache_length = 44;
 
@@ -793,20 +753,12 @@ eb_set_binary_color_graphic(EB_Book *book, const EB_Position *position)
     context->cache_length = 0;
     context->cache_offset = 0;
 
-    /*
-     * Seek graphic file.
-     */
-    if (zio_lseek(context->zio, context->location, SEEK_SET) < 0) {
-	error_code = EB_ERR_FAIL_SEEK_BINARY;
-	goto failed;
-    }
-
     /*
      * Read header of the graphic data.
      * Note that EB* JPEG file lacks the header.
      */
-    if (zio_read(context->zio, buffer, EB_COLOR_GRAPHIC_HEADER_LENGTH)
-	!= EB_COLOR_GRAPHIC_HEADER_LENGTH) {
+    if (zio_pread(context->zio, context->location, buffer,
+	EB_COLOR_GRAPHIC_HEADER_LENGTH) != EB_COLOR_GRAPHIC_HEADER_LENGTH) {
 	error_code = EB_ERR_FAIL_READ_BINARY;
 	goto failed;
     }
@@ -816,10 +768,6 @@ eb_set_binary_color_graphic(EB_Book *book, const EB_Position *position)
 	context->location += EB_COLOR_GRAPHIC_HEADER_LENGTH;
     } else {
 	context->size = 0;
-	if (zio_lseek(context->zio, context->location, SEEK_SET) < 0) {
-	    error_code = EB_ERR_FAIL_SEEK_BINARY;
-	    goto failed;
-	}
     }
 
     LOG(("out: eb_set_binary_color_graphic() = %s",
@@ -1034,7 +982,8 @@ eb_read_binary_generic(EB_Book *book, size_t binary_max_length,
     else
 	read_length = context->size - context->offset;
 
-    read_result = zio_read(context->zio, binary_p, read_length);
+    read_result = zio_pread(context->zio, context->location + context->offset,
+	binary_p, read_length);
     if ((0 < context->size && read_result != read_length) || read_result < 0) {
 	error_code = EB_ERR_FAIL_READ_BINARY;
 	goto failed;
@@ -1203,15 +1152,12 @@ eb_read_binary_mono_graphic(EB_Book *book, size_t binary_max_length,
 
 	/*
 	 * Read binary data.
+	 * Lines are stored from top to bottom, but BMP requires them from
+	 * bottom to top.
 	 */
-	if (context->offset != 0
-	    && context->offset % line_length == 0
-	    && zio_lseek(context->zio, (off_t) line_length * -2, SEEK_CUR)
-	    < 0) {
-	    error_code = EB_ERR_FAIL_SEEK_BINARY;
-	    goto failed;
-	}
-	if (zio_read(context->zio, (char *)binary_p, read_length)
+	if (zio_pread(context->zio, context->location
+	    - (off_t) (context->offset / line_length) * line_length
+	    + context->offset % line_length, (char *)binary_p, read_length)
 	    != read_length) {
 	    error_code = EB_ERR_FAIL_READ_BINARY;
 	    goto failed;
@@ -1334,15 +1280,12 @@ eb_read_binary_gray_graphic(EB_Book *book, size_t binary_max_length,
 
 	/*
 	 * Read binary data.
+	 * Lines are stored from top to bottom, but BMP requires them from
+	 * bottom to top.
 	 */
-	if (context->offset != 0
-	    && context->offset % line_length == 0
-	    && zio_lseek(context->zio, (off_t) line_length * -2, SEEK_CUR)
-	    < 0) {
-		error_code = EB_ERR_FAIL_SEEK_BINARY;
-		goto failed;
-	}
-	if (zio_read(context->zio, (char *)binary_p, read_length)
+	if (zio_pread(context->zio, context->location
+	    - (off_t) (context->offset / line_length) * line_length
+	    + context->offset % line_length, (char *)binary_p, read_length)
 	    != read_length) {
 	    error_code = EB_ERR_FAIL_READ_BINARY;
 	    goto failed;
@@ -58,6 +58,7 @@ static EB_Error_Code eb_load_catalog_epwing(EB_Book *book,
     const char *catalog_path);
 static Zio_Code eb_get_hint_zio_code(int catalog_hint_value);
 static void eb_load_language(EB_Book *book);
+static void eb_add_io_stats(Zio *zio, Zio_Stats *stats);
 
 
 /*
@@ -75,6 +76,8 @@ eb_initialize_book(EB_Book *book)
     book->path_length = 0;
     book->subbooks = NULL;
     book->subbook_current = NULL;
+    book->materialize_mode = 0;
+    book->utf8_mode = 0;
 #ifdef ENABLE_EBNET
     book->ebnet_file = -1;
 #endif
@@ -1001,3 +1004,88 @@ eb_character_code(EB_Book *book, EB_Character_Code *character_code)
 }
 
 
+/*
+ * Add I/O statistics of `zio' to `stats'.
+ */
+static void
+eb_add_io_stats(Zio *zio, Zio_Stats *stats)
+{
+    Zio_Stats zio_stats;
+
+    zio_get_stats(zio, &zio_stats);
+    stats->raw_read_bytes       += zio_stats.raw_read_bytes;
+    stats->raw_read_count       += zio_stats.raw_read_count;
+    stats->raw_read_nanoseconds += zio_stats.raw_read_nanoseconds;
+    stats->ebzip_slice_count    += zio_stats.ebzip_slice_count;
+    stats->ebzip2_slice_count   += zio_stats.ebzip2_slice_count;
+    stats->epwing_slice_count   += zio_stats.epwing_slice_count;
+    stats->epwing6_slice_count  += zio_stats.epwing6_slice_count;
+    stats->sebxa_slice_count    += zio_stats.sebxa_slice_count;
+    stats->decode_nanoseconds   += zio_stats.decode_nanoseconds;
+    stats->cache_hit_count      += zio_stats.cache_hit_count;
+    stats->cache_miss_count     += zio_stats.cache_miss_count;
+    stats->shared_cache_hit_count += zio_stats.shared_cache_hit_count;
+    stats->disk_cache_hit_count += zio_stats.disk_cache_hit_count;
+}
+
+
+/*
+ * Get I/O statistics of files in `book'.
+ * If `book' is NULL, statistics of all books are returned.
+ */
+EB_Error_Code
+eb_get_io_stats(EB_Book *book, Zio_Stats *stats)
+{
+    EB_Error_Code error_code;
+    EB_Subbook *subbook;
+    int i, j;
+
+    memset(stats, 0, sizeof(Zio_Stats));
+
+    if (book == NULL) {
+	LOG(("in+out: eb_get_io_stats(book=NULL)"));
+	zio_get_stats(NULL, stats);
+	return EB_SUCCESS;
+    }
+
+    eb_lock(&book->lock);
+    LOG(("in: eb_get_io_stats(book=%d)", (int)book->code));
+
+    /*
+     * Check for the current status.
+     */
+    if (book->path == NULL) {
+	error_code = EB_ERR_UNBOUND_BOOK;
+	goto failed;
+    }
+
+    /*
+     * Sum up statistics of all files in the book.
+     */
+    for (i = 0, subbook = book->subbooks; i < book->subbook_count;
+	 i++, subbook++) {
+	eb_add_io_stats(&subbook->text_zio, stats);
+	eb_add_io_stats(&subbook->graphic_zio, stats);
+	eb_add_io_stats(&subbook->sound_zio, stats);
+	eb_add_io_stats(&subbook->movie_zio, stats);
+	for (j = 0; j < EB_MAX_FONTS; j++) {
+	    eb_add_io_stats(&subbook->narrow_fonts[j].zio, stats);
+	    eb_add_io_stats(&subbook->wide_fonts[j].zio, stats);
+	}
+    }
+
+    LOG(("out: eb_get_io_stats() = %s", eb_error_string(EB_SUCCESS)));
+    eb_unlock(&book->lock);
+
+    return EB_SUCCESS;
+
+    /*
+     * An error occurs...
+     */
+  failed:
+    LOG(("out: eb_get_io_stats() = %s", eb_error_string(error_code)));
+    eb_unlock(&book->lock);
+    return error_code;
+}
+
+
@@ -63,6 +63,28 @@ extern "C" {
 #define EB_CHARCODE_JISX0208_GB2312	3
 #define EB_CHARCODE_INVALID		-1
 
+/*
+ * Search methods.
+ */
+#define EB_SEARCH_EXACTWORD		0
+#define EB_SEARCH_WORD			1
+#define EB_SEARCH_ENDWORD		2
+#define EB_SEARCH_KEYWORD		3
+#define EB_SEARCH_MULTI			4
+#define EB_SEARCH_CROSS			5
+#define EB_SEARCH_NONE			-1
+
+/*
+ * Index codes for eb_foreach_index_entry().
+ */
+#define EB_INDEX_WORD_ALPHABET		0
+#define EB_INDEX_WORD_ASIS		1
+#define EB_INDEX_WORD_KANA		2
+#define EB_INDEX_ENDWORD_ALPHABET	3
+#define EB_INDEX_ENDWORD_ASIS		4
+#define EB_INDEX_ENDWORD_KANA		5
+#define EB_INDEX_INVALID		-1
+
 /*
  * Special book ID for cache to represent "no cache data for any book".
  */
@@ -127,6 +149,11 @@ extern "C" {
  */
 #define EB_MAX_MULTI_LABEL_LENGTH	30
 
+/*
+ * Number of KANA characters in a row of JIS X 0208. (0x21 ... 0x76)
+ */
+#define EB_SIZE_KANA_TABLE		86
+
 /*
  * Maximum length of alternation text string for a private character.
  */
@@ -182,6 +209,13 @@ extern "C" {
  */
 #define EB_NUMBER_OF_SEARCH_CONTEXTS	EB_MAX_MULTI_ENTRIES
 
+/*
+ * The size of the hash table of intermediate index pages, and
+ * the maximum number of the pages kept in memory per subbook.
+ */
+#define EB_INDEX_PAGE_HASH_SIZE		64
+#define EB_MAX_INDEX_PAGES		256
+
 /*
  * Types for various codes.
  */
@@ -195,6 +229,7 @@ typedef int EB_Font_Code;
 typedef int EB_Word_Code;
 typedef int EB_Subbook_Code;
 typedef int EB_Index_Style_Code;
+typedef int EB_Index_Code;
 typedef int EB_Search_Code;
 typedef int EB_Text_Code;
 typedef int EB_Text_Status_Code;
@@ -215,6 +250,7 @@ typedef struct EB_Appendix_Struct          EB_Appendix;
 typedef struct EB_Font_Struct              EB_Font;
 typedef struct EB_Search_Struct            EB_Search;
 typedef struct EB_Multi_Search_Struct      EB_Multi_Search;
+typedef struct EB_Index_Page_Struct        EB_Index_Page;
 typedef struct EB_Subbook_Struct           EB_Subbook;
 typedef struct EB_Text_Context_Struct      EB_Text_Context;
 typedef struct EB_Binary_Context_Struct    EB_Binary_Context;
@@ -225,6 +261,8 @@ typedef struct EB_Hook_Struct              EB_Hook;
 typedef struct EB_Hookset_Struct           EB_Hookset;
 typedef struct EB_BookList_Entry           EB_BookList_Entry;
 typedef struct EB_BookList                 EB_BookList;
+typedef struct EB_Search_Source_Struct     EB_Search_Source;
+typedef struct EB_Source_Hit_Struct        EB_Source_Hit;
 
 /*
  * Pthreads lock.
@@ -482,6 +520,13 @@ struct EB_Search_Struct {
     EB_Index_Style_Code p_sound;
     EB_Index_Style_Code space;
 
+    /*
+     * Canonicalization compiled from the index style flags.
+     * `fix_kana_table' maps the second byte of a KANA character.
+     */
+    int fix_flags;
+    unsigned char fix_kana_table[EB_SIZE_KANA_TABLE];
+
     /*
      * Label. (for an entry in multi search)
      */
@@ -513,6 +558,34 @@ struct EB_Multi_Search_Struct {
     EB_Search entries[EB_MAX_MULTI_ENTRIES];
 };
 
+/*
+ * An intermediate index page kept in memory.
+ */
+struct EB_Index_Page_Struct {
+    /*
+     * Page number.
+     */
+    int page;
+
+    /*
+     * Page ID, length of an entry, and the number of entries recorded
+     * in the page header.
+     */
+    int page_id;
+    int entry_length;
+    int entry_count;
+
+    /*
+     * Entries (pairs of a key and a page number) of the page.
+     */
+    char *entries;
+
+    /*
+     * Next page in the hash chain.
+     */
+    EB_Index_Page *next;
+};
+
 /*
  * A subbook in a book.
  */
@@ -618,6 +691,12 @@ struct EB_Subbook_Struct {
      */
     EB_Multi_Search multis[EB_MAX_MULTI_SEARCHES];
 
+    /*
+     * Intermediate index pages read so far, and the number of them.
+     */
+    EB_Index_Page *index_pages[EB_INDEX_PAGE_HASH_SIZE];
+    int index_page_count;
+
     /*
      * Font list.
      */
@@ -857,6 +936,23 @@ struct EB_Search_Context_Struct {
      * Current heading position (for keyword search).
      */
     EB_Position keyword_heading;
+
+    /*
+     * Cache buffer for the current page, and the page in the buffer.
+     * (`cache_page' is 0 if the buffer has no page.)
+     */
+    char cache_buffer[EB_SIZE_PAGE];
+    int cache_page;
+
+    /*
+     * Buffer of hits read from the index (for keyword, cross and multi
+     * search).  It has `hit_count' hits and room for `max_hit_count'
+     * hits.  Hits before `hit_index' have been consumed already.
+     */
+    EB_Hit *hits;
+    int hit_count;
+    int hit_index;
+    int max_hit_count;
 };
 
 /*
@@ -903,6 +999,18 @@ struct EB_Book_Struct {
      */
     EB_Subbook *subbook_current;
 
+    /*
+     * Whether the text file of the current subbook is materialized
+     * in memory.  (See eb_set_materialize_mode().)
+     */
+    int materialize_mode;
+
+    /*
+     * Whether text is written in UTF-8 by eb_read_text() and
+     * eb_read_heading().  (See eb_set_utf8_mode().)
+     */
+    int utf8_mode;
+
     /*
      * Context parameters for text reading.
      */
@@ -1030,6 +1138,39 @@ struct EB_BookList {
 #endif
 };
 
+/*
+ * A source of a federated search.  (See eb_search_federated().)
+ */
+struct EB_Search_Source_Struct {
+    /*
+     * Book and subbook to search.
+     */
+    EB_Book *book;
+    EB_Subbook_Code subbook_code;
+
+    /*
+     * Result of the search of the source, and the number of hits of
+     * the source put into the merged hit list.
+     */
+    EB_Error_Code error_code;
+    int hit_count;
+};
+
+/*
+ * A hit of a federated search, tagged with the index of its source.
+ */
+struct EB_Source_Hit_Struct {
+    /*
+     * Index of the source in the source list.
+     */
+    int source_index;
+
+    /*
+     * Heading and text locations.
+     */
+    EB_Hit hit;
+};
+
 /* for backward compatibility */
 #define EB_Multi_Entry_Code int
 
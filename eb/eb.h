@@ -53,6 +53,7 @@ EB_Error_Code eb_path(EB_Book *book, char *path);
 EB_Error_Code eb_disc_type(EB_Book *book, EB_Disc_Code *disc_code);
 EB_Error_Code eb_character_code(EB_Book *book,
     EB_Character_Code *character_code);
+EB_Error_Code eb_get_io_stats(EB_Book *book, Zio_Stats *stats);
 
 /* copyright.h */
 int eb_have_copyright(EB_Book *book);
@@ -70,10 +71,18 @@ void eb_finalize_library(void);
 /* endword.c */
 int eb_have_endword_search(EB_Book *book);
 EB_Error_Code eb_search_endword(EB_Book *book, const char *input_word);
+EB_Error_Code eb_search_endword_utf8(EB_Book *book, const char *input_word);
 
 /* exactword.c */
 int eb_have_exactword_search(EB_Book *book);
 EB_Error_Code eb_search_exactword(EB_Book *book, const char *input_word);
+EB_Error_Code eb_search_exactword_utf8(EB_Book *book, const char *input_word);
+
+/* federated.c */
+EB_Error_Code eb_search_federated(EB_Search_Source *sources,
+    int source_count, EB_Search_Code search_code, const char *input_word,
+    int thread_count, int timeout, int max_hit_count,
+    EB_Source_Hit *hit_list, int *hit_count);
 
 /* graphic.c */
 int eb_have_graphic_search(EB_Book *book);
@@ -125,6 +134,22 @@ EB_Error_Code eb_text(EB_Book *book, EB_Position *position);
 /* search.c */
 EB_Error_Code eb_hit_list(EB_Book *book, int max_hit_count, EB_Hit *hit_list,
     int *hit_count);
+EB_Error_Code eb_search_exactword_batch(EB_Book *book,
+    const char * const input_words[], int word_count, int max_hit_count,
+    EB_Hit *hit_lists, int *hit_counts);
+EB_Error_Code eb_search_word_batch(EB_Book *book,
+    const char * const input_words[], int word_count, int max_hit_count,
+    EB_Hit *hit_lists, int *hit_counts);
+EB_Error_Code eb_search_endword_batch(EB_Book *book,
+    const char * const input_words[], int word_count, int max_hit_count,
+    EB_Hit *hit_lists, int *hit_counts);
+EB_Error_Code eb_enumerate_prefix(EB_Book *book, EB_Search_Code search_code,
+    const char *input_word, int max_entry_count,
+    int (*function)(EB_Book *book, void *container, const char *key,
+    size_t key_length, const EB_Hit *hit), void *container);
+EB_Error_Code eb_foreach_index_entry(EB_Book *book, EB_Index_Code index_code,
+    int (*function)(EB_Book *book, void *container, const char *key,
+    size_t key_length, const EB_Hit *hit), void *container);
 
 /* subbook.c */
 EB_Error_Code eb_load_all_subbooks(EB_Book *book);
@@ -139,10 +164,12 @@ EB_Error_Code eb_subbook_directory2(EB_Book *book,
     EB_Subbook_Code subbook_code, char *directory);
 EB_Error_Code eb_set_subbook(EB_Book *book, EB_Subbook_Code subbook_code);
 void eb_unset_subbook(EB_Book *book);
+EB_Error_Code eb_set_materialize_mode(EB_Book *book, int flag);
 
 /* word.c */
 int eb_have_word_search(EB_Book *book);
 EB_Error_Code eb_search_word(EB_Book *book, const char *input_word);
+EB_Error_Code eb_search_word_utf8(EB_Book *book, const char *input_word);
 
 /* for backward compatibility */
 #define eb_suspend eb_unset_subbook
@@ -31,6 +31,12 @@
 #include "error.h"
 #include "build-post.h"
 
+/*
+ * Unexported functions.
+ */
+static EB_Error_Code eb_search_endword_internal(EB_Book *book,
+    const char *input_word, int input_encoding);
+
 /*
  * Examine whether the current subbook in `book' supports `ENDWORD SEARCH'
  * or not.
@@ -71,40 +77,26 @@ eb_have_endword_search(EB_Book *book)
 
 
 /*
- * Endword search.
+ * Set the search context `context' for endword search of `input_word'
+ * encoded in `input_encoding' in the current subbook.  A fixed word,
+ * a canonicalized word, the start page of the index and comparison
+ * functions are set to `context'.
  */
 EB_Error_Code
-eb_search_endword(EB_Book *book, const char *input_word)
+eb_set_endword_context(EB_Book *book, EB_Search_Context *context,
+    const char *input_word, int input_encoding)
 {
     EB_Error_Code error_code;
     EB_Word_Code word_code;
-    EB_Search_Context *context;
-
-    eb_lock(&book->lock);
-    LOG(("in: eb_search_endword(book=%d, input_word=%s)", (int)book->code,
-	eb_quoted_string(input_word)));
-
-    /*
-     * Current subbook must have been set.
-     */
-    if (book->subbook_current == NULL) {
-	error_code = EB_ERR_NO_CUR_SUB;
-	goto failed;
-    }
 
-    /*
-     * Initialize search context.
-     */
-    eb_reset_search_contexts(book);
-    context = book->search_contexts;
     context->code = EB_SEARCH_ENDWORD;
 
     /*
      * Make a fixed word and a canonicalized word to search from
      * `input_word'.
      */
-    error_code = eb_set_endword(book, input_word, context->word,
-	context->canonicalized_word, &word_code);
+    error_code = eb_set_endword(book, input_word, input_encoding,
+	context->word, context->canonicalized_word, &word_code);
     if (error_code != EB_SUCCESS)
 	goto failed;
 
@@ -166,6 +158,88 @@ eb_search_endword(EB_Book *book, const char *input_word)
 	context->compare_group  = eb_match_word_kana_group;
     }
 
+    return EB_SUCCESS;
+
+    /*
+     * An error occurs...
+     */
+  failed:
+    return error_code;
+}
+
+
+/*
+ * Endword search.
+ */
+EB_Error_Code
+eb_search_endword(EB_Book *book, const char *input_word)
+{
+    EB_Error_Code error_code;
+
+    eb_lock(&book->lock);
+    LOG(("in: eb_search_endword(book=%d, input_word=%s)", (int)book->code,
+	eb_quoted_string(input_word)));
+
+    error_code = eb_search_endword_internal(book, input_word, EB_INPUT_NATIVE);
+
+    LOG(("out: eb_search_endword() = %s", eb_error_string(error_code)));
+    eb_unlock(&book->lock);
+    return error_code;
+}
+
+
+/*
+ * Endword search of `input_word' in UTF-8.
+ */
+EB_Error_Code
+eb_search_endword_utf8(EB_Book *book, const char *input_word)
+{
+    EB_Error_Code error_code;
+
+    eb_lock(&book->lock);
+    LOG(("in: eb_search_endword_utf8(book=%d, input_word=%s)",
+	(int)book->code, eb_quoted_string(input_word)));
+
+    error_code = eb_search_endword_internal(book, input_word, EB_INPUT_UTF8);
+
+    LOG(("out: eb_search_endword_utf8() = %s", eb_error_string(error_code)));
+    eb_unlock(&book->lock);
+    return error_code;
+}
+
+
+/*
+ * Endword search of `input_word' encoded in `input_encoding'.
+ */
+static EB_Error_Code
+eb_search_endword_internal(EB_Book *book, const char *input_word,
+    int input_encoding)
+{
+    EB_Error_Code error_code;
+    EB_Search_Context *context;
+
+    /*
+     * Current subbook must have been set.
+     */
+    if (book->subbook_current == NULL) {
+	error_code = EB_ERR_NO_CUR_SUB;
+	goto failed;
+    }
+
+    /*
+     * Initialize search context.
+     */
+    eb_reset_search_contexts(book);
+    context = book->search_contexts;
+
+    /*
+     * Set the word, the index page and comparison functions.
+     */
+    error_code = eb_set_endword_context(book, context, input_word,
+	input_encoding);
+    if (error_code != EB_SUCCESS)
+	goto failed;
+
     /*
      * Pre-search.
      */
@@ -173,9 +247,6 @@ eb_search_endword(EB_Book *book, const char *input_word)
     if (error_code != EB_SUCCESS)
 	goto failed;
 
-    LOG(("out: eb_search_endword() = %s", eb_error_string(EB_SUCCESS)));
-    eb_unlock(&book->lock);
-
     return EB_SUCCESS;
 
     /*
@@ -183,8 +254,6 @@ eb_search_endword(EB_Book *book, const char *input_word)
      */
   failed:
     eb_reset_search_contexts(book);
-    LOG(("out: eb_search_endword() = %s", eb_error_string(error_code)));
-    eb_unlock(&book->lock);
     return error_code;
 }
 
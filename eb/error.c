@@ -138,6 +138,7 @@ static const char * const error_strings[] = {
     "EB_ERR_EBNET_NO_PERMISSION",
     "EB_ERR_UNBOUND_BOOKLIST",
     "EB_ERR_NO_SUCH_BOOK",
+    "EB_ERR_TIMED_OUT",
 
     NULL
 };
@@ -259,6 +260,7 @@ static const char * const error_messages[] = {
     N_("no access permission"),
     N_("booklist not bound"),
     N_("no such book"),
+    N_("search timed out"),
 
     NULL
 };
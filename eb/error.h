@@ -124,12 +124,13 @@ extern "C" {
 #define EB_ERR_EBNET_NO_PERMISSION	66
 #define EB_ERR_UNBOUND_BOOKLIST		67
 #define EB_ERR_NO_SUCH_BOOK		68
+#define EB_ERR_TIMED_OUT		69
 
 
 /*
  * The number of error codes.
  */
-#define EB_NUMBER_OF_ERRORS		69
+#define EB_NUMBER_OF_ERRORS		70
 
 /*
  * The maximum length of an error message.
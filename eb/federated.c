@@ -0,0 +1,401 @@
+/*
+ * Copyright (c) 2026  The EB Library contributors
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the project nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE PROJECT AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "build-pre.h"
+#include "eb.h"
+#include "error.h"
+#include "build-post.h"
+
+/*
+ * The default and maximum number of threads of a federated search.
+ */
+#define EB_DEFAULT_FEDERATED_THREADS	8
+#define EB_MAX_FEDERATED_THREADS	64
+
+/*
+ * A federated search shared among worker threads.
+ */
+typedef struct {
+    /*
+     * Sources, search method and word to search.
+     */
+    EB_Search_Source *sources;
+    int source_count;
+    EB_Search_Code search_code;
+    const char *input_word;
+
+    /*
+     * Hit lists of the sources.  Hits of the i-th source are put
+     * into `hit_lists + i * max_hit_count'.
+     */
+    int max_hit_count;
+    EB_Hit *hit_lists;
+
+    /*
+     * Jobs.  A job is a list of indexes of sources which have the same
+     * book, since a book can search only its current subbook at a
+     * time.  The j-th job is `job_sources[job_starts[j]]' ...
+     * `job_sources[job_starts[j + 1] - 1]'.
+     */
+    int *job_sources;
+    int *job_starts;
+    int job_count;
+
+    /*
+     * The next job to be taken by a worker.
+     */
+    int next_job;
+
+    /*
+     * Deadline in milliseconds of eb_federated_clock(), which is the
+     * monotonic clock if available.  (0 means no deadline.)
+     */
+    long long deadline;
+
+    /*
+     * Lock for `next_job'.
+     */
+#ifdef ENABLE_PTHREAD
+    pthread_mutex_t mutex;
+#endif
+} EB_Federated_Search;
+
+/*
+ * Unexported functions.
+ */
+static void *eb_federated_worker(void *argument);
+static void eb_search_source(EB_Federated_Search *federated,
+    int source_index);
+static long long eb_federated_clock(void);
+static int eb_federated_is_expired(EB_Federated_Search *federated);
+
+
+/*
+ * Search `input_word' in `source_count' sources at once, by exactword,
+ * word or endword search.  Sources are searched by at most `thread_count'
+ * threads in parallel.  (If `thread_count' is 0, the default number of
+ * threads is used.)
+ *
+ * If `timeout' is greater than 0, a source is not searched after
+ * `timeout' milliseconds have passed, and its error code is set to
+ * EB_ERR_TIMED_OUT.  A search already running is not interrupted,
+ * but it stops reading more hits.
+ *
+ * Hits of the sources are merged into `hit_list' in the order of
+ * sources, up to `max_hit_count' hits, and each hit is tagged with the
+ * index of its source.  `error_code' and `hit_count' of each source are
+ * set.  The current subbook of each book is changed, and a book must
+ * not be used by other threads during the search.
+ */
+EB_Error_Code
+eb_search_federated(EB_Search_Source *sources, int source_count,
+    EB_Search_Code search_code, const char *input_word, int thread_count,
+    int timeout, int max_hit_count, EB_Source_Hit *hit_list, int *hit_count)
+{
+    EB_Error_Code error_code;
+    EB_Federated_Search federated;
+    EB_Source_Hit *source_hit;
+    EB_Hit *hit;
+    int job_source_count;
+    int i, j;
+#ifdef ENABLE_PTHREAD
+    pthread_t threads[EB_MAX_FEDERATED_THREADS];
+    int created_thread_count = 0;
+#endif
+
+    LOG(("in: eb_search_federated(source_count=%d, search_code=%d, \
+input_word=%s, thread_count=%d, timeout=%d, max_hit_count=%d)",
+	source_count, (int)search_code, eb_quoted_string(input_word),
+	thread_count, timeout, max_hit_count));
+
+    federated.hit_lists = NULL;
+    federated.job_sources = NULL;
+    federated.job_starts = NULL;
+    *hit_count = 0;
+
+    for (i = 0; i < source_count; i++) {
+	sources[i].error_code = EB_SUCCESS;
+	sources[i].hit_count = 0;
+    }
+
+    if (search_code != EB_SEARCH_EXACTWORD
+	&& search_code != EB_SEARCH_WORD
+	&& search_code != EB_SEARCH_ENDWORD) {
+	error_code = EB_ERR_NO_SUCH_SEARCH;
+	goto failed;
+    }
+    if (source_count <= 0 || max_hit_count <= 0)
+	goto succeeded;
+
+    /*
+     * Allocate memories.
+     */
+    federated.sources = sources;
+    federated.source_count = source_count;
+    federated.search_code = search_code;
+    federated.input_word = input_word;
+    federated.max_hit_count = max_hit_count;
+    federated.hit_lists = (EB_Hit *) malloc(sizeof(EB_Hit)
+	* source_count * max_hit_count);
+    federated.job_sources = (int *) malloc(sizeof(int) * source_count);
+    federated.job_starts = (int *) malloc(sizeof(int) * (source_count + 1));
+    if (federated.hit_lists == NULL || federated.job_sources == NULL
+	|| federated.job_starts == NULL) {
+	error_code = EB_ERR_MEMORY_EXHAUSTED;
+	goto failed;
+    }
+
+    /*
+     * Make jobs.  Sources which have the same book are put into the
+     * same job.  (`hit_count' is used as a mark of sources put into
+     * a job here.)
+     */
+    federated.job_count = 0;
+    job_source_count = 0;
+    for (i = 0; i < source_count; i++) {
+	if (sources[i].hit_count != 0)
+	    continue;
+	federated.job_starts[federated.job_count++] = job_source_count;
+	for (j = i; j < source_count; j++) {
+	    if (sources[j].book == sources[i].book) {
+		federated.job_sources[job_source_count++] = j;
+		sources[j].hit_count = 1;
+	    }
+	}
+    }
+    federated.job_starts[federated.job_count] = job_source_count;
+    for (i = 0; i < source_count; i++)
+	sources[i].hit_count = 0;
+
+    federated.next_job = 0;
+    if (0 < timeout)
+	federated.deadline = eb_federated_clock() + timeout;
+    else
+	federated.deadline = 0;
+
+    /*
+     * Run workers.  This thread is also a worker.
+     */
+#ifdef ENABLE_PTHREAD
+    if (thread_count <= 0)
+	thread_count = EB_DEFAULT_FEDERATED_THREADS;
+    if (EB_MAX_FEDERATED_THREADS < thread_count)
+	thread_count = EB_MAX_FEDERATED_THREADS;
+    if (federated.job_count < thread_count)
+	thread_count = federated.job_count;
+
+    pthread_mutex_init(&federated.mutex, NULL);
+    for (i = 1; i < thread_count; i++) {
+	if (pthread_create(&threads[created_thread_count], NULL,
+	    eb_federated_worker, &federated) != 0)
+	    break;
+	created_thread_count++;
+    }
+    eb_federated_worker(&federated);
+    for (i = 0; i < created_thread_count; i++)
+	pthread_join(threads[i], NULL);
+    pthread_mutex_destroy(&federated.mutex);
+#else
+    eb_federated_worker(&federated);
+#endif
+
+    /*
+     * Merge hit lists.
+     */
+    source_hit = hit_list;
+    for (i = 0; i < source_count; i++) {
+	hit = federated.hit_lists + (size_t) i * max_hit_count;
+	for (j = 0; j < sources[i].hit_count; j++) {
+	    if (max_hit_count <= *hit_count)
+		break;
+	    source_hit->source_index = i;
+	    memcpy(&source_hit->hit, hit + j, sizeof(EB_Hit));
+	    source_hit++;
+	    *hit_count += 1;
+	}
+	sources[i].hit_count = j;
+    }
+
+    /*
+     * Dispose memories.
+     */
+    free(federated.hit_lists);
+    free(federated.job_sources);
+    free(federated.job_starts);
+
+  succeeded:
+    LOG(("out: eb_search_federated(hit_count=%d) = %s", *hit_count,
+	eb_error_string(EB_SUCCESS)));
+    return EB_SUCCESS;
+
+    /*
+     * An error occurs...
+     */
+  failed:
+    if (federated.hit_lists != NULL)
+	free(federated.hit_lists);
+    if (federated.job_sources != NULL)
+	free(federated.job_sources);
+    if (federated.job_starts != NULL)
+	free(federated.job_starts);
+    *hit_count = 0;
+    LOG(("out: eb_search_federated() = %s", eb_error_string(error_code)));
+    return error_code;
+}
+
+
+/*
+ * Worker of a federated search.
+ * It takes jobs one by one, and searches sources of the jobs.
+ */
+static void *
+eb_federated_worker(void *argument)
+{
+    EB_Federated_Search *federated = (EB_Federated_Search *) argument;
+    int job;
+    int i;
+
+    for (;;) {
+	pthread_mutex_lock(&federated->mutex);
+	job = federated->next_job;
+	if (job < federated->job_count)
+	    federated->next_job++;
+	pthread_mutex_unlock(&federated->mutex);
+
+	if (federated->job_count <= job)
+	    break;
+	for (i = federated->job_starts[job];
+	     i < federated->job_starts[job + 1]; i++)
+	    eb_search_source(federated, federated->job_sources[i]);
+    }
+
+    return NULL;
+}
+
+
+/*
+ * Search a source of a federated search.
+ */
+static void
+eb_search_source(EB_Federated_Search *federated, int source_index)
+{
+    EB_Error_Code error_code;
+    EB_Search_Source *source;
+    EB_Book *book;
+    EB_Hit *hit_list;
+    int hit_count;
+
+    source = federated->sources + source_index;
+    book = source->book;
+    hit_list = federated->hit_lists
+	+ (size_t) source_index * federated->max_hit_count;
+    source->hit_count = 0;
+
+    LOG(("in: eb_search_source(source_index=%d, book=%d, subbook=%d)",
+	source_index, (int)book->code, (int)source->subbook_code));
+
+    if (eb_federated_is_expired(federated)) {
+	error_code = EB_ERR_TIMED_OUT;
+	goto failed;
+    }
+
+    eb_lock(&book->lock);
+
+    /*
+     * Set the subbook, and search the word.
+     */
+    error_code = eb_set_subbook(book, source->subbook_code);
+    if (error_code != EB_SUCCESS)
+	goto unlock;
+
+    if (federated->search_code == EB_SEARCH_EXACTWORD)
+	error_code = eb_search_exactword(book, federated->input_word);
+    else if (federated->search_code == EB_SEARCH_WORD)
+	error_code = eb_search_word(book, federated->input_word);
+    else
+	error_code = eb_search_endword(book, federated->input_word);
+    if (error_code != EB_SUCCESS)
+	goto unlock;
+
+    /*
+     * Get hits until the deadline.
+     */
+    while (source->hit_count < federated->max_hit_count) {
+	if (eb_federated_is_expired(federated)) {
+	    error_code = EB_ERR_TIMED_OUT;
+	    break;
+	}
+	error_code = eb_hit_list(book,
+	    federated->max_hit_count - source->hit_count,
+	    hit_list + source->hit_count, &hit_count);
+	if (error_code != EB_SUCCESS || hit_count == 0)
+	    break;
+	source->hit_count += hit_count;
+    }
+
+  unlock:
+    eb_unlock(&book->lock);
+
+  failed:
+    source->error_code = error_code;
+    LOG(("out: eb_search_source(hit_count=%d) = %s", source->hit_count,
+	eb_error_string(error_code)));
+}
+
+
+/*
+ * Get the current time in milliseconds.  The monotonic clock is used
+ * if available, so that the deadline isn't moved by a change of the
+ * system time.
+ */
+static long long
+eb_federated_clock(void)
+{
+#ifdef HAVE_CLOCK_GETTIME
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long) now.tv_sec * 1000 + now.tv_nsec / 1000000;
+#else
+    struct timeval now;
+
+    gettimeofday(&now, NULL);
+    return (long long) now.tv_sec * 1000 + now.tv_usec / 1000;
+#endif
+}
+
+
+/*
+ * Examine whether the deadline of `federated' has passed or not.
+ */
+static int
+eb_federated_is_expired(EB_Federated_Search *federated)
+{
+    return federated->deadline != 0
+	&& federated->deadline <= eb_federated_clock();
+}
@@ -118,6 +118,7 @@ eb_load_multi_searches(EB_Book *book)
 		    entry->small_vowel      = EB_INDEX_STYLE_ASIS;
 		    entry->p_sound          = EB_INDEX_STYLE_ASIS;
 		    entry->space            = EB_INDEX_STYLE_ASIS;
+		    eb_compile_search_styles(entry);
 		    break;
 		case 0x01:
 		    entry->candidates_page = eb_uint4(buffer_p + 2);
@@ -151,12 +151,8 @@ eb_load_narrow_font_header(EB_Book *book, EB_Font_Code font_code)
     /*
      * Read information from the text file.
      */
-    if (zio_lseek(zio, ((off_t) narrow_font->page - 1) * EB_SIZE_PAGE,
-	SEEK_SET) < 0) {
-	error_code = EB_ERR_FAIL_SEEK_FONT;
-	goto failed;
-    }
-    if (zio_read(zio, buffer, 16) != 16) {
+    if (zio_pread(zio, ((off_t) narrow_font->page - 1) * EB_SIZE_PAGE,
+	buffer, 16) != 16) {
 	error_code = EB_ERR_FAIL_READ_FONT;
 	goto failed;
     }
@@ -277,13 +273,8 @@ eb_load_narrow_font_glyphs(EB_Book *book, EB_Font_Code font_code)
     /*
      * Read glyphs.
      */
-    if (zio_lseek(zio, (off_t) narrow_font->page * EB_SIZE_PAGE, SEEK_SET)
-	< 0) {
-	error_code = EB_ERR_FAIL_SEEK_FONT;
-	goto failed;
-    }
-    if (zio_read(zio, narrow_font->glyphs, total_glyph_size)
-	!= total_glyph_size) {
+    if (zio_pread(zio, (off_t) narrow_font->page * EB_SIZE_PAGE,
+	narrow_font->glyphs, total_glyph_size) != total_glyph_size) {
 	error_code = EB_ERR_FAIL_READ_FONT;
 	goto failed;
     }
@@ -763,13 +754,9 @@ character_number=%d)",
     if (narrow_current->glyphs == NULL) {
 	zio = &narrow_current->zio;
 
-	if (zio_lseek(zio,
+	if (zio_pread(zio,
 		(off_t) narrow_current->page * EB_SIZE_PAGE + offset,
-		SEEK_SET) < 0) {
-	    error_code = EB_ERR_FAIL_SEEK_FONT;
-	    goto failed;
-	}
-	if (zio_read(zio, bitmap, size) != size) {
+		bitmap, size) != size) {
 	    error_code = EB_ERR_FAIL_READ_FONT;
 	    goto failed;
 	}
@@ -851,13 +838,9 @@ character_number=%d)",
     if (narrow_current->glyphs == NULL) {
 	zio = &narrow_current->zio;
 
-	if (zio_lseek(zio,
+	if (zio_pread(zio,
 		(off_t) narrow_current->page * EB_SIZE_PAGE + offset,
-		SEEK_SET) < 0) {
-	    error_code = EB_ERR_FAIL_SEEK_FONT;
-	    goto failed;
-	}
-	if (zio_read(zio, bitmap, size) != size) {
+		bitmap, size) != size) {
 	    error_code = EB_ERR_FAIL_READ_FONT;
 	    goto failed;
 	}
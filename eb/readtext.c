@@ -47,6 +47,11 @@
  */
 #define SKIP_CODE_NONE  -1
 
+/*
+ * Size of the buffer used by eb_write_text_utf8().
+ */
+#define EB_SIZE_UTF8_BUFFER	256
+
 /*
  * Cache data buffer.
  */
@@ -88,6 +93,8 @@ static EB_Error_Code eb_read_text_internal(EB_Book *book,
     int forward_only);
 static int eb_is_stop_code(EB_Book *book, EB_Appendix *appendix,
     unsigned int code0, unsigned int code1);
+static EB_Error_Code eb_write_text_utf8(EB_Book *book, const char *stream,
+    size_t stream_length);
 
 
 /*
@@ -514,13 +521,8 @@ eb_read_rawtext(EB_Book *book, size_t text_max_length, char *text,
     /*
      * Seek START file and read data.
      */
-    if (zio_lseek(&book->subbook_current->text_zio,
-	book->text_context.location, SEEK_SET) == -1) {
-	error_code = EB_ERR_FAIL_SEEK_TEXT;
-	goto failed;
-    }
-    *text_length = zio_read(&book->subbook_current->text_zio, text,
-	text_max_length);
+    *text_length = zio_pread(&book->subbook_current->text_zio,
+	book->text_context.location, text, text_max_length);
     book->text_context.location += *text_length;
     if (*text_length < 0) {
 	error_code = EB_ERR_FAIL_READ_TEXT;
@@ -545,6 +547,51 @@ eb_read_rawtext(EB_Book *book, size_t text_max_length, char *text,
 }
 
 
+/*
+ * Set UTF-8 mode of `book'.
+ * If `flag' is not 0, eb_read_text() and eb_read_heading() write text
+ * in UTF-8 instead of EUC-JP (or ISO 8859 1 in an ISO 8859 1 book).
+ * Local characters and GB 2312 characters without a hook function are
+ * written as REPLACEMENT CHARACTER (U+FFFD).
+ *
+ * Text written by hook functions through eb_write_text_byte1(),
+ * eb_write_text_byte2() and eb_write_text_string() is taken as EUC-JP
+ * (or ISO 8859 1), and is converted.  A hook function which writes
+ * text already in UTF-8 must use eb_write_text(), which writes text as
+ * it is.  (EUC-JP and UTF-8 cannot be told apart reliably.)
+ */
+EB_Error_Code
+eb_set_utf8_mode(EB_Book *book, int flag)
+{
+    EB_Error_Code error_code;
+
+    eb_lock(&book->lock);
+    LOG(("in: eb_set_utf8_mode(book=%d, flag=%d)", (int)book->code, flag));
+
+    /*
+     * The book must have been bound.
+     */
+    if (book->path == NULL) {
+	error_code = EB_ERR_UNBOUND_BOOK;
+	goto failed;
+    }
+
+    book->utf8_mode = flag;
+
+    LOG(("out: eb_set_utf8_mode() = %s", eb_error_string(EB_SUCCESS)));
+    eb_unlock(&book->lock);
+    return EB_SUCCESS;
+
+    /*
+     * An error occurs...
+     */
+  failed:
+    LOG(("out: eb_set_utf8_mode() = %s", eb_error_string(error_code)));
+    eb_unlock(&book->lock);
+    return error_code;
+}
+
+
 /*
  * Get text or heading.
  */
@@ -641,13 +688,8 @@ text_max_length=%ld, forward=%d)",
 
 	    if (0 < cache_rest_length)
 		memmove(cache_buffer, cache_p, cache_rest_length);
-	    if (zio_lseek(&book->subbook_current->text_zio,
-		context->location + cache_rest_length, SEEK_SET) == -1) {
-		error_code = EB_ERR_FAIL_SEEK_TEXT;
-		goto failed;
-	    }
-
-	    read_result = zio_read(&book->subbook_current->text_zio,
+	    read_result = zio_pread(&book->subbook_current->text_zio,
+		context->location + cache_rest_length,
 		cache_buffer + cache_rest_length,
 		EB_SIZE_PAGE - cache_rest_length);
 	    if (read_result < 0) {
@@ -1431,6 +1473,14 @@ text_max_length=%ld, forward=%d)",
 		hook = hookset->hooks + EB_HOOK_GB2312;
 		if (forward_only) {
 		    ; /* do nothing */
+		} else if (hook->function == NULL && book->utf8_mode) {
+		    /*
+		     * GB 2312 is not converted to UTF-8.  Write
+		     * REPLACEMENT CHARACTER (U+FFFD) instead.
+		     */
+		    error_code = eb_write_text(book, "\357\277\275", 3);
+		    if (error_code != EB_SUCCESS)
+			goto failed;
 		} else if (hook->function == NULL) {
 		    error_code = eb_write_text_byte2(book, c1 | 0x80, c2);
 		    if (error_code != EB_SUCCESS)
@@ -1451,6 +1501,10 @@ text_max_length=%ld, forward=%d)",
 		    hook = hookset->hooks + EB_HOOK_NARROW_FONT;
 		    if (forward_only) {
 			; /* do nothing */
+		    } else if (hook->function == NULL && book->utf8_mode) {
+			error_code = eb_write_text(book, "\357\277\275", 3);
+			if (error_code != EB_SUCCESS)
+			    goto failed;
 		    } else if (hook->function == NULL) {
 			error_code = eb_write_text_byte2(book, c1, c2);
 			if (error_code != EB_SUCCESS)
@@ -1465,6 +1519,10 @@ text_max_length=%ld, forward=%d)",
 		    hook = hookset->hooks + EB_HOOK_WIDE_FONT;
 		    if (forward_only) {
 			; /* do nothing */
+		    } else if (hook->function == NULL && book->utf8_mode) {
+			error_code = eb_write_text(book, "\357\277\275", 3);
+			if (error_code != EB_SUCCESS)
+			    goto failed;
 		    } else if (hook->function == NULL) {
 			error_code = eb_write_text_byte2(book, c1, c2);
 			if (error_code != EB_SUCCESS)
@@ -1595,7 +1653,12 @@ eb_write_text_byte1(EB_Book *book, int byte1)
      * If the text buffer has enough space to write `byte1',
      * save the byte in `book->text_context.unprocessed'.
      */
-    if (book->text_context.unprocessed != NULL
+    if (book->utf8_mode && 0x80 <= byte1) {
+	*(unsigned char *)stream = byte1;
+	error_code = eb_write_text_utf8(book, stream, 1);
+	if (error_code != EB_SUCCESS)
+	    goto failed;
+    } else if (book->text_context.unprocessed != NULL
 	|| book->text_context.out_rest_length < 1) {
 	*(unsigned char *)stream = byte1;
 	error_code = eb_write_text(book, stream, 1);
@@ -1637,7 +1700,13 @@ eb_write_text_byte2(EB_Book *book, int byte1, int byte2)
      * If the text buffer has enough space to write `byte1' and `byte2',
      * save the bytes in `book->text_context.unprocessed'.
      */
-    if (book->text_context.unprocessed != NULL
+    if (book->utf8_mode && (0x80 <= byte1 || 0x80 <= byte2)) {
+	*(unsigned char *)stream = byte1;
+	*(unsigned char *)(stream + 1) = byte2;
+	error_code = eb_write_text_utf8(book, stream, 2);
+	if (error_code != EB_SUCCESS)
+	    goto failed;
+    } else if (book->text_context.unprocessed != NULL
 	|| book->text_context.out_rest_length < 2) {
 	*(unsigned char *)stream = byte1;
 	*(unsigned char *)(stream + 1) = byte2;
@@ -1684,7 +1753,11 @@ eb_write_text_string(EB_Book *book, const char *string)
      */
     string_length = strlen(string);
 
-    if (book->text_context.unprocessed != NULL
+    if (book->utf8_mode) {
+	error_code = eb_write_text_utf8(book, string, string_length);
+	if (error_code != EB_SUCCESS)
+	    goto failed;
+    } else if (book->text_context.unprocessed != NULL
 	|| book->text_context.out_rest_length < string_length) {
 	error_code = eb_write_text(book, string, string_length);
 	if (error_code != EB_SUCCESS)
@@ -1777,6 +1850,118 @@ eb_write_text(EB_Book *book, const char *stream, size_t stream_length)
 }
 
 
+/*
+ * Write a stream with `length' bytes in EUC-JP (or ISO 8859 1 in an
+ * ISO 8859 1 book) to a text buffer, converting it to UTF-8.
+ * Runs of ASCII characters are copied as they are.  A local character
+ * (a byte from 0xa1 to 0xfe followed by a byte from 0x21 to 0x7e) and
+ * a byte which is not a part of an EUC-JP character are converted to
+ * REPLACEMENT CHARACTER (U+FFFD), so that the result is always valid
+ * UTF-8.
+ */
+static EB_Error_Code
+eb_write_text_utf8(EB_Book *book, const char *stream, size_t stream_length)
+{
+    EB_Error_Code error_code;
+    const unsigned char *sp = (const unsigned char *) stream;
+    const unsigned char *tail = sp + stream_length;
+    char buffer[EB_SIZE_UTF8_BUFFER];
+    size_t buffer_length = 0;
+    size_t ascii_length;
+    unsigned int ucs;
+
+    LOG(("in: eb_write_text_utf8(book=%d, stream=%s)",
+	(int)book->code, eb_quoted_stream(stream, stream_length)));
+
+    while (sp < tail) {
+	/*
+	 * Copy a run of ASCII characters.
+	 */
+	ascii_length = eb_ascii_length((const char *) sp, tail - sp);
+	if (0 < ascii_length) {
+	    if (ascii_length <= EB_SIZE_UTF8_BUFFER - buffer_length) {
+		memcpy(buffer + buffer_length, sp, ascii_length);
+		buffer_length += ascii_length;
+	    } else {
+		if (0 < buffer_length) {
+		    error_code = eb_write_text(book, buffer, buffer_length);
+		    if (error_code != EB_SUCCESS)
+			goto failed;
+		    buffer_length = 0;
+		}
+		error_code = eb_write_text(book, (const char *) sp,
+		    ascii_length);
+		if (error_code != EB_SUCCESS)
+		    goto failed;
+	    }
+	    sp += ascii_length;
+	    continue;
+	}
+
+	/*
+	 * Convert a non-ASCII character.  It takes 4 bytes at most
+	 * in UTF-8.
+	 */
+	if (EB_SIZE_UTF8_BUFFER - buffer_length < 4) {
+	    error_code = eb_write_text(book, buffer, buffer_length);
+	    if (error_code != EB_SUCCESS)
+		goto failed;
+	    buffer_length = 0;
+	}
+
+	if (book->character_code == EB_CHARCODE_ISO8859_1) {
+	    ucs = *sp;
+	    sp++;
+	} else if (0xa1 <= *sp && *sp <= 0xfe && sp + 1 < tail
+	    && 0xa1 <= *(sp + 1) && *(sp + 1) <= 0xfe) {
+	    /*
+	     * JIS X 0208.  An undefined character is converted to
+	     * REPLACEMENT CHARACTER (U+FFFD).
+	     */
+	    ucs = eb_jisx0208_to_ucs(((*sp & 0x7f) << 8) | (*(sp + 1) & 0x7f));
+	    if (ucs == 0)
+		ucs = 0xfffd;
+	    sp += 2;
+	} else if (*sp == 0x8e && sp + 1 < tail
+	    && 0xa1 <= *(sp + 1) && *(sp + 1) <= 0xdf) {
+	    /*
+	     * JIS X 0201 KATAKANA.
+	     */
+	    ucs = 0xff61 + (*(sp + 1) - 0xa1);
+	    sp += 2;
+	} else if (0xa1 <= *sp && *sp <= 0xfe && sp + 1 < tail
+	    && 0x21 <= *(sp + 1) && *(sp + 1) <= 0x7e) {
+	    /*
+	     * A local character.
+	     */
+	    ucs = 0xfffd;
+	    sp += 2;
+	} else {
+	    ucs = 0xfffd;
+	    sp++;
+	}
+	buffer_length += eb_ucs_to_utf8(ucs, buffer + buffer_length);
+    }
+
+    if (0 < buffer_length) {
+	error_code = eb_write_text(book, buffer, buffer_length);
+	if (error_code != EB_SUCCESS)
+	    goto failed;
+    }
+
+    LOG(("out: eb_write_text_utf8() = %s", eb_error_string(EB_SUCCESS)));
+
+    return EB_SUCCESS;
+
+    /*
+     * An error occurs...
+     */
+  failed:
+    LOG(("out: eb_write_text_utf8() = %s", eb_error_string(error_code)));
+    return error_code;
+}
+
+
 /*
  * Get the current candidate word for multi search.
  */
@@ -2014,12 +2199,8 @@ eb_backward_text(EB_Book *book, EB_Appendix *appendix)
      * If the text locator has pointed to `0x1f02' (beginning of text),
      * we cannot backward.
      */
-    if (zio_lseek(&book->subbook_current->text_zio,
-	book->text_context.location, SEEK_SET) == -1) {
-	error_code = EB_ERR_FAIL_SEEK_TEXT;
-	goto failed;
-    }
-    if (zio_read(&book->subbook_current->text_zio, text_buffer, 2) != 2) {
+    if (zio_pread(&book->subbook_current->text_zio,
+	book->text_context.location, text_buffer, 2) != 2) {
 	error_code = EB_ERR_FAIL_READ_TEXT;
 	goto failed;
     }
@@ -2057,15 +2238,9 @@ eb_backward_text(EB_Book *book, EB_Appendix *appendix)
 	    read_location = book->text_context.location - EB_SIZE_PAGE + 3;
 	backward_distance = book->text_context.location - read_location;
 
-	if (zio_lseek(&book->subbook_current->text_zio, read_location,
-	    SEEK_SET) == -1) {
-	    error_code = EB_ERR_FAIL_SEEK_TEXT;
-	    goto failed;
-	}
-
 	memset(text_buffer, 0x00, EB_SIZE_PAGE);
-	read_result = zio_read(&book->subbook_current->text_zio, text_buffer,
-	    EB_SIZE_PAGE);
+	read_result = zio_pread(&book->subbook_current->text_zio,
+	    read_location, text_buffer, EB_SIZE_PAGE);
 	if (read_result < 0 || read_result < backward_distance) {
 	    error_code = EB_ERR_FAIL_READ_TEXT;
 	    goto failed;
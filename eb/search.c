@@ -41,36 +41,63 @@
 #define PAGE_ID_HAVE_GROUP_ENTRY(page_id)	(((page_id) & 0x10) == 0x10)
 
 /*
- * The maximum number of hit entries for tomporary hit lists.
- * This is used in eb_hit_list().
+ * The initial and maximum number of hits in a hit buffer of a search
+ * context.  They are used in eb_hit_list().
  */
-#define EB_TMP_MAX_HITS		64
+#define EB_MIN_BUFFERED_HITS	64
+#define EB_MAX_BUFFERED_HITS	4096
 
 /*
- * Book-code of the book in which you want to search a word.
+ * The number of leaf index pages read at once by eb_foreach_index_entry().
  */
-static EB_Book_Code cache_book_code = EB_BOOK_NONE;
+#define EB_BULK_INDEX_PAGES	32
 
 /*
- * Cache buffer for the current page.
+ * A word in a batch search.  (See eb_search_word_batch_internal().)
  */
-static char cache_buffer[EB_SIZE_PAGE];
+typedef struct {
+    /*
+     * Index of the word in the input words.
+     */
+    int index;
 
-/*
- * Cache buffer for the current page.
- */
-static int cache_page;
+    /*
+     * Start page of the index to search.
+     * (`page' is 0 if the word cannot be searched.)
+     */
+    int page;
 
-/*
- * Mutex for cache variables.
- */
-#ifdef ENABLE_PTHREAD
-static pthread_mutex_t cache_mutex = PTHREAD_MUTEX_INITIALIZER;
-#endif
+    /*
+     * Functions which compare the word and patterns in index pages.
+     */
+    int (*compare_pre)(const char *word, const char *pattern,
+	size_t length);
+    int (*compare_single)(const char *word, const char *pattern,
+	size_t length);
+    int (*compare_group)(const char *word, const char *pattern,
+	size_t length);
+
+    /*
+     * Fixed word and canonicalized word to search.
+     */
+    char word[EB_MAX_WORD_LENGTH + 1];
+    char canonicalized_word[EB_MAX_WORD_LENGTH + 1];
+} EB_Batch_Word;
 
 /*
  * Unexported functions.
  */
+static EB_Error_Code eb_search_word_batch_internal(EB_Book *book,
+    EB_Search_Code search_code, const char * const input_words[],
+    int word_count, int max_hit_count, EB_Hit *hit_lists, int *hit_counts);
+static int eb_compare_batch_words(const void *word1, const void *word2);
+static EB_Error_Code eb_enumerate_entries(EB_Book *book,
+    EB_Search_Context *context, int max_entry_count,
+    int (*function)(EB_Book *book, void *container, const char *key,
+    size_t key_length, const EB_Hit *hit), void *container,
+    int bulk_page_count, int *entry_count);
+static int eb_collect_hit(EB_Book *book, void *container, const char *key,
+    size_t key_length, const EB_Hit *hit);
 static EB_Error_Code eb_hit_list_word(EB_Book *book,
     EB_Search_Context *context, int max_hit_count, EB_Hit *hit_list,
     int *hit_count);
@@ -80,10 +107,17 @@ static EB_Error_Code eb_hit_list_keyword(EB_Book *book,
 static EB_Error_Code eb_hit_list_multi(EB_Book *book,
     EB_Search_Context *context, int max_hit_count, EB_Hit *hit_list,
     int *hit_count);
-static void eb_and_hit_lists(EB_Hit and_list[EB_TMP_MAX_HITS],
-    int *and_count, int max_and_count, int hit_list_count,
-    EB_Hit hit_lists[EB_NUMBER_OF_SEARCH_CONTEXTS][EB_TMP_MAX_HITS],
-    int hit_counts[EB_NUMBER_OF_SEARCH_CONTEXTS]);
+static EB_Index_Page *eb_find_index_page(EB_Subbook *subbook, int page);
+static EB_Index_Page *eb_add_index_page(EB_Subbook *subbook, int page,
+    const char *buffer);
+static EB_Error_Code eb_and_hit_lists(EB_Book *book, int context_count,
+    int max_hit_count, EB_Hit *hit_list, int *hit_count);
+static EB_Error_Code eb_fill_hit_buffer(EB_Book *book,
+    EB_Search_Context *context);
+static EB_Error_Code eb_seek_hit_buffer(EB_Book *book,
+    EB_Search_Context *context, const EB_Position *position);
+static int eb_compare_positions(const EB_Position *position1,
+    const EB_Position *position2);
 
 
 /*
@@ -116,6 +150,11 @@ eb_initialize_search_contexts(EB_Book *book)
 	context->in_group_entry = 0;
 	context->keyword_heading.page = 0;
 	context->keyword_heading.offset = 0;
+	context->cache_page = 0;
+	context->hits = NULL;
+	context->hit_count = 0;
+	context->hit_index = 0;
+	context->max_hit_count = 0;
     }
 
     LOG(("out: eb_initialize_search_context()"));
@@ -128,9 +167,22 @@ eb_initialize_search_contexts(EB_Book *book)
 void
 eb_finalize_search_contexts(EB_Book *book)
 {
-    LOG(("in+out: eb_finalize_search_context(book=%d)", (int)book->code));
+    EB_Search_Context *context;
+    int i;
 
-    /* nothing to be done */
+    LOG(("in: eb_finalize_search_context(book=%d)", (int)book->code));
+
+    for (i = 0, context = book->search_contexts;
+	 i < EB_NUMBER_OF_SEARCH_CONTEXTS; i++, context++) {
+	if (context->hits != NULL)
+	    free(context->hits);
+	context->hits = NULL;
+	context->hit_count = 0;
+	context->hit_index = 0;
+	context->max_hit_count = 0;
+    }
+
+    LOG(("out: eb_finalize_search_context()"));
 }
 
 
@@ -142,6 +194,7 @@ eb_reset_search_contexts(EB_Book *book)
 {
     LOG(("in: eb_reset_search_context(book=%d)", (int)book->code));
 
+    eb_finalize_search_contexts(book);
     eb_initialize_search_contexts(book);
 
     LOG(("out: eb_reset_search_context()"));
@@ -169,6 +222,7 @@ eb_initialize_search(EB_Search *search)
     search->p_sound = EB_INDEX_STYLE_CONVERT;
     search->space = EB_INDEX_STYLE_DELETE;
     search->label[0] = '\0';
+    eb_compile_search_styles(search);
 }
 
 
@@ -222,6 +276,10 @@ eb_initialize_searches(EB_Book *book)
 	}
     }
 
+    for (i = 0; i < EB_INDEX_PAGE_HASH_SIZE; i++)
+	subbook->index_pages[i] = NULL;
+    subbook->index_page_count = 0;
+
     LOG(("out: eb_initialize_searches(book=%d)", (int)book->code));
 }
 
@@ -235,6 +293,8 @@ eb_finalize_searches(EB_Book *book)
     EB_Subbook *subbook;
     EB_Multi_Search *multi;
     EB_Search *entry;
+    EB_Index_Page *index_page;
+    EB_Index_Page *next_index_page;
     int i, j;
 
     LOG(("in: eb_finalize_searches(book=%d)", (int)book->code));
@@ -264,67 +324,156 @@ eb_finalize_searches(EB_Book *book)
 	}
     }
 
+    for (i = 0; i < EB_INDEX_PAGE_HASH_SIZE; i++) {
+	for (index_page = subbook->index_pages[i]; index_page != NULL;
+	     index_page = next_index_page) {
+	    next_index_page = index_page->next;
+	    free(index_page);
+	}
+	subbook->index_pages[i] = NULL;
+    }
+    subbook->index_page_count = 0;
+
     LOG(("out: eb_finalize_searches()"));
 }
 
 
+/*
+ * Find an intermediate index page `page' kept in memory.
+ * If not found, NULL is returned.
+ */
+static EB_Index_Page *
+eb_find_index_page(EB_Subbook *subbook, int page)
+{
+    EB_Index_Page *index_page;
+
+    for (index_page = subbook->index_pages[page % EB_INDEX_PAGE_HASH_SIZE];
+	 index_page != NULL; index_page = index_page->next) {
+	if (index_page->page == page)
+	    return index_page;
+    }
+
+    return NULL;
+}
+
+
+/*
+ * Keep an intermediate index page `page' in memory.  `buffer' has
+ * the content of the page.  Only entries which fit in the page are
+ * kept.
+ * If the page cannot be kept, NULL is returned.
+ */
+static EB_Index_Page *
+eb_add_index_page(EB_Subbook *subbook, int page, const char *buffer)
+{
+    EB_Index_Page *index_page;
+    int entry_count;
+    size_t entry_size;
+    size_t entries_length;
+
+    if (EB_MAX_INDEX_PAGES <= subbook->index_page_count)
+	return NULL;
+
+    entry_count = eb_uint2(buffer + 2);
+    entry_size = eb_uint1(buffer + 1) + 4;
+    if ((int) ((EB_SIZE_PAGE - 4) / entry_size) < entry_count)
+	entries_length = (EB_SIZE_PAGE - 4) / entry_size * entry_size;
+    else
+	entries_length = entry_count * entry_size;
+
+    index_page = (EB_Index_Page *) malloc(sizeof(EB_Index_Page)
+	+ entries_length);
+    if (index_page == NULL)
+	return NULL;
+
+    index_page->page = page;
+    index_page->page_id = eb_uint1(buffer);
+    index_page->entry_length = eb_uint1(buffer + 1);
+    index_page->entry_count = entry_count;
+    index_page->entries = (char *) (index_page + 1);
+    memcpy(index_page->entries, buffer + 4, entries_length);
+
+    index_page->next = subbook->index_pages[page % EB_INDEX_PAGE_HASH_SIZE];
+    subbook->index_pages[page % EB_INDEX_PAGE_HASH_SIZE] = index_page;
+    subbook->index_page_count++;
+
+    return index_page;
+}
+
+
 /*
  * Pre-search for a word described in the current search context.
  * It descends intermediate indexes and reached to a leaf page that
  * may have the word.
+ * Intermediate index pages are kept in memory in the current subbook,
+ * and entries of them are searched by binary search, so that only the
+ * leaf page is read from the file once the upper levels are kept.
+ * The leaf page is not read again if it is in the cache buffer of
+ * `context' already.
  * If succeeded, 0 is returned.  Otherwise -1 is returned.
  */
 EB_Error_Code
 eb_presearch_word(EB_Book *book, EB_Search_Context *context)
 {
     EB_Error_Code error_code;
+    EB_Subbook *subbook;
+    EB_Index_Page *index_page;
     int next_page;
     int index_depth;
-    char *cache_p;
+    int entry_size;
+    int search_count;
+    int low, high, middle;
+    char *entries;
 
-    pthread_mutex_lock(&cache_mutex);
     LOG(("in: eb_presearch_word(book=%d)", (int)book->code));
 
-    /*
-     * Discard cache data.
-     */
-    cache_book_code = EB_BOOK_NONE;
+    subbook = book->subbook_current;
 
     /*
      * Search the word in intermediate indexes.
      * Find a page number of the leaf index page.
      */
     for (index_depth = 0; index_depth < EB_MAX_INDEX_DEPTH; index_depth++) {
-	next_page = context->page;
-
 	/*
-	 * Seek and read a page.
+	 * Use the page kept in memory, or the page in the cache buffer,
+	 * if any.  Otherwise seek and read the page, and keep it in
+	 * memory unless it is a leaf page.
 	 */
-	if (zio_lseek(&book->subbook_current->text_zio,
-	    ((off_t) context->page - 1) * EB_SIZE_PAGE, SEEK_SET) < 0) {
-	    cache_book_code = EB_BOOK_NONE;
-	    error_code = EB_ERR_FAIL_SEEK_TEXT;
-	    goto failed;
-	}
-	if (zio_read(&book->subbook_current->text_zio, cache_buffer,
-	    EB_SIZE_PAGE) != EB_SIZE_PAGE) {
-	    cache_book_code = EB_BOOK_NONE;
-	    error_code = EB_ERR_FAIL_READ_TEXT;
-	    goto failed;
+	index_page = eb_find_index_page(subbook, context->page);
+	if (index_page == NULL && context->cache_page != context->page) {
+	    if (zio_pread(&subbook->text_zio,
+		((off_t) context->page - 1) * EB_SIZE_PAGE,
+		context->cache_buffer, EB_SIZE_PAGE) != EB_SIZE_PAGE) {
+		context->cache_page = 0;
+		error_code = EB_ERR_FAIL_READ_TEXT;
+		goto failed;
+	    }
+	    context->cache_page = context->page;
+	    if (!PAGE_ID_IS_LEAF_LAYER(eb_uint1(context->cache_buffer))) {
+		index_page = eb_add_index_page(subbook, context->page,
+		    context->cache_buffer);
+	    }
 	}
 
 	/*
-	 * Get some data from the read page.
+	 * Get some data from the page.
 	 */
-	context->page_id = eb_uint1(cache_buffer);
-	context->entry_length = eb_uint1(cache_buffer + 1);
+	if (index_page != NULL) {
+	    context->page_id = index_page->page_id;
+	    context->entry_length = index_page->entry_length;
+	    context->entry_count = index_page->entry_count;
+	    entries = index_page->entries;
+	} else {
+	    context->page_id = eb_uint1(context->cache_buffer);
+	    context->entry_length = eb_uint1(context->cache_buffer + 1);
+	    context->entry_count = eb_uint2(context->cache_buffer + 2);
+	    entries = context->cache_buffer + 4;
+	}
 	if (context->entry_length == 0)
 	    context->entry_arrangement = EB_ARRANGE_VARIABLE;
 	else
 	    context->entry_arrangement = EB_ARRANGE_FIXED;
-	context->entry_count = eb_uint2(cache_buffer + 2);
 	context->offset = 4;
-	cache_p = cache_buffer + 4;
 
 	LOG(("aux: eb_presearch_word(page=%d, page_id=0x%02x, \
 entry_length=%d, entry_arrangement=%d, entry_count=%d)",
@@ -339,24 +488,38 @@ entry_length=%d, entry_arrangement=%d, entry_count=%d)",
 
 	/*
 	 * Search a page of next level index.
+	 * Entries are sorted by their keys.  Find the first entry whose
+	 * key is not less than the word, among entries in the page.
 	 */
-	for (context->entry_index = 0;
-	     context->entry_index < context->entry_count;
-	     context->entry_index++) {
-	    if (EB_SIZE_PAGE < context->offset + context->entry_length + 4) {
-		error_code = EB_ERR_UNEXP_TEXT;
-		goto failed;
-	    }
-	    if (context->compare_pre(context->canonicalized_word, cache_p,
-		context->entry_length) <= 0) {
-		next_page = eb_uint4(cache_p + context->entry_length);
-		break;
-	    }
-	    cache_p += context->entry_length + 4;
-	    context->offset += context->entry_length + 4;
+	entry_size = context->entry_length + 4;
+	search_count = (EB_SIZE_PAGE - 4) / entry_size;
+	if (context->entry_count < search_count)
+	    search_count = context->entry_count;
+
+	low = 0;
+	high = search_count;
+	while (low < high) {
+	    middle = (low + high) / 2;
+	    if (context->compare_pre(context->canonicalized_word,
+		entries + middle * entry_size, context->entry_length) <= 0)
+		high = middle;
+	    else
+		low = middle + 1;
+	}
+	if (low == search_count && search_count < context->entry_count) {
+	    error_code = EB_ERR_UNEXP_TEXT;
+	    goto failed;
+	}
+
+	context->entry_index = low;
+	context->offset = 4 + low * entry_size;
+	if (context->entry_count <= context->entry_index) {
+	    context->comparison_result = -1;
+	    goto succeeded;
 	}
-	if (context->entry_count <= context->entry_index
-	    || context->page == next_page) {
+	next_page = eb_uint4(entries + low * entry_size
+	    + context->entry_length);
+	if (context->page == next_page) {
 	    context->comparison_result = -1;
 	    goto succeeded;
 	}
@@ -377,12 +540,10 @@ entry_length=%d, entry_arrangement=%d, entry_count=%d)",
     context->entry_index = 0;
     context->comparison_result = 1;
     context->in_group_entry = 0;
-    cache_book_code = book->code;
-    cache_page = context->page;
+    context->cache_page = context->page;
 
   succeeded:
     LOG(("out: eb_presearch_word() = %s", eb_error_string(EB_SUCCESS)));
-    pthread_mutex_unlock(&cache_mutex);
     return EB_SUCCESS;
 
     /*
@@ -390,7 +551,6 @@ entry_length=%d, entry_arrangement=%d, entry_count=%d)",
      */
   failed:
     LOG(("out: eb_presearch_word() = %s", eb_error_string(error_code)));
-    pthread_mutex_unlock(&cache_mutex);
     return error_code;
 }
 
@@ -401,16 +561,11 @@ EB_Error_Code
 eb_hit_list(EB_Book *book, int max_hit_count, EB_Hit *hit_list, int *hit_count)
 {
     EB_Error_Code error_code;
-    EB_Search_Context temporary_context;
-    EB_Hit temporary_hit_lists[EB_NUMBER_OF_SEARCH_CONTEXTS][EB_TMP_MAX_HITS];
-    int temporary_hit_counts[EB_NUMBER_OF_SEARCH_CONTEXTS];
-    int more_hit_count;
     int i;
 
     /*
-     * Lock cache data and the book.
+     * Lock the book.
      */
-    pthread_mutex_lock(&cache_mutex);
     eb_lock(&book->lock);
     LOG(("in: eb_hit_list(book=%d, max_hit_count=%d)", (int)book->code,
 	max_hit_count));
@@ -449,92 +604,29 @@ eb_hit_list(EB_Book *book, int max_hit_count, EB_Hit *hit_list, int *hit_count)
 	/*
 	 * In case of keyword or cross search.
 	 */
-	for (;;) {
-	    int search_is_over = 0;
-
-	    for (i = 0; i < EB_MAX_KEYWORDS; i++) {
-		if (book->search_contexts[i].code != EB_SEARCH_KEYWORD
-		    && book->search_contexts[i].code != EB_SEARCH_CROSS)
-		    break;
-		memcpy(&temporary_context, book->search_contexts + i,
-		    sizeof(EB_Search_Context));
-		error_code = eb_hit_list_keyword(book, &temporary_context,
-		    EB_TMP_MAX_HITS, temporary_hit_lists[i],
-		    temporary_hit_counts + i);
-		if (error_code != EB_SUCCESS)
-		    goto failed;
-		if (temporary_hit_counts[i] == 0) {
-		    search_is_over = 1;
-		    break;
-		}
-	    }
-	    if (search_is_over)
-		break;
-
-	    eb_and_hit_lists(hit_list + *hit_count, &more_hit_count,
-		max_hit_count - *hit_count, i, temporary_hit_lists,
-		temporary_hit_counts);
-
-	    for (i = 0; i < EB_MAX_MULTI_ENTRIES; i++) {
-		if (book->search_contexts[i].code != EB_SEARCH_KEYWORD
-		    && book->search_contexts[i].code != EB_SEARCH_CROSS)
-		    break;
-		error_code = eb_hit_list_keyword(book,
-		    book->search_contexts + i, temporary_hit_counts[i],
-		    temporary_hit_lists[i], temporary_hit_counts + i);
-		if (error_code != EB_SUCCESS)
-		    goto failed;
-	    }
-
-	    *hit_count += more_hit_count;
-	    if (max_hit_count <= *hit_count)
+	for (i = 0; i < EB_MAX_KEYWORDS; i++) {
+	    if (book->search_contexts[i].code != EB_SEARCH_KEYWORD
+		&& book->search_contexts[i].code != EB_SEARCH_CROSS)
 		break;
 	}
+	error_code = eb_and_hit_lists(book, i, max_hit_count, hit_list,
+	    hit_count);
+	if (error_code != EB_SUCCESS)
+	    goto failed;
 	break;
 
     case EB_SEARCH_MULTI:
 	/*
 	 * In case of multi search.
 	 */
-	for (;;) {
-	    int search_is_over = 0;
-
-	    for (i = 0; i < EB_MAX_MULTI_ENTRIES; i++) {
-		if (book->search_contexts[i].code != EB_SEARCH_MULTI)
-		    break;
-		memcpy(&temporary_context, book->search_contexts + i,
-		    sizeof(EB_Search_Context));
-		error_code = eb_hit_list_multi(book, &temporary_context,
-		    EB_TMP_MAX_HITS, temporary_hit_lists[i],
-		    temporary_hit_counts + i);
-		if (error_code != EB_SUCCESS)
-		    goto failed;
-		if (temporary_hit_counts[i] == 0) {
-		    search_is_over = 1;
-		    break;
-		}
-	    }
-	    if (search_is_over)
-		break;
-
-	    eb_and_hit_lists(hit_list + *hit_count, &more_hit_count,
-		max_hit_count - *hit_count, i, temporary_hit_lists,
-		temporary_hit_counts);
-
-	    for (i = 0; i < EB_MAX_MULTI_ENTRIES; i++) {
-		if (book->search_contexts[i].code != EB_SEARCH_MULTI)
-		    break;
-		error_code = eb_hit_list_multi(book,
-		    book->search_contexts + i, temporary_hit_counts[i],
-		    temporary_hit_lists[i], temporary_hit_counts + i);
-		if (error_code != EB_SUCCESS)
-		    goto failed;
-	    }
-
-	    *hit_count += more_hit_count;
-	    if (max_hit_count <= *hit_count)
+	for (i = 0; i < EB_MAX_MULTI_ENTRIES; i++) {
+	    if (book->search_contexts[i].code != EB_SEARCH_MULTI)
 		break;
 	}
+	error_code = eb_and_hit_lists(book, i, max_hit_count, hit_list,
+	    hit_count);
+	if (error_code != EB_SUCCESS)
+	    goto failed;
 	break;
 
     default:
@@ -544,13 +636,12 @@ eb_hit_list(EB_Book *book, int max_hit_count, EB_Hit *hit_list, int *hit_count)
     }
 
     /*
-     * Unlock cache data and the book.
+     * Unlock the book.
      */
   succeeded:
     LOG(("out: eb_hit_list(hit_count=%d) = %s",
 	*hit_count, eb_error_string(EB_SUCCESS)));
     eb_unlock(&book->lock);
-    pthread_mutex_unlock(&cache_mutex);
     return EB_SUCCESS;
 
     /*
@@ -560,57 +651,527 @@ eb_hit_list(EB_Book *book, int max_hit_count, EB_Hit *hit_list, int *hit_count)
     *hit_count = 0;
     LOG(("out: eb_hit_list() = %s", eb_error_string(error_code)));
     eb_unlock(&book->lock);
-    pthread_mutex_unlock(&cache_mutex);
     return error_code;
 }
 
 
 /*
- * Get hit entries of a submitted exactword/word/endword search request.
+ * Search `word_count' words in `input_words' at once, by exactword search.
+ * Hits of `input_words[i]' are put into `hit_lists + i * max_hit_count',
+ * and the number of them is put into `hit_counts[i]'.
+ */
+EB_Error_Code
+eb_search_exactword_batch(EB_Book *book, const char * const input_words[],
+    int word_count, int max_hit_count, EB_Hit *hit_lists, int *hit_counts)
+{
+    return eb_search_word_batch_internal(book, EB_SEARCH_EXACTWORD,
+	input_words, word_count, max_hit_count, hit_lists, hit_counts);
+}
+
+
+/*
+ * Search `word_count' words in `input_words' at once, by word search.
+ */
+EB_Error_Code
+eb_search_word_batch(EB_Book *book, const char * const input_words[],
+    int word_count, int max_hit_count, EB_Hit *hit_lists, int *hit_counts)
+{
+    return eb_search_word_batch_internal(book, EB_SEARCH_WORD,
+	input_words, word_count, max_hit_count, hit_lists, hit_counts);
+}
+
+
+/*
+ * Search `word_count' words in `input_words' at once, by endword search.
+ */
+EB_Error_Code
+eb_search_endword_batch(EB_Book *book, const char * const input_words[],
+    int word_count, int max_hit_count, EB_Hit *hit_lists, int *hit_counts)
+{
+    return eb_search_word_batch_internal(book, EB_SEARCH_ENDWORD,
+	input_words, word_count, max_hit_count, hit_lists, hit_counts);
+}
+
+
+/*
+ * Search words at once, by exactword, word or endword search.
+ *
+ * The words are canonicalized and sorted in the order of index entries,
+ * then searched with a search context of its own.  Since neighboring
+ * words reach to the same leaf page in many cases, the page in the cache
+ * buffer of the context is shared among them, and the same words are
+ * searched only once.
+ *
+ * A word which cannot be searched, such as an empty word, gets no hit.
+ * Search contexts in `book' are not changed, so that the batch search
+ * doesn't disturb a search submitted by eb_search_word() and so on.
  */
 static EB_Error_Code
-eb_hit_list_word(EB_Book *book, EB_Search_Context *context, int max_hit_count,
-    EB_Hit *hit_list, int *hit_count)
+eb_search_word_batch_internal(EB_Book *book, EB_Search_Code search_code,
+    const char * const input_words[], int word_count, int max_hit_count,
+    EB_Hit *hit_lists, int *hit_counts)
 {
     EB_Error_Code error_code;
-    EB_Hit *hit;
+    EB_Subbook *subbook;
+    EB_Search_Context context;
+    EB_Batch_Word *batch_words = NULL;
+    EB_Batch_Word **sorted_words = NULL;
+    EB_Batch_Word *batch_word;
+    EB_Batch_Word *previous_word;
+    int i;
+
+    eb_lock(&book->lock);
+    LOG(("in: eb_search_word_batch(book=%d, search_code=%d, word_count=%d, \
+max_hit_count=%d)", (int)book->code, (int)search_code, word_count,
+	max_hit_count));
+
+    for (i = 0; i < word_count; i++)
+	hit_counts[i] = 0;
+    if (word_count <= 0 || max_hit_count <= 0)
+	goto succeeded;
+
+    /*
+     * Current subbook must have been set.
+     */
+    subbook = book->subbook_current;
+    if (subbook == NULL) {
+	error_code = EB_ERR_NO_CUR_SUB;
+	goto failed;
+    }
+
+    /*
+     * The subbook must have an index for the search method.
+     */
+    if (search_code == EB_SEARCH_ENDWORD) {
+	if (subbook->endword_alphabet.start_page == 0
+	    && subbook->endword_asis.start_page == 0
+	    && subbook->endword_kana.start_page == 0) {
+	    error_code = EB_ERR_NO_SUCH_SEARCH;
+	    goto failed;
+	}
+    } else {
+	if (subbook->word_alphabet.start_page == 0
+	    && subbook->word_asis.start_page == 0
+	    && subbook->word_kana.start_page == 0) {
+	    error_code = EB_ERR_NO_SUCH_SEARCH;
+	    goto failed;
+	}
+    }
+
+    /*
+     * Allocate memories for the words.
+     */
+    batch_words = (EB_Batch_Word *) malloc(sizeof(EB_Batch_Word)
+	* word_count);
+    sorted_words = (EB_Batch_Word **) malloc(sizeof(EB_Batch_Word *)
+	* word_count);
+    if (batch_words == NULL || sorted_words == NULL) {
+	error_code = EB_ERR_MEMORY_EXHAUSTED;
+	goto failed;
+    }
+
+    /*
+     * Make fixed words and canonicalized words, and get the index
+     * pages and comparison functions for them.
+     */
+    for (i = 0, batch_word = batch_words; i < word_count; i++, batch_word++) {
+	if (search_code == EB_SEARCH_EXACTWORD)
+	    error_code = eb_set_exactword_context(book, &context,
+		input_words[i], EB_INPUT_NATIVE);
+	else if (search_code == EB_SEARCH_WORD)
+	    error_code = eb_set_word_context(book, &context, input_words[i],
+		EB_INPUT_NATIVE);
+	else
+	    error_code = eb_set_endword_context(book, &context,
+		input_words[i], EB_INPUT_NATIVE);
+
+	batch_word->index = i;
+	if (error_code == EB_SUCCESS) {
+	    batch_word->page = context.page;
+	    batch_word->compare_pre = context.compare_pre;
+	    batch_word->compare_single = context.compare_single;
+	    batch_word->compare_group = context.compare_group;
+	    strcpy(batch_word->word, context.word);
+	    strcpy(batch_word->canonicalized_word, context.canonicalized_word);
+	} else {
+	    batch_word->page = 0;
+	}
+	sorted_words[i] = batch_word;
+    }
+
+    qsort(sorted_words, word_count, sizeof(EB_Batch_Word *),
+	eb_compare_batch_words);
+
+    /*
+     * Search the words in the sorted order.
+     */
+    context.cache_page = 0;
+    previous_word = NULL;
+    for (i = 0; i < word_count; i++) {
+	batch_word = sorted_words[i];
+	if (batch_word->page == 0)
+	    continue;
+
+	/*
+	 * Copy hits of the previous word if the words are the same.
+	 */
+	if (previous_word != NULL
+	    && previous_word->page == batch_word->page
+	    && strcmp(previous_word->canonicalized_word,
+		batch_word->canonicalized_word) == 0
+	    && strcmp(previous_word->word, batch_word->word) == 0) {
+	    memcpy(hit_lists + (size_t) batch_word->index * max_hit_count,
+		hit_lists + (size_t) previous_word->index * max_hit_count,
+		sizeof(EB_Hit) * hit_counts[previous_word->index]);
+	    hit_counts[batch_word->index] = hit_counts[previous_word->index];
+	    continue;
+	}
+
+	context.page = batch_word->page;
+	context.compare_pre = batch_word->compare_pre;
+	context.compare_single = batch_word->compare_single;
+	context.compare_group = batch_word->compare_group;
+	strcpy(context.word, batch_word->word);
+	strcpy(context.canonicalized_word, batch_word->canonicalized_word);
+
+	error_code = eb_presearch_word(book, &context);
+	if (error_code != EB_SUCCESS)
+	    goto failed;
+	error_code = eb_hit_list_word(book, &context, max_hit_count,
+	    hit_lists + (size_t) batch_word->index * max_hit_count,
+	    hit_counts + batch_word->index);
+	if (error_code != EB_SUCCESS)
+	    goto failed;
+
+	previous_word = batch_word;
+    }
+
+    /*
+     * Dispose memories.
+     */
+    free(batch_words);
+    free(sorted_words);
+
+  succeeded:
+    LOG(("out: eb_search_word_batch() = %s", eb_error_string(EB_SUCCESS)));
+    eb_unlock(&book->lock);
+    return EB_SUCCESS;
+
+    /*
+     * An error occurs...
+     */
+  failed:
+    for (i = 0; i < word_count; i++)
+	hit_counts[i] = 0;
+    if (batch_words != NULL)
+	free(batch_words);
+    if (sorted_words != NULL)
+	free(sorted_words);
+    LOG(("out: eb_search_word_batch() = %s", eb_error_string(error_code)));
+    eb_unlock(&book->lock);
+    return error_code;
+}
+
+
+/*
+ * Compare two words in a batch search, by the index page, the
+ * canonicalized word and the fixed word.  It is called by qsort().
+ */
+static int
+eb_compare_batch_words(const void *word1, const void *word2)
+{
+    const EB_Batch_Word *batch_word1 = *(const EB_Batch_Word * const *) word1;
+    const EB_Batch_Word *batch_word2 = *(const EB_Batch_Word * const *) word2;
+    int result;
+
+    if (batch_word1->page != batch_word2->page)
+	return (batch_word1->page < batch_word2->page) ? -1 : 1;
+
+    result = strcmp(batch_word1->canonicalized_word,
+	batch_word2->canonicalized_word);
+    if (result != 0)
+	return result;
+
+    result = strcmp(batch_word1->word, batch_word2->word);
+    if (result != 0)
+	return result;
+
+    return batch_word1->index - batch_word2->index;
+}
+
+
+/*
+ * Enumerate index entries by word search (`search_code' is
+ * EB_SEARCH_WORD) or endword search (EB_SEARCH_ENDWORD): entries which
+ * begin or end with `input_word'.  `function' is called for each entry
+ * with the index key and the hit, up to `max_entry_count' entries.
+ * The enumeration stops if `function' returns non-zero value.
+ *
+ * It descends the index once by eb_presearch_word(), and then reads
+ * leaf pages in order until an entry doesn't match the word.  Only
+ * index pages are read; heading and text are not read at all.
+ * Search contexts in `book' are not changed.
+ */
+EB_Error_Code
+eb_enumerate_prefix(EB_Book *book, EB_Search_Code search_code,
+    const char *input_word, int max_entry_count,
+    int (*function)(EB_Book *book, void *container, const char *key,
+    size_t key_length, const EB_Hit *hit), void *container)
+{
+    EB_Error_Code error_code;
+    EB_Search_Context context;
+    int entry_count;
+
+    eb_lock(&book->lock);
+    LOG(("in: eb_enumerate_prefix(book=%d, search_code=%d, input_word=%s, \
+max_entry_count=%d)", (int)book->code, (int)search_code,
+	eb_quoted_string(input_word), max_entry_count));
+
+    if (max_entry_count <= 0)
+	goto succeeded;
+
+    /*
+     * Current subbook must have been set.
+     */
+    if (book->subbook_current == NULL) {
+	error_code = EB_ERR_NO_CUR_SUB;
+	goto failed;
+    }
+
+    /*
+     * Set the word, the index page and comparison functions.
+     */
+    if (search_code == EB_SEARCH_WORD)
+	error_code = eb_set_word_context(book, &context, input_word,
+	    EB_INPUT_NATIVE);
+    else if (search_code == EB_SEARCH_ENDWORD)
+	error_code = eb_set_endword_context(book, &context, input_word,
+	    EB_INPUT_NATIVE);
+    else
+	error_code = EB_ERR_NO_SUCH_SEARCH;
+    if (error_code != EB_SUCCESS)
+	goto failed;
+
+    /*
+     * Pre-search, and enumerate entries.
+     */
+    context.cache_page = 0;
+    error_code = eb_presearch_word(book, &context);
+    if (error_code != EB_SUCCESS)
+	goto failed;
+    error_code = eb_enumerate_entries(book, &context, max_entry_count,
+	function, container, 1, &entry_count);
+    if (error_code != EB_SUCCESS)
+	goto failed;
+
+  succeeded:
+    LOG(("out: eb_enumerate_prefix() = %s", eb_error_string(EB_SUCCESS)));
+    eb_unlock(&book->lock);
+    return EB_SUCCESS;
+
+    /*
+     * An error occurs...
+     */
+  failed:
+    LOG(("out: eb_enumerate_prefix() = %s", eb_error_string(error_code)));
+    eb_unlock(&book->lock);
+    return error_code;
+}
+
+
+/*
+ * Enumerate all entries of the index `index_code' in the current subbook.
+ * `function' is called for each entry with the index key and the hit.
+ * The enumeration stops if `function' returns non-zero value.
+ *
+ * Leaf pages are read sequentially from the first leaf page to the end
+ * of the leaf layer, by EB_BULK_INDEX_PAGES pages at once.
+ */
+EB_Error_Code
+eb_foreach_index_entry(EB_Book *book, EB_Index_Code index_code,
+    int (*function)(EB_Book *book, void *container, const char *key,
+    size_t key_length, const EB_Hit *hit), void *container)
+{
+    EB_Error_Code error_code;
+    EB_Subbook *subbook;
+    EB_Search *search;
+    EB_Search_Context context;
+    int entry_count;
+
+    eb_lock(&book->lock);
+    LOG(("in: eb_foreach_index_entry(book=%d, index_code=%d)",
+	(int)book->code, (int)index_code));
+
+    /*
+     * Current subbook must have been set.
+     */
+    subbook = book->subbook_current;
+    if (subbook == NULL) {
+	error_code = EB_ERR_NO_CUR_SUB;
+	goto failed;
+    }
+
+    /*
+     * Get the index.
+     */
+    switch (index_code) {
+    case EB_INDEX_WORD_ALPHABET:
+	search = &subbook->word_alphabet;
+	break;
+    case EB_INDEX_WORD_ASIS:
+	search = &subbook->word_asis;
+	break;
+    case EB_INDEX_WORD_KANA:
+	search = &subbook->word_kana;
+	break;
+    case EB_INDEX_ENDWORD_ALPHABET:
+	search = &subbook->endword_alphabet;
+	break;
+    case EB_INDEX_ENDWORD_ASIS:
+	search = &subbook->endword_asis;
+	break;
+    case EB_INDEX_ENDWORD_KANA:
+	search = &subbook->endword_kana;
+	break;
+    default:
+	error_code = EB_ERR_NO_SUCH_SEARCH;
+	goto failed;
+    }
+    if (search->start_page == 0) {
+	error_code = EB_ERR_NO_SUCH_SEARCH;
+	goto failed;
+    }
+
+    /*
+     * Descend to the first leaf page.  An empty word is not greater
+     * than any key, so that the first entry is chosen in each
+     * intermediate page.
+     */
+    context.code = EB_SEARCH_NONE;
+    context.compare_pre = eb_pre_match_word;
+    context.compare_single = NULL;
+    context.compare_group = NULL;
+    context.word[0] = '\0';
+    context.canonicalized_word[0] = '\0';
+    context.page = search->start_page;
+    context.cache_page = 0;
+
+    error_code = eb_presearch_word(book, &context);
+    if (error_code != EB_SUCCESS)
+	goto failed;
+
+    /*
+     * Enumerate all entries.
+     */
+    error_code = eb_enumerate_entries(book, &context, INT_MAX, function,
+	container, EB_BULK_INDEX_PAGES, &entry_count);
+    if (error_code != EB_SUCCESS)
+	goto failed;
+
+    LOG(("out: eb_foreach_index_entry(entry_count=%d) = %s", entry_count,
+	eb_error_string(EB_SUCCESS)));
+    eb_unlock(&book->lock);
+    return EB_SUCCESS;
+
+    /*
+     * An error occurs...
+     */
+  failed:
+    LOG(("out: eb_foreach_index_entry() = %s", eb_error_string(error_code)));
+    eb_unlock(&book->lock);
+    return error_code;
+}
+
+
+/*
+ * Walk leaf pages of a word index from the current position of
+ * `context', and call `function' for each matched entry, up to
+ * `max_entry_count' entries.  It is used by eb_hit_list_word(),
+ * eb_enumerate_prefix() and eb_foreach_index_entry().
+ * If `context->compare_single' is NULL, all entries are matched.
+ * If `context->compare_group' is NULL, all elements of a matched group
+ * entry are matched.
+ * If `bulk_page_count' is greater than 1, leaf pages are read by
+ * `bulk_page_count' pages at once.
+ * The number of matched entries is put into `entry_count'.
+ */
+static EB_Error_Code
+eb_enumerate_entries(EB_Book *book, EB_Search_Context *context,
+    int max_entry_count, int (*function)(EB_Book *book, void *container,
+    const char *key, size_t key_length, const EB_Hit *hit), void *container,
+    int bulk_page_count, int *entry_count)
+{
+    EB_Error_Code error_code;
+    EB_Hit hit;
+    const char *key;
+    size_t key_length;
     int group_id;
+    int entry_size;
+    int low, high, middle;
+    int stopped;
     char *cache_p;
+    char *bulk_buffer = NULL;
+    int bulk_page = 0;
+    int bulk_count = 0;
+    ssize_t read_length;
 
-    LOG(("in: eb_hit_list_word(book=%d, max_hit_count=%d)", (int)book->code,
-	max_hit_count));
+    LOG(("in: eb_enumerate_entries(book=%d, max_entry_count=%d, \
+bulk_page_count=%d)", (int)book->code, max_entry_count, bulk_page_count));
 
-    hit = hit_list;
-    *hit_count = 0;
+    *entry_count = 0;
+    stopped = 0;
+
+    /*
+     * Allocate a buffer for bulk reading.  If it cannot be allocated,
+     * pages are read one by one.
+     */
+    if (1 < bulk_page_count)
+	bulk_buffer = (char *) malloc((size_t) EB_SIZE_PAGE * bulk_page_count);
 
     /*
      * If the result of previous comparison is negative value, all
      * matched entries have been found.
      */
-    if (context->comparison_result < 0 || max_hit_count <= 0)
+    if (context->comparison_result < 0 || max_entry_count <= 0)
 	goto succeeded;
 
     for (;;) {
 	/*
-	 * Read a page to search, if the page is not on the cache buffer.
+	 * Read a page to enumerate, if the page is not on the cache
+	 * buffer.  In bulk reading, the page is copied from the bulk
+	 * buffer, and the buffer is filled with the following pages
+	 * when the page is not in it.
 	 *
 	 * Cache may be missed by the two reasons:
 	 *   1. the search process reaches to the end of an index page,
 	 *      and tries to read the next page.
-	 *   2. Someone else used the cache buffer.
+	 *   2. The cache buffer has been discarded.
 	 *
 	 * At the case of 1, the search process reads the page and update
 	 * the search context.  At the case of 2. it reads the page but
 	 * must not update the context!
 	 */
-	if (cache_book_code != book->code || cache_page != context->page) {
-	    if (zio_lseek(&book->subbook_current->text_zio,
-		((off_t) context->page - 1) * EB_SIZE_PAGE, SEEK_SET) < 0) {
-		error_code = EB_ERR_FAIL_SEEK_TEXT;
-		goto failed;
-	    }
-	    if (zio_read(&book->subbook_current->text_zio,
-		cache_buffer, EB_SIZE_PAGE) != EB_SIZE_PAGE) {
+	if (context->cache_page != context->page) {
+	    if (bulk_buffer != NULL) {
+		if (context->page < bulk_page
+		    || bulk_page + bulk_count <= context->page) {
+		    read_length = zio_pread(&book->subbook_current->text_zio,
+			((off_t) context->page - 1) * EB_SIZE_PAGE,
+			bulk_buffer, (size_t) EB_SIZE_PAGE * bulk_page_count);
+		    if (read_length < EB_SIZE_PAGE) {
+			bulk_count = 0;
+			error_code = EB_ERR_FAIL_READ_TEXT;
+			goto failed;
+		    }
+		    bulk_page = context->page;
+		    bulk_count = read_length / EB_SIZE_PAGE;
+		}
+		memcpy(context->cache_buffer, bulk_buffer
+		    + (size_t) (context->page - bulk_page) * EB_SIZE_PAGE,
+		    EB_SIZE_PAGE);
+	    } else if (zio_pread(&book->subbook_current->text_zio,
+		((off_t) context->page - 1) * EB_SIZE_PAGE,
+		context->cache_buffer, EB_SIZE_PAGE) != EB_SIZE_PAGE) {
 		error_code = EB_ERR_FAIL_READ_TEXT;
 		goto failed;
 	    }
@@ -619,24 +1180,23 @@ eb_hit_list_word(EB_Book *book, EB_Search_Context *context, int max_hit_count,
 	     * Update search context.
 	     */
 	    if (context->entry_index == 0) {
-		context->page_id = eb_uint1(cache_buffer);
-		context->entry_length = eb_uint1(cache_buffer + 1);
+		context->page_id = eb_uint1(context->cache_buffer);
+		context->entry_length = eb_uint1(context->cache_buffer + 1);
 		if (context->entry_length == 0)
 		    context->entry_arrangement = EB_ARRANGE_VARIABLE;
 		else
 		    context->entry_arrangement = EB_ARRANGE_FIXED;
-		context->entry_count = eb_uint2(cache_buffer + 2);
+		context->entry_count = eb_uint2(context->cache_buffer + 2);
 		context->entry_index = 0;
 		context->offset = 4;
 	    }
 
-	    cache_book_code = book->code;
-	    cache_page = context->page;
+	    context->cache_page = context->page;
 	}
 
-	cache_p = cache_buffer + context->offset;
+	cache_p = context->cache_buffer + context->offset;
 
-	LOG(("aux: eb_hit_list_word(page=%d, page_id=0x%02x, \
+	LOG(("aux: eb_enumerate_entries(page=%d, page_id=0x%02x, \
 entry_length=%d, entry_arrangement=%d, entry_count=%d)",
 	    context->page, context->page_id, context->entry_length,
 	    context->entry_arrangement, context->entry_count));
@@ -653,8 +1213,31 @@ entry_length=%d, entry_arrangement=%d, entry_count=%d)",
 	    && context->entry_arrangement == EB_ARRANGE_FIXED) {
 	    /*
 	     * The leaf index doesn't have a group entry.
-	     * Find text and heading locations.
+	     * Skip entries less than the word by binary search, while
+	     * no entry has matched yet.
 	     */
+	    if (context->compare_single != NULL
+		&& 0 < context->comparison_result) {
+		entry_size = context->entry_length + 12;
+		low = context->entry_index;
+		high = context->entry_index
+		    + (EB_SIZE_PAGE - context->offset) / entry_size;
+		if (context->entry_count < high)
+		    high = context->entry_count;
+		while (low < high) {
+		    middle = (low + high) / 2;
+		    if (context->compare_single(context->word, cache_p
+			+ (middle - context->entry_index) * entry_size,
+			context->entry_length) <= 0)
+			high = middle;
+		    else
+			low = middle + 1;
+		}
+		cache_p += (low - context->entry_index) * entry_size;
+		context->offset += (low - context->entry_index) * entry_size;
+		context->entry_index = low;
+	    }
+
 	    while (context->entry_index < context->entry_count) {
 		if (EB_SIZE_PAGE
 		    < context->offset + context->entry_length + 12) {
@@ -662,40 +1245,43 @@ entry_length=%d, entry_arrangement=%d, entry_count=%d)",
 		    goto failed;
 		}
 
-		/*
-		 * Compare word and pattern.
-		 * If matched, add it to a hit list.
-		 */
-		context->comparison_result
-		    = context->compare_single(context->word, cache_p,
-			context->entry_length);
+		if (context->compare_single != NULL) {
+		    context->comparison_result
+			= context->compare_single(context->word, cache_p,
+			    context->entry_length);
+		} else {
+		    context->comparison_result = 0;
+		}
 		if (context->comparison_result == 0) {
-		    hit->heading.page
+		    key = cache_p;
+		    key_length = context->entry_length;
+		    hit.heading.page
 			= eb_uint4(cache_p + context->entry_length + 6);
-		    hit->heading.offset
+		    hit.heading.offset
 			= eb_uint2(cache_p + context->entry_length + 10);
-		    hit->text.page
+		    hit.text.page
 			= eb_uint4(cache_p + context->entry_length);
-		    hit->text.offset
+		    hit.text.offset
 			= eb_uint2(cache_p + context->entry_length + 4);
-		    hit++;
-		    *hit_count += 1;
+		    while (0 < key_length && key[key_length - 1] == '\0')
+			key_length--;
+		    *entry_count += 1;
+		    if (function(book, container, key, key_length, &hit) != 0)
+			stopped = 1;
 		}
 		context->entry_index++;
 		context->offset += context->entry_length + 12;
 		cache_p += context->entry_length + 12;
 
-		if (context->comparison_result < 0
-		    || max_hit_count <= *hit_count)
+		if (context->comparison_result < 0 || stopped
+		    || max_entry_count <= *entry_count)
 		    goto succeeded;
 	    }
 
 	} else if (!PAGE_ID_HAVE_GROUP_ENTRY(context->page_id)
 	    && context->entry_arrangement == EB_ARRANGE_VARIABLE) {
-
 	    /*
 	     * The leaf index doesn't have a group entry.
-	     * Find text and heading locations.
 	     */
 	    while (context->entry_index < context->entry_count) {
 		if (EB_SIZE_PAGE < context->offset + 1) {
@@ -709,38 +1295,40 @@ entry_length=%d, entry_arrangement=%d, entry_count=%d)",
 		    goto failed;
 		}
 
-		/*
-		 * Compare word and pattern.
-		 * If matched, add it to a hit list.
-		 */
-		context->comparison_result
-		    = context->compare_single(context->word, cache_p + 1,
-			context->entry_length);
+		if (context->compare_single != NULL) {
+		    context->comparison_result
+			= context->compare_single(context->word, cache_p + 1,
+			    context->entry_length);
+		} else {
+		    context->comparison_result = 0;
+		}
 		if (context->comparison_result == 0) {
-		    hit->heading.page
+		    key = cache_p + 1;
+		    key_length = context->entry_length;
+		    hit.heading.page
 			= eb_uint4(cache_p + context->entry_length + 7);
-		    hit->heading.offset
+		    hit.heading.offset
 			= eb_uint2(cache_p + context->entry_length + 11);
-		    hit->text.page
+		    hit.text.page
 			= eb_uint4(cache_p + context->entry_length + 1);
-		    hit->text.offset
+		    hit.text.offset
 			= eb_uint2(cache_p + context->entry_length + 5);
-		    hit++;
-		    *hit_count += 1;
+		    *entry_count += 1;
+		    if (function(book, container, key, key_length, &hit) != 0)
+			stopped = 1;
 		}
 		context->entry_index++;
 		context->offset += context->entry_length + 13;
 		cache_p += context->entry_length + 13;
 
-		if (context->comparison_result < 0
-		    || max_hit_count <= *hit_count)
+		if (context->comparison_result < 0 || stopped
+		    || max_entry_count <= *entry_count)
 		    goto succeeded;
 	    }
 
 	} else {
 	    /*
 	     * The leaf index have a group entry.
-	     * Find text and heading locations.
 	     */
 	    while (context->entry_index < context->entry_count) {
 		if (EB_SIZE_PAGE < context->offset + 2) {
@@ -760,24 +1348,29 @@ entry_length=%d, entry_arrangement=%d, entry_count=%d)",
 			goto failed;
 		    }
 
-		    /*
-		     * Compare word and pattern.
-		     * If matched, add it to a hit list.
-		     */
-		    context->comparison_result
-			= context->compare_single(context->canonicalized_word,
-			    cache_p + 2, context->entry_length);
+		    if (context->compare_single != NULL) {
+			context->comparison_result
+			    = context->compare_single(
+				context->canonicalized_word, cache_p + 2,
+				context->entry_length);
+		    } else {
+			context->comparison_result = 0;
+		    }
 		    if (context->comparison_result == 0) {
-			hit->heading.page
+			key = cache_p + 2;
+			key_length = context->entry_length;
+			hit.heading.page
 			    = eb_uint4(cache_p + context->entry_length + 8);
-			hit->heading.offset
+			hit.heading.offset
 			    = eb_uint2(cache_p + context->entry_length + 12);
-			hit->text.page
+			hit.text.page
 			    = eb_uint4(cache_p + context->entry_length + 2);
-			hit->text.offset
+			hit.text.offset
 			    = eb_uint2(cache_p + context->entry_length + 6);
-			hit++;
-			*hit_count += 1;
+			*entry_count += 1;
+			if (function(book, container, key, key_length, &hit)
+			    != 0)
+			    stopped = 1;
 		    }
 		    context->in_group_entry = 0;
 		    context->offset += context->entry_length + 14;
@@ -793,41 +1386,48 @@ entry_length=%d, entry_arrangement=%d, entry_count=%d)",
 			error_code = EB_ERR_UNEXP_TEXT;
 			goto failed;
 		    }
-		    context->comparison_result
-			= context->compare_single(context->canonicalized_word,
-			    cache_p + 4, context->entry_length);
+		    if (context->compare_single != NULL) {
+			context->comparison_result
+			    = context->compare_single(
+				context->canonicalized_word, cache_p + 4,
+				context->entry_length);
+		    } else {
+			context->comparison_result = 0;
+		    }
 		    context->in_group_entry = 1;
 		    cache_p += context->entry_length + 4;
 		    context->offset += context->entry_length + 4;
 
 		} else if (group_id == 0xc0) {
 		    /*
-		     * Element of the group entry
+		     * Element of the group entry.
 		     */
 		    context->entry_length = eb_uint1(cache_p + 1);
-		    if (EB_SIZE_PAGE < context->offset + 14) {
+		    if (EB_SIZE_PAGE
+			< context->offset + context->entry_length + 14) {
 			error_code = EB_ERR_UNEXP_TEXT;
 			goto failed;
 		    }
 
-		    /*
-		     * Compare word and pattern.
-		     * If matched, add it to a hit list.
-		     */
 		    if (context->comparison_result == 0
 			&& context->in_group_entry
-			&& context->compare_group(context->word, cache_p + 2,
-			    context->entry_length) == 0) {
-			hit->heading.page
+			&& (context->compare_group == NULL
+			    || context->compare_group(context->word,
+				cache_p + 2, context->entry_length) == 0)) {
+			key = cache_p + 2;
+			key_length = context->entry_length;
+			hit.heading.page
 			    = eb_uint4(cache_p + context->entry_length + 8);
-			hit->heading.offset
+			hit.heading.offset
 			    = eb_uint2(cache_p + context->entry_length + 12);
-			hit->text.page
+			hit.text.page
 			    = eb_uint4(cache_p + context->entry_length + 2);
-			hit->text.offset
+			hit.text.offset
 			    = eb_uint2(cache_p + context->entry_length + 6);
-			hit++;
-			*hit_count += 1;
+			*entry_count += 1;
+			if (function(book, container, key, key_length, &hit)
+			    != 0)
+			    stopped = 1;
 		    }
 		    context->offset += context->entry_length + 14;
 		    cache_p += context->entry_length + 14;
@@ -841,8 +1441,8 @@ entry_length=%d, entry_arrangement=%d, entry_count=%d)",
 		}
 
 		context->entry_index++;
-		if (context->comparison_result < 0
-		    || max_hit_count <= *hit_count)
+		if (context->comparison_result < 0 || stopped
+		    || max_entry_count <= *entry_count)
 		    goto succeeded;
 	    }
 	}
@@ -859,8 +1459,10 @@ entry_length=%d, entry_arrangement=%d, entry_count=%d)",
     }
 
   succeeded:
-    LOG(("out: eb_hit_list_word(hit_count=%d) = %s",
-	*hit_count, eb_error_string(EB_SUCCESS)));
+    if (bulk_buffer != NULL)
+	free(bulk_buffer);
+    LOG(("out: eb_enumerate_entries(entry_count=%d) = %s",
+	*entry_count, eb_error_string(EB_SUCCESS)));
     return EB_SUCCESS;
 
     /*
@@ -869,7 +1471,62 @@ entry_length=%d, entry_arrangement=%d, entry_count=%d)",
      */
   failed:
     if (error_code == EB_ERR_FAIL_READ_TEXT)
-	cache_book_code = EB_BOOK_NONE;
+	context->cache_page = 0;
+    if (bulk_buffer != NULL)
+	free(bulk_buffer);
+    LOG(("out: eb_enumerate_entries() = %s", eb_error_string(error_code)));
+    return error_code;
+}
+
+
+/*
+ * Add `hit' to the hit list.  `container' points to the pointer to the
+ * next element of the list.  It is called by eb_enumerate_entries()
+ * for eb_hit_list_word().
+ */
+static int
+eb_collect_hit(EB_Book *book, void *container, const char *key,
+    size_t key_length, const EB_Hit *hit)
+{
+    EB_Hit **hit_p = (EB_Hit **) container;
+
+    (void) book;
+    (void) key;
+    (void) key_length;
+
+    **hit_p = *hit;
+    (*hit_p)++;
+    return 0;
+}
+
+
+/*
+ * Get hit entries of a submitted exactword/word/endword search request.
+ */
+static EB_Error_Code
+eb_hit_list_word(EB_Book *book, EB_Search_Context *context, int max_hit_count,
+    EB_Hit *hit_list, int *hit_count)
+{
+    EB_Error_Code error_code;
+    EB_Hit *hit;
+
+    LOG(("in: eb_hit_list_word(book=%d, max_hit_count=%d)", (int)book->code,
+	max_hit_count));
+
+    hit = hit_list;
+    error_code = eb_enumerate_entries(book, context, max_hit_count,
+	eb_collect_hit, &hit, 1, hit_count);
+    if (error_code != EB_SUCCESS)
+	goto failed;
+
+    LOG(("out: eb_hit_list_word(hit_count=%d) = %s",
+	*hit_count, eb_error_string(EB_SUCCESS)));
+    return EB_SUCCESS;
+
+    /*
+     * An error occurs...
+     */
+  failed:
     *hit_count = 0;
     LOG(("out: eb_hit_list_word() = %s", eb_error_string(error_code)));
     return error_code;
@@ -923,20 +1580,16 @@ eb_hit_list_keyword(EB_Book *book, EB_Search_Context *context,
 	 * Cache may be missed by the two reasons:
 	 *   1. the search process reaches to the end of an index page,
 	 *      and tries to read the next page.
-	 *   2. Someone else used the cache buffer.
+	 *   2. The cache buffer has been discarded.
 	 *
 	 * At the case of 1, the search process reads the page and update
 	 * the search context.  At the case of 2. it reads the page but
 	 * must not update the context!
 	 */
-	if (cache_book_code != book->code || cache_page != context->page) {
-	    if (zio_lseek(&book->subbook_current->text_zio,
-		((off_t) context->page - 1) * EB_SIZE_PAGE, SEEK_SET) < 0) {
-		error_code = EB_ERR_FAIL_SEEK_TEXT;
-		goto failed;
-	    }
-	    if (zio_read(&book->subbook_current->text_zio, cache_buffer,
-		EB_SIZE_PAGE) != EB_SIZE_PAGE) {
+	if (context->cache_page != context->page) {
+	    if (zio_pread(&book->subbook_current->text_zio,
+		((off_t) context->page - 1) * EB_SIZE_PAGE,
+		context->cache_buffer, EB_SIZE_PAGE) != EB_SIZE_PAGE) {
 		error_code = EB_ERR_FAIL_READ_TEXT;
 		goto failed;
 	    }
@@ -945,22 +1598,21 @@ eb_hit_list_keyword(EB_Book *book, EB_Search_Context *context,
 	     * Update search context.
 	     */
 	    if (context->entry_index == 0) {
-		context->page_id = eb_uint1(cache_buffer);
-		context->entry_length = eb_uint1(cache_buffer + 1);
+		context->page_id = eb_uint1(context->cache_buffer);
+		context->entry_length = eb_uint1(context->cache_buffer + 1);
 		if (context->entry_length == 0)
 		    context->entry_arrangement = EB_ARRANGE_VARIABLE;
 		else
 		    context->entry_arrangement = EB_ARRANGE_FIXED;
-		context->entry_count = eb_uint2(cache_buffer + 2);
+		context->entry_count = eb_uint2(context->cache_buffer + 2);
 		context->entry_index = 0;
 		context->offset = 4;
 	    }
 
-	    cache_book_code = book->code;
-	    cache_page = context->page;
+	    context->cache_page = context->page;
 	}
 
-	cache_p = cache_buffer + context->offset;
+	cache_p = context->cache_buffer + context->offset;
 
 	LOG(("aux: eb_hit_list_keyword(page=%d, page_id=0x%02x, \
 entry_length=%d, entry_arrangement=%d, entry_count=%d)",
@@ -1215,7 +1867,7 @@ entry_length=%d, entry_arrangement=%d, entry_count=%d)",
      */
   failed:
     if (error_code == EB_ERR_FAIL_READ_TEXT)
-	cache_book_code = EB_BOOK_NONE;
+	context->cache_page = 0;
     *hit_count = 0;
     memcpy(&book->text_context, &text_context, sizeof(EB_Text_Context));
     LOG(("out: eb_hit_list_keyword() = %s", eb_error_string(error_code)));
@@ -1255,20 +1907,16 @@ eb_hit_list_multi(EB_Book *book, EB_Search_Context *context, int max_hit_count,
 	 * Cache may be missed by the two reasons:
 	 *   1. the search process reaches to the end of an index page,
 	 *      and tries to read the next page.
-	 *   2. Someone else used the cache buffer.
+	 *   2. The cache buffer has been discarded.
 	 *
 	 * At the case of 1, the search process reads the page and update
 	 * the search context.  At the case of 2. it reads the page but
 	 * must not update the context!
 	 */
-	if (cache_book_code != book->code || cache_page != context->page) {
-	    if (zio_lseek(&book->subbook_current->text_zio,
-		((off_t) context->page - 1) * EB_SIZE_PAGE, SEEK_SET) < 0) {
-		error_code = EB_ERR_FAIL_SEEK_TEXT;
-		goto failed;
-	    }
-	    if (zio_read(&book->subbook_current->text_zio, cache_buffer,
-		EB_SIZE_PAGE) != EB_SIZE_PAGE) {
+	if (context->cache_page != context->page) {
+	    if (zio_pread(&book->subbook_current->text_zio,
+		((off_t) context->page - 1) * EB_SIZE_PAGE,
+		context->cache_buffer, EB_SIZE_PAGE) != EB_SIZE_PAGE) {
 		error_code = EB_ERR_FAIL_READ_TEXT;
 		goto failed;
 	    }
@@ -1277,22 +1925,21 @@ eb_hit_list_multi(EB_Book *book, EB_Search_Context *context, int max_hit_count,
 	     * Update search context.
 	     */
 	    if (context->entry_index == 0) {
-		context->page_id = eb_uint1(cache_buffer);
-		context->entry_length = eb_uint1(cache_buffer + 1);
+		context->page_id = eb_uint1(context->cache_buffer);
+		context->entry_length = eb_uint1(context->cache_buffer + 1);
 		if (context->entry_length == 0)
 		    context->entry_arrangement = EB_ARRANGE_VARIABLE;
 		else
 		    context->entry_arrangement = EB_ARRANGE_FIXED;
-		context->entry_count = eb_uint2(cache_buffer + 2);
+		context->entry_count = eb_uint2(context->cache_buffer + 2);
 		context->entry_index = 0;
 		context->offset = 4;
 	    }
 
-	    cache_book_code = book->code;
-	    cache_page = context->page;
+	    context->cache_page = context->page;
 	}
 
-	cache_p = cache_buffer + context->offset;
+	cache_p = context->cache_buffer + context->offset;
 
 	LOG(("aux: eb_hit_list_multi(page=%d, page_id=0x%02x, \
 entry_length=%d, entry_arrangement=%d, entry_count=%d)",
@@ -1519,7 +2166,7 @@ entry_length=%d, entry_arrangement=%d, entry_count=%d)",
      */
   failed:
     if (error_code == EB_ERR_FAIL_READ_TEXT)
-	cache_book_code = EB_BOOK_NONE;
+	context->cache_page = 0;
     *hit_count = 0;
     LOG(("out: eb_hit_list_multi() = %s", eb_error_string(error_code)));
     return error_code;
@@ -1527,130 +2174,223 @@ entry_length=%d, entry_arrangement=%d, entry_count=%d)",
 
 
 /*
- * Do AND operation of hit lists.
- * and_list = hit_lists[0] AND hit_lists[1] AND ...
+ * Do AND operation of hit lists of the first `context_count' search
+ * contexts in `book'.
+ *
+ * Each search context keeps hits read from its index in its hit
+ * buffer, and the buffer grows while the list is read.  Hits common
+ * to all the lists are found by leapfrogging: the greatest text
+ * position among the current hits is the target, and the other lists
+ * skip hits less than the target by galloping search.  So a list with
+ * many hits is skipped in large steps by a list with few hits.
+ * Hits not returned remain in the buffers for the next call.
  */
-static void
-eb_and_hit_lists(EB_Hit and_list[EB_TMP_MAX_HITS], int *and_count,
-    int max_and_count, int hit_list_count,
-    EB_Hit hit_lists[EB_NUMBER_OF_SEARCH_CONTEXTS][EB_TMP_MAX_HITS],
-    int hit_counts[EB_NUMBER_OF_SEARCH_CONTEXTS])
+static EB_Error_Code
+eb_and_hit_lists(EB_Book *book, int context_count, int max_hit_count,
+    EB_Hit *hit_list, int *hit_count)
 {
-    int hit_indexes[EB_NUMBER_OF_SEARCH_CONTEXTS];
-    int greatest_list;
-    int greatest_page;
-    int greatest_offset;
-    int current_page;
-    int current_offset;
-    int equal_count;
-    int increment_count;
+    EB_Error_Code error_code;
+    EB_Search_Context *context;
+    EB_Position target;
+    EB_Position *position;
+    int match_count;
     int i;
 
-    LOG(("in: eb_and_hit_lists(max_and_count=%d, hit_list_count=%d)",
-	max_and_count, hit_list_count));
+    LOG(("in: eb_and_hit_lists(context_count=%d, max_hit_count=%d)",
+	context_count, max_hit_count));
 
-    /*
-     * Initialize indexes for the hit_lists[].
-     */
-    for (i = 0; i < hit_list_count; i++)
-	hit_indexes[i] = 0;
+    *hit_count = 0;
+    if (context_count == 0)
+	goto succeeded;
 
-    /*
-     * Generate the new list `and_list'.
-     */
-    *and_count = 0;
-    while (*and_count < max_and_count) {
+    while (*hit_count < max_hit_count) {
 	/*
-	 * Initialize variables.
+	 * The current hit of the first list is the initial target.
 	 */
-	greatest_list = -1;
-	greatest_page = 0;
-	greatest_offset = 0;
-	current_page = 0;
-	current_offset = 0;
-	equal_count = 0;
+	context = book->search_contexts;
+	error_code = eb_fill_hit_buffer(book, context);
+	if (error_code != EB_SUCCESS)
+	    goto failed;
+	if (context->hit_count <= context->hit_index)
+	    goto succeeded;
+	target = context->hits[context->hit_index].text;
+	match_count = 1;
 
 	/*
-	 * Compare the current elements of the lists.
+	 * Skip hits less than the target in the lists in turn, until
+	 * the current hits of all the lists point to the target.
 	 */
-	for (i = 0; i < hit_list_count; i++) {
-	    /*
-	     * If we have been reached to the tail of the hit_lists[i],
-	     * skip the list.
-	     */
-	    if (hit_counts[i] <= hit_indexes[i])
-		continue;
-
-	    /*
-	     * Compare {current_page, current_offset} and {greatest_page,
-	     * greatest_offset}.
-	     */
-	    current_page = hit_lists[i][hit_indexes[i]].text.page;
-	    current_offset = hit_lists[i][hit_indexes[i]].text.offset;
-
-	    if (greatest_list == -1) {
-		greatest_page = current_page;
-		greatest_offset = current_offset;
-		greatest_list = i;
-		equal_count++;
-	    } else if (greatest_page < current_page) {
-		greatest_page = current_page;
-		greatest_offset = current_offset;
-		greatest_list = i;
-	    } else if (current_page == greatest_page
-		&& greatest_offset < current_offset) {
-		greatest_page = current_page;
-		greatest_offset = current_offset;
-		greatest_list = i;
-	    } else if (current_page == greatest_page
-		&& current_offset == greatest_offset) {
-		equal_count++;
+	i = 1 % context_count;
+	while (match_count < context_count) {
+	    context = book->search_contexts + i;
+	    error_code = eb_seek_hit_buffer(book, context, &target);
+	    if (error_code != EB_SUCCESS)
+		goto failed;
+	    if (context->hit_count <= context->hit_index)
+		goto succeeded;
+
+	    position = &context->hits[context->hit_index].text;
+	    if (eb_compare_positions(position, &target) == 0) {
+		match_count++;
+	    } else {
+		target = *position;
+		match_count = 1;
 	    }
+	    i = (i + 1) % context_count;
 	}
 
-	if (equal_count == hit_list_count) {
-	    /*
-	     * All the current elements of the lists point to the same
-	     * position.  This is hit element.  Increase indexes of all
-	     * lists.
-	     */
-	    memcpy(and_list + *and_count, hit_lists[0] + hit_indexes[0],
-		sizeof(EB_Hit));
-	    *and_count += 1;
-	    for (i = 0; i < hit_list_count; i++) {
-		if (hit_counts[i] <= hit_indexes[i])
-		    continue;
-		hit_indexes[i]++;
-	    }
-	} else {
-	    /*
-	     * This is not hit element.  Increase indexes of all lists
-	     * except for greatest element(s).  If there is no list
-	     * whose index is incremented, our job has been completed.
-	     */
-	    increment_count = 0;
-	    for (i = 0; i < hit_list_count; i++) {
-		if (hit_counts[i] <= hit_indexes[i])
-		    continue;
-		current_page = hit_lists[i][hit_indexes[i]].text.page;
-		current_offset = hit_lists[i][hit_indexes[i]].text.offset;
-		if (current_page != greatest_page
-		    || current_offset != greatest_offset) {
-		    hit_indexes[i]++;
-		    increment_count++;
-		}
-	    }
-	    if (increment_count == 0)
-		break;
+	/*
+	 * This is hit element.  Consume the current hits of all lists.
+	 */
+	context = book->search_contexts;
+	memcpy(hit_list + *hit_count, context->hits + context->hit_index,
+	    sizeof(EB_Hit));
+	*hit_count += 1;
+	for (i = 0; i < context_count; i++)
+	    book->search_contexts[i].hit_index++;
+    }
+
+  succeeded:
+    LOG(("out: eb_and_hit_lists(hit_count=%d) = %s", *hit_count,
+	eb_error_string(EB_SUCCESS)));
+    return EB_SUCCESS;
+
+    /*
+     * An error occurs...
+     */
+  failed:
+    *hit_count = 0;
+    LOG(("out: eb_and_hit_lists() = %s", eb_error_string(error_code)));
+    return error_code;
+}
+
+
+/*
+ * Make the hit buffer of `context' have a hit not consumed yet, by
+ * reading more hits from the index of the keyword, cross or multi
+ * search.  The buffer is doubled at every refill, up to
+ * EB_MAX_BUFFERED_HITS hits.
+ * If no hit remains in the buffer after the call, all the hits of
+ * `context' have been consumed.
+ */
+static EB_Error_Code
+eb_fill_hit_buffer(EB_Book *book, EB_Search_Context *context)
+{
+    EB_Error_Code error_code;
+    EB_Hit *new_hits;
+    int new_max_hit_count;
+
+    if (context->hit_index < context->hit_count)
+	return EB_SUCCESS;
+
+    /*
+     * Grow the buffer.
+     */
+    if (context->max_hit_count < EB_MAX_BUFFERED_HITS) {
+	if (context->max_hit_count == 0)
+	    new_max_hit_count = EB_MIN_BUFFERED_HITS;
+	else
+	    new_max_hit_count = context->max_hit_count * 2;
+	new_hits = (EB_Hit *) realloc(context->hits,
+	    sizeof(EB_Hit) * new_max_hit_count);
+	if (new_hits != NULL) {
+	    context->hits = new_hits;
+	    context->max_hit_count = new_max_hit_count;
+	} else if (context->hits == NULL) {
+	    return EB_ERR_MEMORY_EXHAUSTED;
 	}
     }
 
     /*
-     * Update hit_counts[].
-     * The hit counts of the lists are set to the current indexes.
+     * Read hits.
      */
-    for (i = 0; i < hit_list_count; i++)
-	hit_counts[i] = hit_indexes[i];
+    context->hit_count = 0;
+    context->hit_index = 0;
+    if (context->code == EB_SEARCH_MULTI) {
+	error_code = eb_hit_list_multi(book, context, context->max_hit_count,
+	    context->hits, &context->hit_count);
+    } else {
+	error_code = eb_hit_list_keyword(book, context,
+	    context->max_hit_count, context->hits, &context->hit_count);
+    }
 
-    LOG(("out: eb_and_hit_lists(and_count=%d)", *and_count));
+    return error_code;
+}
+
+
+/*
+ * Skip hits in the hit buffer of `context' whose text positions are
+ * less than `position', reading more hits if needed.
+ * The first hit not less than `position' is found by galloping search
+ * from the current hit, that is, by doubling the step and then binary
+ * search.
+ * If no hit remains in the buffer after the call, all the hits of
+ * `context' have been consumed.
+ */
+static EB_Error_Code
+eb_seek_hit_buffer(EB_Book *book, EB_Search_Context *context,
+    const EB_Position *position)
+{
+    EB_Error_Code error_code;
+    int low, high, middle;
+    int step;
+
+    /*
+     * Skip the whole buffer while the last hit is less than `position'.
+     */
+    for (;;) {
+	error_code = eb_fill_hit_buffer(book, context);
+	if (error_code != EB_SUCCESS)
+	    return error_code;
+	if (context->hit_count <= context->hit_index)
+	    return EB_SUCCESS;
+	if (eb_compare_positions(&context->hits[context->hit_count - 1].text,
+	    position) >= 0)
+	    break;
+	context->hit_index = context->hit_count;
+    }
+
+    /*
+     * Gallop.  The last hit in the buffer is not less than `position'.
+     */
+    low = context->hit_index;
+    high = context->hit_index;
+    step = 1;
+    while (eb_compare_positions(&context->hits[high].text, position) < 0) {
+	low = high + 1;
+	high += step;
+	step *= 2;
+	if (context->hit_count - 1 <= high) {
+	    high = context->hit_count - 1;
+	    break;
+	}
+    }
+
+    while (low < high) {
+	middle = (low + high) / 2;
+	if (eb_compare_positions(&context->hits[middle].text, position) < 0)
+	    low = middle + 1;
+	else
+	    high = middle;
+    }
+    context->hit_index = low;
+
+    return EB_SUCCESS;
+}
+
+
+/*
+ * Compare two positions.
+ * It returns a negative, zero or positive value if `position1' is
+ * less than, equal to or greater than `position2'.
+ */
+static int
+eb_compare_positions(const EB_Position *position1,
+    const EB_Position *position2)
+{
+    if (position1->page != position2->page)
+	return (position1->page < position2->page) ? -1 : 1;
+    if (position1->offset != position2->offset)
+	return (position1->offset < position2->offset) ? -1 : 1;
+    return 0;
 }
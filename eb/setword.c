@@ -36,38 +36,34 @@
  */
 static void eb_fix_word(EB_Book *book, const EB_Search *search, char *word,
     char *canonicalized_word);
+static EB_Error_Code eb_convert_word(EB_Book *book, const char *input_word,
+    int input_encoding, char *word, EB_Word_Code *word_code);
 static EB_Error_Code eb_convert_latin(EB_Book *book, const char *input_word,
     char *word, EB_Word_Code *word_code);
+static EB_Error_Code eb_convert_utf8_latin(EB_Book *book,
+    const char *input_word, char *word, EB_Word_Code *word_code);
 static EB_Error_Code eb_convert_euc_jp(EB_Book *book, const char *input_word,
     char *word, EB_Word_Code *word_code);
-static void eb_convert_katakana_jis(char *word);
-static void eb_convert_hiragana_jis(char *word);
-static void eb_convert_lower_latin(char *word);
-static void eb_convert_lower_jis(char *word);
-static void eb_delete_marks_jis(char *word);
-static void eb_convert_long_vowels_jis(char *word);
-static void eb_delete_long_vowels_jis(char *word);
-static void eb_convert_double_consonants_jis(char *word);
-static void eb_convert_contracted_sounds_jis(char *word);
-static void eb_convert_small_vowels_jis(char *word);
-static void eb_convert_voiced_consonants_jis(char *word);
-static void eb_convert_p_sounds_jis(char *word);
-static void eb_delete_spaces_latin(char *word);
-static void eb_delete_spaces_jis(char *word);
+static EB_Error_Code eb_convert_utf8(EB_Book *book, const char *input_word,
+    char *word, EB_Word_Code *word_code);
+static void eb_fix_word_latin(int fix_flags, char *word);
+static void eb_fix_word_jis(const EB_Search *search, char *word);
 static void eb_reverse_word_latin(char *word);
 static void eb_reverse_word_jis(char *word);
 
 
 /*
  * Make a fixed word and a cannonicalized word for `WORD SEARCH'.
+ * `input_word' is encoded in `input_encoding' (EB_INPUT_NATIVE or
+ * EB_INPUT_UTF8).
  *
  * If `inputword' is a KANA word,  EB_WORD_KANA is returned.
  * If `inputword' is a alphabetic word, EB_WORD_ALPHABET is returned.
  * Otherwise, -1 is returned.  It means that an error occurs.
  */
 EB_Error_Code
-eb_set_word(EB_Book *book, const char *input_word, char *word,
-    char *canonicalized_word, EB_Word_Code *word_code)
+eb_set_word(EB_Book *book, const char *input_word, int input_encoding,
+    char *word, char *canonicalized_word, EB_Word_Code *word_code)
 {
     EB_Error_Code error_code;
     const EB_Search *search;
@@ -78,10 +74,8 @@ eb_set_word(EB_Book *book, const char *input_word, char *word,
     /*
      * Make a fixed word and a canonicalized word from `input_word'.
      */
-    if (book->character_code == EB_CHARCODE_ISO8859_1)
-	error_code = eb_convert_latin(book, input_word, word, word_code);
-    else
-	error_code = eb_convert_euc_jp(book, input_word, word, word_code);
+    error_code = eb_convert_word(book, input_word, input_encoding, word,
+	word_code);
     if (error_code != EB_SUCCESS)
 	goto failed;
     strcpy(canonicalized_word, word);
@@ -151,14 +145,16 @@ eb_set_word(EB_Book *book, const char *input_word, char *word,
 
 /*
  * Make a fixed word and a cannonicalized word for `ENDWORD SEARCH'.
+ * `input_word' is encoded in `input_encoding' (EB_INPUT_NATIVE or
+ * EB_INPUT_UTF8).
  *
  * If `input_word' is a KANA word,  EB_WORD_KANA is retuend.
  * If `input_word' is a alphabetic word,  EB_WORD_ALPHABET is retuend.
  * Otherwise, -1 is returned.  It means that an error occurs.
  */
 EB_Error_Code
-eb_set_endword(EB_Book *book, const char *input_word, char *word,
-    char *canonicalized_word, EB_Word_Code *word_code)
+eb_set_endword(EB_Book *book, const char *input_word, int input_encoding,
+    char *word, char *canonicalized_word, EB_Word_Code *word_code)
 {
     EB_Error_Code error_code;
     const EB_Search *search;
@@ -169,10 +165,8 @@ eb_set_endword(EB_Book *book, const char *input_word, char *word,
     /*
      * Make a fixed word and a canonicalized word from `input_word'.
      */
-    if (book->character_code == EB_CHARCODE_ISO8859_1)
-	error_code = eb_convert_latin(book, input_word, word, word_code);
-    else
-	error_code = eb_convert_euc_jp(book, input_word, word, word_code);
+    error_code = eb_convert_word(book, input_word, input_encoding, word,
+	word_code);
     if (error_code != EB_SUCCESS)
 	goto failed;
     strcpy(canonicalized_word, word);
@@ -272,10 +266,8 @@ eb_set_keyword(EB_Book *book, const char *input_word, char *word,
     /*
      * Make a fixed word and a canonicalized word from `input_word'.
      */
-    if (book->character_code == EB_CHARCODE_ISO8859_1)
-	error_code = eb_convert_latin(book, input_word, word, word_code);
-    else
-	error_code = eb_convert_euc_jp(book, input_word, word, word_code);
+    error_code = eb_convert_word(book, input_word, EB_INPUT_NATIVE, word,
+	word_code);
     if (error_code != EB_SUCCESS)
 	goto failed;
     strcpy(canonicalized_word, word);
@@ -326,10 +318,8 @@ eb_set_multiword(EB_Book *book, EB_Multi_Search_Code multi_id,
     /*
      * Make a fixed word and a canonicalized word from `input_word'.
      */
-    if (book->character_code == EB_CHARCODE_ISO8859_1)
-	error_code = eb_convert_latin(book, input_word, word, word_code);
-    else
-	error_code = eb_convert_euc_jp(book, input_word, word, word_code);
+    error_code = eb_convert_word(book, input_word, EB_INPUT_NATIVE, word,
+	word_code);
     if (error_code != EB_SUCCESS)
 	goto failed;
     strcpy(canonicalized_word, word);
@@ -361,7 +351,8 @@ eb_set_multiword(EB_Book *book, EB_Multi_Search_Code multi_id,
 
 /*
  * Fix `canonicalized_word' and `word' according with `book->character_code'
- * and `search'.
+ * and `search'.  The index styles of `search' must have been compiled by
+ * eb_compile_search_styles().
  */
 static void
 eb_fix_word(EB_Book *book, const EB_Search *search, char *word,
@@ -375,46 +366,11 @@ eb_fix_word(EB_Book *book, const EB_Search *search, char *word,
 	return;
 
     if (book->character_code == EB_CHARCODE_ISO8859_1) {
-	if (search->space == EB_INDEX_STYLE_DELETE)
-	    eb_delete_spaces_latin(canonicalized_word);
-
-	if (search->lower == EB_INDEX_STYLE_CONVERT)
-	    eb_convert_lower_latin(canonicalized_word);
-
+	if (search->fix_flags & (EB_FIX_DELETE_SPACES | EB_FIX_LOWER))
+	    eb_fix_word_latin(search->fix_flags, canonicalized_word);
     } else {
-	if (search->space == EB_INDEX_STYLE_DELETE)
-	    eb_delete_spaces_jis(canonicalized_word);
-
-	if (search->katakana == EB_INDEX_STYLE_CONVERT)
-	    eb_convert_katakana_jis(canonicalized_word);
-	else if (search->katakana == EB_INDEX_STYLE_REVERSED_CONVERT)
-	    eb_convert_hiragana_jis(canonicalized_word);
-
-	if (search->lower == EB_INDEX_STYLE_CONVERT)
-	    eb_convert_lower_jis(canonicalized_word);
-
-	if (search->mark == EB_INDEX_STYLE_DELETE)
-	    eb_delete_marks_jis(canonicalized_word);
-
-	if (search->long_vowel == EB_INDEX_STYLE_CONVERT)
-	    eb_convert_long_vowels_jis(canonicalized_word);
-	else if (search->long_vowel == EB_INDEX_STYLE_DELETE)
-	    eb_delete_long_vowels_jis(canonicalized_word);
-
-	if (search->double_consonant == EB_INDEX_STYLE_CONVERT)
-	    eb_convert_double_consonants_jis(canonicalized_word);
-
-	if (search->contracted_sound == EB_INDEX_STYLE_CONVERT)
-	    eb_convert_contracted_sounds_jis(canonicalized_word);
-
-	if (search->small_vowel == EB_INDEX_STYLE_CONVERT)
-	    eb_convert_small_vowels_jis(canonicalized_word);
-
-	if (search->voiced_consonant == EB_INDEX_STYLE_CONVERT)
-	    eb_convert_voiced_consonants_jis(canonicalized_word);
-
-	if (search->p_sound == EB_INDEX_STYLE_CONVERT)
-	    eb_convert_p_sounds_jis(canonicalized_word);
+	if (search->fix_flags != 0)
+	    eb_fix_word_jis(search, canonicalized_word);
     }
 
     if (search->index_id != 0x70 && search->index_id != 0x90)
@@ -425,6 +381,28 @@ eb_fix_word(EB_Book *book, const EB_Search *search, char *word,
 }
 
 
+/*
+ * Convert `input_word' encoded in `input_encoding' to the character code
+ * of `book', and put it into `word'.
+ */
+static EB_Error_Code
+eb_convert_word(EB_Book *book, const char *input_word, int input_encoding,
+    char *word, EB_Word_Code *word_code)
+{
+    if (book->character_code == EB_CHARCODE_ISO8859_1) {
+	if (input_encoding == EB_INPUT_UTF8)
+	    return eb_convert_utf8_latin(book, input_word, word, word_code);
+	else
+	    return eb_convert_latin(book, input_word, word, word_code);
+    } else {
+	if (input_encoding == EB_INPUT_UTF8)
+	    return eb_convert_utf8(book, input_word, word, word_code);
+	else
+	    return eb_convert_euc_jp(book, input_word, word, word_code);
+    }
+}
+
+
 /*
  * Convert `input_word' to ISO 8859 1 and put it into `word'.
  *
@@ -514,6 +492,105 @@ eb_convert_latin(EB_Book *book, const char *input_word, char *word,
 }
 
 
+/*
+ * Convert `input_word' in UTF-8 to ISO 8859 1 and put it into `word'.
+ *
+ * If `input_word' is a valid string to search, EB_WORD_ALPHABET is returned.
+ * Otherwise, -1 is returned.
+ */
+static EB_Error_Code
+eb_convert_utf8_latin(EB_Book *book, const char *input_word, char *word,
+    EB_Word_Code *word_code)
+{
+    EB_Error_Code error_code;
+    unsigned char *wp = (unsigned char *) word;
+    const unsigned char *inp = (const unsigned char *) input_word;
+    const unsigned char *tail;
+    unsigned int c;
+    int character_length;
+    int word_length = 0;
+
+    LOG(("in: eb_convert_utf8_latin(book=%d, input_word=%s)",
+	(int)book->code, eb_quoted_string(input_word)));
+
+    /*
+     * Find the tail of `input_word'.
+     */
+    tail = (const unsigned char *) input_word + strlen(input_word) - 1;
+    while ((const unsigned char *)input_word <= tail
+	&& (*tail == ' ' || *tail == '\t'))
+	tail--;
+    tail++;
+
+    /*
+     * Ignore spaces and tabs in the beginning of `input_word'.
+     */
+    while (*inp == ' ' || *inp == '\t')
+	inp++;
+
+    while (inp < tail) {
+	/*
+	 * Check for the length of the word.
+	 * If exceeds, return with an error code.
+	 */
+	if (EB_MAX_WORD_LENGTH < word_length + 1) {
+	    error_code = EB_ERR_TOO_LONG_WORD;
+	    goto failed;
+	}
+
+	/*
+	 * Only the characters in ISO 8859 1 (U+0000 ... U+00FF) are
+	 * accepted.
+	 */
+	character_length = eb_utf8_to_ucs((const char *) inp, &c);
+	if (character_length == 0 || 0xff < c) {
+	    error_code = EB_ERR_BAD_WORD;
+	    goto failed;
+	}
+	inp += character_length;
+
+	/*
+	 * Tabs are translated to spaces.
+	 */
+	if (c == '\t')
+	    c = ' ';
+
+	*wp++ = c;
+
+	/*
+	 * Skip successive spaces and tabs.
+	 */
+	if (c == ' ') {
+	    while (*inp == '\t' || *inp == ' ')
+		inp++;
+	}
+
+	word_length++;
+    }
+    *wp = '\0';
+
+    if (word_length == 0) {
+	error_code = EB_ERR_EMPTY_WORD;
+	goto failed;
+    }
+    *word_code = EB_WORD_ALPHABET;
+
+    LOG(("out: eb_convert_utf8_latin(word=%s, word_code=%d) = %s",
+	eb_quoted_string(word), (int)*word_code, eb_error_string(EB_SUCCESS)));
+
+    return EB_SUCCESS;
+
+    /*
+     * An error occurs...
+     */
+  failed:
+    *word = '\0';
+    *word_code = EB_WORD_INVALID;
+    LOG(("out: eb_convert_utf8_latin() = %s", eb_error_string(error_code)));
+    return error_code;
+}
+
+
 /*
  * Table used to convert JIS X 0208 to ASCII.
  */
@@ -706,148 +783,162 @@ eb_convert_euc_jp(EB_Book *book, const char *input_word, char *word,
 
 
 /*
- * Convert KATAKANA to HIRAGANA in `word'.
+ * Convert `input_word' in UTF-8 to JIS X0208 and put it into `word'.
+ * Unicode characters are converted with the tables in utf8.c, and
+ * HALFWIDTH KATAKANA (U+FF61 ... U+FF9F) with `jisx0201_table'.
+ *
+ * If `input_word' is a valid string to search, EB_WORD_ALPHABET or
+ * EB_WORD_KANA is returned.
+ * Otherwise, -1 is returned.
  */
-static void
-eb_convert_katakana_jis(char *word)
+static EB_Error_Code
+eb_convert_utf8(EB_Book *book, const char *input_word, char *word,
+    EB_Word_Code *word_code)
 {
+    EB_Error_Code error_code;
     unsigned char *wp = (unsigned char *) word;
-    unsigned char c1, c2;
-
-    LOG(("in: eb_convert_katakana_jis(word=%s)", eb_quoted_string(word)));
+    const unsigned char *inp = (const unsigned char *) input_word;
+    const unsigned char *tail;
+    const unsigned char *ascii_tail;
+    unsigned char c1 = 0, c2 = 0;
+    unsigned int c;
+    int character_length;
+    int kana_count = 0;
+    int alphabet_count = 0;
+    int kanji_count = 0;
+    int word_length = 0;
 
-    while (*wp != '\0' && *(wp + 1) != '\0') {
-	c1 = *wp;
-	c2 = *(wp + 1);
+    LOG(("in: eb_convert_utf8(book=%d, input_word=%s)", (int)book->code,
+	eb_quoted_string(input_word)));
 
-	if (c1 == 0x25 && 0x21 <= c2 && c2 <= 0x76) {
-	    /*
-	     * This is a KATAKANA.  Convert to corresponding HIRAGANA.
-	     */
-	    *wp = 0x24;
-	}
-	wp += 2;
+    /*
+     * Find the tail of `input_word'.
+     * IDEOGRAPHIC SPACE (U+3000) is 0xe3 0x80 0x80 in UTF-8.
+     */
+    tail = (const unsigned char *) input_word + strlen(input_word) - 1;
+    for (;;) {
+	if (inp < tail && (*tail == ' ' || *tail == '\t'))
+	    tail--;
+	else if (inp < tail - 2 && *tail == 0x80 && *(tail - 1) == 0x80
+	    && *(tail - 2) == 0xe3)
+	    tail -= 3;
+	else
+	    break;
     }
-    *wp = '\0';
-
-    LOG(("out: eb_convert_katakana_jis()"));
-}
-
-
-/*
- * Convert HIRAGANA to KATAKANA in `word'.
- */
-static void
-eb_convert_hiragana_jis(char *word)
-{
-    unsigned char *wp = (unsigned char *) word;
-    unsigned char c1, c2;
-
-    LOG(("in: eb_convert_hiragana_jis(word=%s)", eb_quoted_string(word)));
-
-    while (*wp != '\0' && *(wp + 1) != '\0') {
-	c1 = *wp;
-	c2 = *(wp + 1);
+    tail++;
 
-	if (c1 == 0x24 && 0x21 <= c2 && c2 <= 0x76) {
-	    /*
-	     * This is a HIRAGANA.  Convert to corresponding KATAKANA.
-	     */
-	    *wp = 0x25;
-	}
-	wp += 2;
+    /*
+     * Ignore spaces and tabs in the beginning of `input_word'.
+     */
+    for (;;) {
+	if (*inp == ' ' || *inp == '\t')
+	    inp++;
+	else if (*inp == 0xe3 && *(inp + 1) == 0x80 && *(inp + 2) == 0x80)
+	    inp += 3;
+	else
+	    break;
     }
-    *wp = '\0';
 
-    LOG(("out: eb_convert_hiragana_jis()"));
-}
-
-
-/*
- * Convert lower case to upper case in `word'.
- */
-static void
-eb_convert_lower_latin(char *word)
-{
-    unsigned char *wp = (unsigned char *) word;
-
-    LOG(("in: eb_convert_lower_latin(word=%s)", eb_quoted_string(word)));
+    while (inp < tail) {
+	/*
+	 * Convert a run of ASCII characters.  They are looked up in
+	 * `jisx0208_table' without decoding UTF-8.
+	 */
+	ascii_tail = inp + eb_ascii_length((const char *) inp, tail - inp);
+	while (inp < ascii_tail) {
+	    if (EB_MAX_WORD_LENGTH < word_length + 2) {
+		error_code = EB_ERR_TOO_LONG_WORD;
+		goto failed;
+	    }
 
-    while (*wp != '\0') {
-	if (('a' <= *wp && *wp <= 'z')
-	    || (0xe0 <= *wp && *wp <= 0xf6) || (0xf8 <= *wp && *wp <= 0xfe)) {
 	    /*
-	     * This is a lower case letter.  Convert to upper case.
+	     * Tabs are translated to spaces.
 	     */
-	    *wp -= 0x20;
+	    c = *inp++;
+	    if (c == '\t')
+		c = ' ';
+	    if (c < 0x20 || 0x7e < c) {
+		error_code = EB_ERR_BAD_WORD;
+		goto failed;
+	    }
+	    c = jisx0208_table[c - 0x20];
+	    *wp++ = c >> 8;
+	    *wp++ = c & 0xff;
+	    if ((c >> 8) == 0x23)
+		alphabet_count++;
+	    word_length += 2;
 	}
-	wp++;
-    }
-    *wp = '\0';
+	if (tail <= inp)
+	    break;
 
-    LOG(("out: eb_convert_lower_latin()"));
-}
+	/*
+	 * Check for the length of the word.
+	 * If exceeds, return with an error code.
+	 */
+	if (EB_MAX_WORD_LENGTH < word_length + 2) {
+	    error_code = EB_ERR_TOO_LONG_WORD;
+	    goto failed;
+	}
 
+	/*
+	 * Convert a non-ASCII character.
+	 */
+	character_length = eb_utf8_to_ucs((const char *) inp, &c);
+	if (character_length == 0) {
+	    error_code = EB_ERR_BAD_WORD;
+	    goto failed;
+	}
+	inp += character_length;
 
-/*
- * Convert lower case to upper case in `word'.
- */
-static void
-eb_convert_lower_jis(char *word)
-{
-    unsigned char *wp = (unsigned char *) word;
-    unsigned char c1, c2;
+	if (0xff61 <= c && c <= 0xff9f)
+	    c = jisx0201_table[c - 0xff60];
+	else
+	    c = eb_ucs_to_jisx0208(c);
+	if (c == 0) {
+	    error_code = EB_ERR_BAD_WORD;
+	    goto failed;
+	}
+	c1 = c >> 8;
+	c2 = c & 0xff;
 
-    LOG(("in: eb_convert_lower_jis(word=%s)", eb_quoted_string(word)));
+	*wp++ = c1;
+	*wp++ = c2;
 
-    while (*wp != '\0' && *(wp + 1) != '\0') {
-	c1 = *wp;
-	c2 = *(wp + 1);
+	if (c1 == 0x23)
+	    alphabet_count++;
+	else if (c1 == 0x24 || c1 == 0x25)
+	    kana_count++;
+	else if (c1 != 0x21)
+	    kanji_count++;
 
-	if (c1 == 0x23 && 0x61 <= c2 && c2 <= 0x7a) {
-	    /*
-	     * This is a lower case letter.  Convert to upper case.
-	     */
-	    *(wp + 1) = c2 - 0x20;
-	}
-	wp += 2;
+	word_length += 2;
     }
     *wp = '\0';
 
-    LOG(("out: eb_convert_lower_jis()"));
-}
-
-
-/*
- * Delete some marks in `word'.
- */
-static void
-eb_delete_marks_jis(char *word)
-{
-    unsigned char *in_wp = (unsigned char *) word;
-    unsigned char *out_wp = (unsigned char *) word;
-    unsigned char c1, c2;
-
-    LOG(("in: eb_delete_marks_jis(word=%s)", eb_quoted_string(word)));
+    if (word_length == 0) {
+	error_code = EB_ERR_EMPTY_WORD;
+	goto failed;
+    }
+    if (alphabet_count == 0 && kana_count != 0 && kanji_count == 0)
+	*word_code = EB_WORD_KANA;
+    else if (alphabet_count != 0 && kana_count == 0 && kanji_count == 0)
+	*word_code = EB_WORD_ALPHABET;
+    else
+	*word_code = EB_WORD_OTHER;
 
-    while (*in_wp != '\0' && *(in_wp + 1) != '\0') {
-	c1 = *in_wp;
-	c2 = *(in_wp + 1);
+    LOG(("out: eb_convert_utf8(word=%s, word_code=%d) = %s",
+	eb_quoted_string(word), (int)*word_code, eb_error_string(EB_SUCCESS)));
 
-	if (c1 != 0x21
-	    || (c2 != 0x26 && c2 != 0x3e && c2 != 0x47 && c2 != 0x5d)) {
-	    /*
-	     * This is not a character to be deleted.
-	     */
-	    *out_wp = c1;
-	    *(out_wp + 1) = c2;
-	    out_wp += 2;
-	}
-	in_wp += 2;
-    }
-    *out_wp = '\0';
+    return EB_SUCCESS;
 
-    LOG(("out: eb_delete_marks_jis()"));
+    /*
+     * An error occurs...
+     */
+  failed:
+    *word = '\0';
+    *word_code = EB_WORD_INVALID;
+    LOG(("out: eb_convert_utf8() = %s", eb_error_string(error_code)));
+    return error_code;
 }
 
 
@@ -901,180 +992,6 @@ static const char long_vowel_table[] = {
 };
 
 
-/*
- * Convert long vowel marks in `word' to the previous vowels.
- */
-static void
-eb_convert_long_vowels_jis(char *word)
-{
-    unsigned char *wp = (unsigned char *) word;
-    unsigned char c1, c2;
-    unsigned char previous_c1 = '\0', previous_c2 = '\0';
-
-    LOG(("in: eb_convert_long_vowels_jis(word=%s)", eb_quoted_string(word)));
-
-    while (*wp != '\0' && *(wp + 1) != '\0') {
-	c1 = *wp;
-	c2 = *(wp + 1);
-
-	if (c1 == 0x21 && c2 == 0x3c) {
-	    /*
-	     * The is a long vowel mark.
-	     * Convert to a vowel of the prev_ KANA character.
-	     * If prev_ character is not KANA, the conversion is
-	     * not done.
-	     */
-	    if ((previous_c1 == 0x24 || previous_c1 == 0x25)
-		&& 0x21 <= previous_c2 && previous_c2 <= 0x76) {
-		*wp = previous_c1;
-		*(wp + 1) = long_vowel_table[previous_c2 - 0x21];
-	    }
-	}
-	previous_c1 = c1;
-	previous_c2 = c2;
-	wp += 2;
-    }
-    *wp = '\0';
-
-    LOG(("out: eb_convert_long_vowels_jis()"));
-}
-
-
-/*
- * Delete long vowel marks in `word'.
- */
-static void
-eb_delete_long_vowels_jis(char *word)
-{
-    unsigned char *in_wp = (unsigned char *) word;
-    unsigned char *out_wp = (unsigned char *) word;
-    unsigned char c1, c2;
-
-    LOG(("in: eb_delete_long_vowels_jis(word=%s)", eb_quoted_string(word)));
-
-    while (*in_wp != '\0' && *(in_wp + 1) != '\0') {
-	c1 = *in_wp;
-	c2 = *(in_wp + 1);
-
-	if (c1 != 0x21 || c2 != 0x3c) {
-	    /*
-	     * The is not a long vowel mark.
-	     */
-	    *out_wp = c1;
-	    *(out_wp + 1) = c2;
-	    out_wp += 2;
-	}
-	in_wp += 2;
-    }
-    *out_wp = '\0';
-
-    LOG(("out: eb_delete_long_vowels_jis()"));
-}
-
-
-/*
- * Convert the double consonant mark `tu' to `TU'.
- */
-static void
-eb_convert_double_consonants_jis(char *word)
-{
-    unsigned char *wp = (unsigned char *) word;
-    unsigned char c1, c2;
-
-    LOG(("in: eb_convert_double_consonants_jis(word=%s)",
-	eb_quoted_string(word)));
-
-    while (*wp != '\0' && *(wp + 1) != '\0') {
-	c1 = *wp;
-	c2 = *(wp + 1);
-
-	if ((c1 == 0x24 || c1 == 0x25) && c2 == 0x43) {
-	    /*
-	     * This is a double sound mark.  Convert to the corresponding
-	     * sound mark.
-	     */
-	    *(wp + 1) = c2 + 1;
-	}
-	wp += 2;
-    }
-    *wp = '\0';
-
-    LOG(("out: eb_convert_double_consonants_jis()"));
-}
-
-
-/*
- * Convert the contracted sound marks to the corresponding
- * non-contracted sound marks.
- * (`ya', `yu', `yo', `wa', `ka', `ke' -> `YA', `YU', `YO', `WA', `KA', `KE')
- */
-static void
-eb_convert_contracted_sounds_jis(char *word)
-{
-    unsigned char *wp = (unsigned char *) word;
-    unsigned char c1, c2;
-
-    LOG(("in: eb_convert_contracted_sounds_jis(word=%s)",
-	eb_quoted_string(word)));
-
-    while (*wp != '\0' && *(wp + 1) != '\0') {
-	c1 = *wp;
-	c2 = *(wp + 1);
-
-	if (c1 == 0x24 || c1 == 0x25) {
-	    /*
-	     * This is HIRAGANA or KANAKANA.
-	     * If this is a contracted sound mark, convert to the
-	     * corresponding uncontracted sound mark.
-	     */
-	    if (c2 == 0x63 || c2 == 0x65 || c2 == 0x67 || c2 == 0x6e)
-		*(wp + 1) = c2 + 1;
-	    else if (c2 == 0x75)
-		*(wp + 1) = 0x2b;
-	    else if (c2 == 0x76)
-		*(wp + 1) = 0x31;
-	}
-	wp += 2;
-    }
-    *wp = '\0';
-
-    LOG(("in: eb_convert_contracted_sounds_jis()"));
-}
-
-
-/*
- * Convert the small vowels to the normal vowels.
- * (`a', `i', `u', `e', `o' -> `A', `I', `U', `E', `O')
- */
-static void
-eb_convert_small_vowels_jis(char *word)
-{
-    unsigned char *wp = (unsigned char *) word;
-    unsigned char c1, c2;
-
-    LOG(("in: eb_convert_small_vowels_jis(word=%s)", eb_quoted_string(word)));
-
-    while (*wp != '\0' && *(wp + 1) != '\0') {
-	c1 = *wp;
-	c2 = *(wp + 1);
-
-	if (c1 == 0x24 || c1 == 0x25) {
-	    /*
-	     * This is HIRAGANA or KANAKANA.
-	     * If this is a small vowel mark, convert to a normal vowel.
-	     */
-	    if (c2 == 0x21 || c2 == 0x23 || c2 == 0x25 || c2 == 0x27
-		|| c2 == 0x29)
-		*(wp + 1) = c2 + 1;
-	}
-	wp += 2;
-    }
-    *wp = '\0';
-
-    LOG(("out: eb_convert_small_vowels_jis()"));
-}
-
-
 /*
  * The table is used to convert voiced consonant marks.
  */
@@ -1124,128 +1041,228 @@ static const char voiced_consonant_table[] = {
     0x75, /* ka(75) -> ka(75) */	0x76  /* ke(76) -> ke(76) */
 };
 
+
 /*
- * Convert the contracted sound marks to the corresponding
- * non-contracted sound marks (e.g. `GA' to `KA').
+ * Compile the index style flags of `search' into `search->fix_flags'
+ * and `search->fix_kana_table', so that eb_fix_word() canonicalizes
+ * a word in one pass.
+ *
+ * The conversions of KANA characters which don't depend on the other
+ * characters (double consonant, contracted sound, small vowel, voiced
+ * consonant and p sound) are composed into `fix_kana_table' in the order
+ * they are applied.
  */
-static void
-eb_convert_voiced_consonants_jis(char *word)
+void
+eb_compile_search_styles(EB_Search *search)
 {
-    unsigned char *wp = (unsigned char *) word;
-    unsigned char c1, c2;
+    int flags = 0;
+    int c;
+    int i;
 
-    LOG(("in: eb_convert_voiced_consonants_jis(word=%s)",
-	eb_quoted_string(word)));
+    if (search->space == EB_INDEX_STYLE_DELETE)
+	flags |= EB_FIX_DELETE_SPACES;
 
-    while (*wp != '\0' && *(wp + 1) != '\0') {
-	c1 = *wp;
-	c2 = *(wp + 1);
+    if (search->katakana == EB_INDEX_STYLE_CONVERT)
+	flags |= EB_FIX_KATAKANA;
+    else if (search->katakana == EB_INDEX_STYLE_REVERSED_CONVERT)
+	flags |= EB_FIX_HIRAGANA;
 
-	if ((c1 == 0x24 || c1 == 0x25) && 0x21 <= c2 && c2 <= 0x76) {
-	    /*
-	     * This is a voiced constonat mark.  Convert to the
-	     * corresponding unvoiced constonant mark.
-	     */
-	    *(wp + 1) = voiced_consonant_table[c2 - 0x21];
-	}
-	wp += 2;
-    }
-    *wp = '\0';
+    if (search->lower == EB_INDEX_STYLE_CONVERT)
+	flags |= EB_FIX_LOWER;
 
-    LOG(("out: eb_convert_voiced_consonants_jis()"));
-}
+    if (search->mark == EB_INDEX_STYLE_DELETE)
+	flags |= EB_FIX_DELETE_MARKS;
 
+    if (search->long_vowel == EB_INDEX_STYLE_CONVERT)
+	flags |= EB_FIX_LONG_VOWELS;
+    else if (search->long_vowel == EB_INDEX_STYLE_DELETE)
+	flags |= EB_FIX_DELETE_LONG_VOWELS;
 
-/*
- * Convert the p sound marks
- * (`PA', `PI', `PU', `PE', `PO' -> `HA', `HI', `HU', `HE', `HO')
- */
-static void
-eb_convert_p_sounds_jis(char *word)
-{
-    unsigned char *wp = (unsigned char *) word;
-    unsigned char c1, c2;
+    if (search->double_consonant == EB_INDEX_STYLE_CONVERT
+	|| search->contracted_sound == EB_INDEX_STYLE_CONVERT
+	|| search->small_vowel == EB_INDEX_STYLE_CONVERT
+	|| search->voiced_consonant == EB_INDEX_STYLE_CONVERT
+	|| search->p_sound == EB_INDEX_STYLE_CONVERT)
+	flags |= EB_FIX_KANA_TABLE;
 
-    LOG(("in: eb_convert_p_sounds_jis(word=%s)", eb_quoted_string(word)));
+    for (i = 0; i < EB_SIZE_KANA_TABLE; i++) {
+	c = 0x21 + i;
 
-    while (*wp != '\0' && *(wp + 1) != '\0') {
-	c1 = *wp;
-	c2 = *(wp + 1);
+	/*
+	 * Convert the double consonant mark `tu' to `TU'.
+	 */
+	if (search->double_consonant == EB_INDEX_STYLE_CONVERT && c == 0x43)
+	    c++;
 
-	if (c1 == 0x24 || c1 == 0x25) {
-	    /*
-	     * This is HIRAGANA or KANAKANA.
-	     * If this is a p-sound mark, convert to the corresponding
-	     * unvoiced consonant mark.
-	     */
-	    if (c2 == 0x51 || c2 == 0x54 || c2 == 0x57 || c2 == 0x5a
-		|| c2 == 0x5d)
-		*(wp + 1) = c2 - 2;
+	/*
+	 * Convert the contracted sound marks to the corresponding
+	 * non-contracted sound marks.
+	 * (`ya', `yu', `yo', `wa', `ka', `ke' -> `YA', `YU', `YO', `WA',
+	 * `KA', `KE')
+	 */
+	if (search->contracted_sound == EB_INDEX_STYLE_CONVERT) {
+	    if (c == 0x63 || c == 0x65 || c == 0x67 || c == 0x6e)
+		c++;
+	    else if (c == 0x75)
+		c = 0x2b;
+	    else if (c == 0x76)
+		c = 0x31;
+	}
+
+	/*
+	 * Convert the small vowels to the normal vowels.
+	 * (`a', `i', `u', `e', `o' -> `A', `I', `U', `E', `O')
+	 */
+	if (search->small_vowel == EB_INDEX_STYLE_CONVERT) {
+	    if (c == 0x21 || c == 0x23 || c == 0x25 || c == 0x27 || c == 0x29)
+		c++;
+	}
+
+	/*
+	 * Convert the voiced consonant marks to the corresponding
+	 * unvoiced consonant marks (e.g. `GA' to `KA').
+	 */
+	if (search->voiced_consonant == EB_INDEX_STYLE_CONVERT)
+	    c = voiced_consonant_table[c - 0x21];
+
+	/*
+	 * Convert the p sound marks.
+	 * (`PA', `PI', `PU', `PE', `PO' -> `HA', `HI', `HU', `HE', `HO')
+	 */
+	if (search->p_sound == EB_INDEX_STYLE_CONVERT) {
+	    if (c == 0x51 || c == 0x54 || c == 0x57 || c == 0x5a || c == 0x5d)
+		c -= 2;
 	}
-	wp += 2;
+
+	search->fix_kana_table[i] = c;
     }
-    *wp = '\0';
 
-    LOG(("out: eb_convert_p_sounds_jis()"));
+    search->fix_flags = flags;
 }
 
 
 /*
- * Delete spaces in `word'.
+ * Canonicalize `word' in ISO 8859 1 according with `fix_flags'.
+ * Spaces are deleted and lower case letters are converted to upper case.
  */
 static void
-eb_delete_spaces_latin(char *word)
+eb_fix_word_latin(int fix_flags, char *word)
 {
     unsigned char *in_wp = (unsigned char *) word;
     unsigned char *out_wp = (unsigned char *) word;
+    unsigned char c;
 
-    LOG(("in: eb_delete_space_latin(word=%s)", eb_quoted_string(word)));
+    LOG(("in: eb_fix_word_latin(word=%s)", eb_quoted_string(word)));
 
     while (*in_wp != '\0') {
-	if (*in_wp != ' ') {
+	c = *in_wp++;
+
+	if (c == ' ' && (fix_flags & EB_FIX_DELETE_SPACES))
+	    continue;
+
+	if ((fix_flags & EB_FIX_LOWER)
+	    && (('a' <= c && c <= 'z')
+		|| (0xe0 <= c && c <= 0xf6) || (0xf8 <= c && c <= 0xfe))) {
 	    /*
-	     * This is not a space character of ISO 8859 1.
+	     * This is a lower case letter.  Convert to upper case.
 	     */
-	    *out_wp = *in_wp;
-	    out_wp++;
+	    c -= 0x20;
 	}
-	in_wp++;
+	*out_wp++ = c;
     }
     *out_wp = '\0';
 
-    LOG(("out: eb_delete_space_latin()"));
+    LOG(("out: eb_fix_word_latin()"));
 }
 
 
 /*
- * Delete spaces in `word'.
+ * Canonicalize `word' in JIS X 0208 according with `search'.
+ *
+ * The conversions are done in the following order, but in one pass:
+ * deleting spaces, converting KATAKANA (or HIRAGANA), converting lower
+ * case letters, deleting marks, converting (or deleting) long vowel
+ * marks, and then the conversions compiled into `search->fix_kana_table'.
+ * A long vowel mark is converted to the vowel of the previous character,
+ * looked at before the conversions in `fix_kana_table'.
  */
 static void
-eb_delete_spaces_jis(char *word)
+eb_fix_word_jis(const EB_Search *search, char *word)
 {
+    const unsigned char *kana_table = search->fix_kana_table;
+    int fix_flags = search->fix_flags;
     unsigned char *in_wp = (unsigned char *) word;
     unsigned char *out_wp = (unsigned char *) word;
     unsigned char c1, c2;
+    unsigned char previous_c1 = '\0', previous_c2 = '\0';
 
-    LOG(("in: eb_delete_space_jis(word=%s)", eb_quoted_string(word)));
+    LOG(("in: eb_fix_word_jis(word=%s)", eb_quoted_string(word)));
 
     while (*in_wp != '\0' && *(in_wp + 1) != '\0') {
 	c1 = *in_wp;
 	c2 = *(in_wp + 1);
+	in_wp += 2;
 
-	if (c1 != 0x21 || c2 != 0x21) {
+	if (c1 == 0x21) {
 	    /*
-	     * This is not a space character of JIS X 0208.
+	     * A space, a mark or a long vowel mark.
 	     */
+	    if (c2 == 0x21 && (fix_flags & EB_FIX_DELETE_SPACES))
+		continue;
+	    if ((c2 == 0x26 || c2 == 0x3e || c2 == 0x47 || c2 == 0x5d)
+		&& (fix_flags & EB_FIX_DELETE_MARKS))
+		continue;
+	    if (c2 == 0x3c) {
+		if (fix_flags & EB_FIX_DELETE_LONG_VOWELS)
+		    continue;
+		if ((fix_flags & EB_FIX_LONG_VOWELS)
+		    && (previous_c1 == 0x24 || previous_c1 == 0x25)
+		    && 0x21 <= previous_c2 && previous_c2 <= 0x76) {
+		    /*
+		     * Convert to a vowel of the previous KANA character.
+		     */
+		    *out_wp = previous_c1;
+		    *(out_wp + 1) = kana_table[long_vowel_table[previous_c2
+			- 0x21] - 0x21];
+		    out_wp += 2;
+		    previous_c1 = c1;
+		    previous_c2 = c2;
+		    continue;
+		}
+	    }
+
+	} else if (c1 == 0x23) {
+	    /*
+	     * If this is a lower case letter, convert to upper case.
+	     */
+	    if ((fix_flags & EB_FIX_LOWER) && 0x61 <= c2 && c2 <= 0x7a)
+		c2 -= 0x20;
+
+	} else if ((c1 == 0x24 || c1 == 0x25) && 0x21 <= c2 && c2 <= 0x76) {
+	    /*
+	     * This is a HIRAGANA or KATAKANA.
+	     */
+	    if (fix_flags & EB_FIX_KATAKANA)
+		c1 = 0x24;
+	    else if (fix_flags & EB_FIX_HIRAGANA)
+		c1 = 0x25;
+	    previous_c1 = c1;
+	    previous_c2 = c2;
 	    *out_wp = c1;
-	    *(out_wp + 1) = c2;
+	    *(out_wp + 1) = kana_table[c2 - 0x21];
 	    out_wp += 2;
+	    continue;
 	}
-	in_wp += 2;
+
+	previous_c1 = c1;
+	previous_c2 = c2;
+	*out_wp = c1;
+	*(out_wp + 1) = c2;
+	out_wp += 2;
     }
     *out_wp = '\0';
 
-    LOG(("out: eb_delete_space_jis()"));
+    LOG(("out: eb_fix_word_jis()"));
 }
 
 
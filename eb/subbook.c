@@ -379,6 +379,7 @@ eb_load_subbook_indexes(EB_Book *book)
 	} else {
             search.space = EB_INDEX_STYLE_DELETE;
 	}
+	eb_compile_search_styles(&search);
 
 	/*
 	 * Identify search method.
@@ -867,6 +868,8 @@ eb_set_subbook(EB_Book *book, EB_Subbook_Code subbook_code)
 
   succeeded:
     book->subbook_current->initialized = 1;
+    if (book->materialize_mode)
+	zio_materialize(&book->subbook_current->text_zio);
     LOG(("out: eb_set_subbook() = %s", eb_error_string(EB_SUCCESS)));
     eb_unlock(&book->lock);
 
@@ -1140,3 +1143,54 @@ eb_unset_subbook(EB_Book *book)
 }
 
 
+/*
+ * Set whether the text file of the current subbook, and of subbooks
+ * set later, is uncompressed into memory in the background.  (See
+ * zio_materialize().)  If `flag' is 0, the contents in memory are
+ * discarded.
+ */
+EB_Error_Code
+eb_set_materialize_mode(EB_Book *book, int flag)
+{
+    EB_Error_Code error_code;
+    EB_Subbook *subbook;
+    int i;
+
+    eb_lock(&book->lock);
+    LOG(("in: eb_set_materialize_mode(book=%d, flag=%d)", (int)book->code,
+	flag));
+
+    /*
+     * The book must have been bound.
+     */
+    if (book->path == NULL) {
+	error_code = EB_ERR_UNBOUND_BOOK;
+	goto failed;
+    }
+
+    book->materialize_mode = flag;
+    if (flag) {
+	if (book->subbook_current != NULL)
+	    zio_materialize(&book->subbook_current->text_zio);
+    } else {
+	for (i = 0, subbook = book->subbooks; i < book->subbook_count;
+	     i++, subbook++) {
+	    zio_discard_materialized(&subbook->text_zio);
+	}
+    }
+
+    LOG(("out: eb_set_materialize_mode() = %s",
+	eb_error_string(EB_SUCCESS)));
+    eb_unlock(&book->lock);
+    return EB_SUCCESS;
+
+    /*
+     * An error occurs...
+     */
+  failed:
+    LOG(("out: eb_set_materialize_mode() = %s", eb_error_string(error_code)));
+    eb_unlock(&book->lock);
+    return error_code;
+}
+
+
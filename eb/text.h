@@ -149,6 +149,7 @@ EB_Error_Code eb_read_heading(EB_Book *book, EB_Appendix *appendix,
     ssize_t *text_length);
 EB_Error_Code eb_read_rawtext(EB_Book *book, size_t text_max_length,
     char *text, ssize_t *text_length);
+EB_Error_Code eb_set_utf8_mode(EB_Book *book, int flag);
 int eb_is_text_stopped(EB_Book *book);
 EB_Error_Code eb_write_text_byte1(EB_Book *book, int byte1);
 EB_Error_Code eb_write_text_byte2(EB_Book *book, int byte1, int byte2);
@@ -152,12 +152,8 @@ eb_load_wide_font_header(EB_Book *book, EB_Font_Code font_code)
     /*
      * Read information from the text file.
      */
-    if (zio_lseek(zio, ((off_t) wide_font->page - 1) * EB_SIZE_PAGE,
-	SEEK_SET) < 0) {
-	error_code = EB_ERR_FAIL_SEEK_FONT;
-	goto failed;
-    }
-    if (zio_read(zio, buffer, 16) != 16) {
+    if (zio_pread(zio, ((off_t) wide_font->page - 1) * EB_SIZE_PAGE,
+	buffer, 16) != 16) {
 	error_code = EB_ERR_FAIL_READ_FONT;
 	goto failed;
     }
@@ -278,13 +274,8 @@ eb_load_wide_font_glyphs(EB_Book *book, EB_Font_Code font_code)
     /*
      * Read glyphs.
      */
-    if (zio_lseek(zio, (off_t) wide_font->page * EB_SIZE_PAGE, SEEK_SET)
-	< 0) {
-	error_code = EB_ERR_FAIL_SEEK_FONT;
-	goto failed;
-    }
-    if (zio_read(zio, wide_font->glyphs, total_glyph_size)
-	!= total_glyph_size) {
+    if (zio_pread(zio, (off_t) wide_font->page * EB_SIZE_PAGE,
+	wide_font->glyphs, total_glyph_size) != total_glyph_size) {
 	error_code = EB_ERR_FAIL_READ_FONT;
 	goto failed;
     }
@@ -764,13 +755,9 @@ character_number=%d)",
     if (wide_current->glyphs == NULL) {
 	zio = &wide_current->zio;
 
-	if (zio_lseek(zio,
+	if (zio_pread(zio,
 		(off_t) wide_current->page * EB_SIZE_PAGE + offset,
-		SEEK_SET) < 0) {
-	    error_code = EB_ERR_FAIL_SEEK_FONT;
-	    goto failed;
-	}
-	if (zio_read(zio, bitmap, size) != size) {
+		bitmap, size) != size) {
 	    error_code = EB_ERR_FAIL_READ_FONT;
 	    goto failed;
 	}
@@ -852,13 +839,9 @@ character_number=%d)",
     if (wide_current->glyphs == NULL) {
 	zio = &wide_current->zio;
 
-	if (zio_lseek(zio,
+	if (zio_pread(zio,
 		(off_t) wide_current->page * EB_SIZE_PAGE + offset,
-		SEEK_SET) < 0) {
-	    error_code = EB_ERR_FAIL_SEEK_FONT;
-	    goto failed;
-	}
-	if (zio_read(zio, bitmap, size) != size) {
+		bitmap, size) != size) {
 	    error_code = EB_ERR_FAIL_READ_FONT;
 	    goto failed;
 	}
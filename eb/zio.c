@@ -30,6 +30,13 @@
 #include "config.h"
 #endif
 
+/*
+ * F_OFD_SETLKW of fcntl() is a GNU extension in older C libraries.
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE 1
+#endif
+
 #include <stdio.h>
 #include <sys/types.h>
 #include <errno.h>
@@ -38,13 +45,55 @@
 #include <limits.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <time.h>
 
 #ifdef ENABLE_PTHREAD
 #include <pthread.h>
 #endif
 
+#include <sys/stat.h>
+
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif
+
+/*
+ * The shared slice cache needs atomic operations on memory shared
+ * among processes.
+ */
+#if defined(HAVE_MMAP) && defined(__ATOMIC_ACQUIRE)
+#define ZIO_USE_SHARED_CACHE 1
+#endif
+
+/*
+ * The disk cache needs the positional read and write, and the record
+ * lock of fcntl().
+ */
+#if defined(HAVE_PREAD) && defined(F_SETLKW)
+#define ZIO_USE_DISK_CACHE 1
+#endif
+
+/*
+ * io_uring is used to submit several raw reads by a system call, if
+ * the kernel headers support it.  (It is used through the system calls
+ * directly, since liburing is not always installed.)
+ */
+#if defined(HAVE_LINUX_IO_URING_H) && defined(HAVE_MMAP) \
+    && defined(HAVE_PREAD) && defined(__ATOMIC_ACQUIRE)
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) \
+    && defined(IORING_FEAT_RW_CUR_POS)
+#define ZIO_USE_IO_URING 1
+#endif
+#endif
+
 #include <zlib.h>
 
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
 #include "zio.h"
 #ifdef ENABLE_EBNET
 #include "ebnet.h"
@@ -56,6 +105,9 @@
 #ifndef O_BINARY
 #define O_BINARY 0
 #endif
+#ifndef O_NOFOLLOW
+#define O_NOFOLLOW 0
+#endif
 
 /*
  * The maximum length of path name.
@@ -127,33 +179,478 @@ extern void eb_log(const char *, ...);
 #define ZIO_SIZE_PAGE			2048
 
 /*
- * Size of a cache buffer.
- * It must be large enough to memory an uncompressed slice.
+ * Size of an uncompressed slice in S-EBXA compression.
+ */
+#define ZIO_SEBXA_SLICE_LENGTH		4096
+
+/*
+ * Default size of the slice cache, in bytes.
+ *
+ * (In EBZIP compression, the size of an uncompressed slice is
+ * 2048 << level.  In EPWING compression, it is 2048.  In S-EBXA
+ * compression, it is 4096.)
+ */
+#define ZIO_DEFAULT_CACHE_SIZE		(1024 * 1024)
+
+/*
+ * The number of shards of the slice cache.
+ * Each shard has its own mutex and its own share of the cache size.
+ */
+#define ZIO_CACHE_SHARD_COUNT		8
+
+/*
+ * The minimum number of hash buckets in a shard.  (must be 2^n)
+ */
+#define ZIO_CACHE_MIN_BUCKET_COUNT	16
+
+/*
+ * Default total size of index tables loaded into memory, in bytes.
+ */
+#define ZIO_DEFAULT_INDEX_CACHE_SIZE	(8 * 1024 * 1024)
+
+/*
+ * Size of data uncompressed at once by the worker thread of
+ * zio_materialize().
+ */
+#define ZIO_MATERIALIZE_CHUNK_SIZE	(ZIO_SIZE_PAGE << ZIO_MAX_EBZIP_LEVEL)
+
+/*
+ * The maximum number of ebzip slices uncompressed by a batch.
+ */
+#define ZIO_MAX_BATCH_SLICES		16
+
+/*
+ * The number of entries of an io_uring submission queue.
+ */
+#define ZIO_RING_ENTRIES		16
+
+/*
+ * The maximum number of io_uring_enter() calls retried after an
+ * error by a batch.
+ */
+#define ZIO_MAX_RING_RETRIES		16
+
+/*
+ * An uncompressed slice in the slice cache.
+ */
+typedef struct Zio_Cache_Entry_Struct Zio_Cache_Entry;
+
+struct Zio_Cache_Entry_Struct {
+    /*
+     * Zio ID and slice number.
+     */
+    int zio_id;
+    off_t slice;
+
+    /*
+     * Size of the uncompressed slice, and the slice itself.
+     */
+    size_t size;
+    char *buffer;
+
+    /*
+     * Next entry in the same hash bucket.
+     */
+    Zio_Cache_Entry *hash_next;
+
+    /*
+     * Neighbors in the LRU list.  (`lru_next' is the less recently used)
+     */
+    Zio_Cache_Entry *lru_prev;
+    Zio_Cache_Entry *lru_next;
+};
+
+/*
+ * A shard of the slice cache.
+ */
+typedef struct {
+#ifdef ENABLE_PTHREAD
+    pthread_mutex_t mutex;
+#endif
+    Zio_Cache_Entry **buckets;
+    int bucket_count;
+    Zio_Cache_Entry *lru_head;
+    Zio_Cache_Entry *lru_tail;
+    size_t used_size;
+    size_t max_size;
+    unsigned long hit_count;
+    unsigned long miss_count;
+} Zio_Cache_Shard;
+
+/*
+ * Cache of uncompressed slices, keyed by Zio ID and slice number.
+ */
+static Zio_Cache_Shard cache_shards[ZIO_CACHE_SHARD_COUNT];
+
+/*
+ * Whether `cache_shards' have been initialized, or not.
+ */
+static int cache_initialized = 0;
+
+/*
+ * Hash value of a slice.
+ */
+#define zio_cache_hash(zio_id, slice) \
+	((unsigned long)(zio_id) * 2654435761UL + (unsigned long)(slice))
+
+/*
+ * The number of bits decoded at once with the Huffman lookup table.
+ */
+#define ZIO_HUFFMAN_TABLE_BITS		10
+
+/*
+ * Input bit stream of an EPWING compressed slice.
+ */
+typedef struct {
+    Zio *zio;
+    off_t location;
+    unsigned char buffer[ZIO_SIZE_PAGE];
+    unsigned char *buffer_p;
+    unsigned char *buffer_end;
+    unsigned long bits;
+    int bit_count;
+    int is_eof;
+} Zio_Bit_Stream;
+
+/*
+ * A raw read in a batch: `length' bytes at `location' are read into
+ * `buffer'.  `result' is set to the number of bytes read, or -1.
+ */
+typedef struct {
+    off_t location;
+    char *buffer;
+    size_t length;
+    ssize_t result;
+} Zio_Read_Request;
+
+#ifdef ZIO_USE_IO_URING
+/*
+ * An io_uring instance: its file descriptor, and the submission
+ * queue, the completion queue and the submission queue entries mapped
+ * into memory.
+ */
+typedef struct {
+    int file;
+    unsigned int entry_count;
+    void *sq_map;
+    size_t sq_map_length;
+    void *cq_map;
+    size_t cq_map_length;
+    struct io_uring_sqe *sqes;
+    size_t sqes_length;
+    unsigned int *sq_head;
+    unsigned int *sq_tail;
+    unsigned int *sq_mask;
+    unsigned int *sq_array;
+    unsigned int *cq_head;
+    unsigned int *cq_tail;
+    unsigned int *cq_mask;
+    struct io_uring_cqe *cqes;
+    int broken;
+} Zio_Ring;
+#endif
+
+/*
+ * Per-thread state to uncompress ebzip slices: a z_stream which is
+ * reused with inflateReset(), a zstd context for ebzip2 slices which
+ * is created when it is used first, and a buffer for a compressed
+ * slice.  It also has an io_uring instance to read slices by a batch,
+ * which is created when it is used first.
+ */
+typedef struct {
+    z_stream stream;
+#ifdef HAVE_ZSTD
+    ZSTD_DCtx *zstd_context;
+#endif
+#ifdef ZIO_USE_IO_URING
+    Zio_Ring *ring;
+#endif
+    char in_buffer[ZIO_SIZE_PAGE << ZIO_MAX_EBZIP_LEVEL];
+} Zio_Inflater;
+
+#ifdef ENABLE_PTHREAD
+static pthread_key_t inflater_key;
+static pthread_once_t inflater_key_once = PTHREAD_ONCE_INIT;
+#else
+static Zio_Inflater *thread_inflater = NULL;
+#endif
+
+#ifdef ENABLE_PTHREAD
+/*
+ * A request to read the slice at `location' in `zio' ahead.
+ */
+typedef struct {
+    Zio *zio;
+    off_t location;
+} Zio_Read_Ahead_Request;
+
+/*
+ * The maximum number of pending read-ahead requests.
+ * (A request is discarded when the queue is full.)
+ */
+#define ZIO_READ_AHEAD_QUEUE_LENGTH	64
+
+/*
+ * Queue of read-ahead requests, and the Zio whose slice is being read
+ * by the worker thread.
+ */
+static Zio_Read_Ahead_Request read_ahead_queue[ZIO_READ_AHEAD_QUEUE_LENGTH];
+static int read_ahead_queue_head = 0;
+static int read_ahead_queue_length = 0;
+static Zio *read_ahead_current = NULL;
+
+/*
+ * The worker thread which reads slices ahead, and its state.
+ */
+static pthread_t read_ahead_thread;
+static int read_ahead_running = 0;
+static int read_ahead_stopping = 0;
+
+/*
+ * Mutex for the variables above and `read_ahead_*' members of Zio.
+ * The worker waits on `read_ahead_request_cond' for requests, and
+ * signals `read_ahead_done_cond' after it has read a slice.
+ */
+static pthread_mutex_t read_ahead_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t read_ahead_request_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t read_ahead_done_cond = PTHREAD_COND_INITIALIZER;
+#endif
+
+/*
+ * Uncompressed contents of a whole file in memory.
+ */
+typedef struct Zio_Materialized_Struct Zio_Materialized;
+
+struct Zio_Materialized_Struct {
+    /*
+     * Copy of the Zio read by the worker thread.  It has its own file
+     * descriptor, so that the Zio can be closed while it is read.
+     */
+    Zio source;
+
+    /*
+     * The contents and their length.
+     * `buffer' is allocated by mmap() if `is_mapped' is set.
+     */
+    char *buffer;
+    size_t length;
+    int is_mapped;
+
+    /*
+     * State.  `is_discarded' is set when the contents are evicted by
+     * the budget, or an error occurs.  `buffer' is freed when no
+     * thread uses it after that.
+     */
+    int is_complete;
+    int is_running;
+    int is_discarded;
+    int user_count;
+
+    /*
+     * Neighbors in the LRU list.  (`lru_next' is the less recently used)
+     */
+    Zio_Materialized *lru_prev;
+    Zio_Materialized *lru_next;
+};
+
+/*
+ * LRU list of materialized files which are not discarded, their total
+ * size, and the maximum total size.
+ */
+static Zio_Materialized *materialize_lru_head = NULL;
+static Zio_Materialized *materialize_lru_tail = NULL;
+static size_t materialize_used_size = 0;
+static size_t materialize_budget = ZIO_DEFAULT_MATERIALIZE_BUDGET;
+
+/*
+ * Mutex for the variables above and Zio_Materialized objects.
+ * `materialize_done_cond' is signaled when a worker thread finishes,
+ * or the last user of discarded contents leaves.
+ */
+#ifdef ENABLE_PTHREAD
+static pthread_mutex_t materialize_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t materialize_done_cond = PTHREAD_COND_INITIALIZER;
+#endif
+
+#ifdef ZIO_USE_SHARED_CACHE
+/*
+ * Size of a slot of the shared slice cache, and the number of slots in
+ * a set.  A slice is stored in a set chosen by its key, and a slice
+ * larger than a slot is stored as several chunks.
+ */
+#define ZIO_SHARED_SLOT_SIZE		ZIO_SIZE_PAGE
+#define ZIO_SHARED_WAY_COUNT		8
+
+/*
+ * Alignment of slots in the shared slice cache.
+ */
+#define ZIO_SHARED_ALIGNMENT		64
+
+/*
+ * Magic string at the beginning of the shared slice cache.
+ */
+#define ZIO_SHARED_CACHE_MAGIC		"EBZSHC03"
+
+/*
+ * How many times a process waits for another process creating the
+ * shared slice cache.  (It sleeps for a millisecond each time.)
+ */
+#define ZIO_SHARED_CACHE_WAIT_COUNT	1000
+
+/*
+ * Seconds after which a slot claimed by a writer is regarded as
+ * abandoned, and may be claimed by another writer.  (Writing a slot
+ * takes microseconds.)
+ */
+#define ZIO_SHARED_CLAIM_TIMEOUT	10
+
+/*
+ * Header of the shared slice cache.  `is_ready' is set after the other
+ * members are initialized.  `clock' is incremented whenever a chunk
+ * is stored.
+ */
+typedef struct {
+    char magic[8];
+    unsigned int is_ready;
+    unsigned int slot_size;
+    unsigned int way_count;
+    unsigned int set_count;
+    unsigned int clock;
+} Zio_Shared_Header;
+
+/*
+ * A slot of the shared slice cache.  A chunk is keyed by the identity
+ * of the file (device, i-node and mtime), the chunk number and the
+ * slice size.
  *
- * (In EBZIP and EPWING compressions, the size of uncompressed slice
- * is 2048.  In S-EBXA compression, the size is 4096.)
+ * The lower 32 bits of `state' are the sequence number.  It is odd
+ * while the slot is written, and it is incremented by two whenever the
+ * slot is rewritten.  (The slot is empty if `state' is 0.)  A reader
+ * checks that `state' is unchanged after copying the chunk.  While the
+ * slot is written, the upper 32 bits are the time when the writer
+ * claimed it, so that the claim and its time are published by a
+ * single compare-and-swap.  Otherwise they are 0.
+ * `stamp' is the value of `clock' in the header when the chunk was
+ * stored.
+ */
+typedef struct {
+    unsigned long long state;
+    unsigned int stamp;
+    unsigned long long device;
+    unsigned long long inode;
+    long long mtime;
+    long long chunk;
+    unsigned int slice_size;
+} Zio_Shared_Slot;
+
+#define ZIO_SHARED_SEQUENCE(state)	((unsigned int) (state))
+#define ZIO_SHARED_CLAIM_TIME(state)	((unsigned int) ((state) >> 32))
+
+/*
+ * The shared slice cache attached to this process: the memory mapping,
+ * the header, the slots and their data.
+ */
+typedef struct {
+    char *map;
+    size_t map_length;
+    Zio_Shared_Header *header;
+    Zio_Shared_Slot *slots;
+    char *data;
+    unsigned int set_count;
+} Zio_Shared_Cache;
+
+/*
+ * The shared slice cache, or NULL if it is not attached.
+ */
+static Zio_Shared_Cache *shared_cache = NULL;
+#endif /* ZIO_USE_SHARED_CACHE */
+
+#ifdef ZIO_USE_DISK_CACHE
+/*
+ * Size of the header of a disk cache file, and alignment of slices in
+ * the file.
+ */
+#define ZIO_DISK_CACHE_HEADER_SIZE	64
+#define ZIO_DISK_CACHE_ALIGNMENT	4096
+
+/*
+ * Magic string at the beginning of a disk cache file.
+ */
+#define ZIO_DISK_CACHE_MAGIC		"EBZDKC02"
+
+/*
+ * The maximum length of the name of a disk cache file, including `/'.
+ */
+#define ZIO_DISK_CACHE_MAX_NAME_LENGTH	64
+
+/*
+ * Header of a disk cache file.  It identifies the uncompressed
+ * contents.  (`crc' is 0 for an EPWING file, and `device' and `inode'
+ * are 0 for an ebzip file.)
  */
-#define ZIO_CACHE_BUFFER_SIZE (ZIO_SIZE_PAGE << ZIO_MAX_EBZIP_LEVEL)
+typedef struct {
+    char magic[8];
+    unsigned int slice_size;
+    unsigned int crc;
+    long long file_size;
+    long long mtime;
+    unsigned long long device;
+    unsigned long long inode;
+} Zio_Disk_Cache_Header;
 
 /*
- * NULL Zio ID.
+ * The disk cache of a Zio: the cache file, the slice size and the
+ * number of slices, the location of the checksums and the first slice
+ * in the file, the bitmap of valid slices, and the CRC32 checksums of
+ * the slices.
  */
-#define ZIO_ID_NONE			-1
+typedef struct {
+    int file;
+    size_t slice_size;
+    off_t slice_count;
+    off_t checksum_location;
+    off_t data_location;
+    unsigned char *bitmap;
+    unsigned int *checksums;
+} Zio_Disk_Cache;
 
 /*
- * Buffer for caching uncompressed data.
+ * Directory of disk cache files, or NULL if the disk cache is disabled.
  */
-static char *cache_buffer = NULL;
+static char *disk_cache_directory = NULL;
 
 /*
- * Zio ID which caches data in `cache_buffer'.
+ * Mutex for the bitmaps of disk caches.
  */
-static int cache_zio_id = ZIO_ID_NONE;
+#ifdef ENABLE_PTHREAD
+static pthread_mutex_t disk_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
 
 /*
- * Offset of the beginning of the cached data `cache_buffer'.
+ * A disk cache file is locked while its header is checked.  An open
+ * file description lock is used if available.  A record lock is owned
+ * by a process; it doesn't exclude threads in the process, and it is
+ * released when any descriptor of the file is closed.  In that case,
+ * `disk_cache_file_mutex' serializes opening and closing cache files
+ * in the process.
  */
-static off_t cache_location;
+#ifdef F_OFD_SETLKW
+#define ZIO_DISK_CACHE_SETLKW		F_OFD_SETLKW
+#define ZIO_DISK_CACHE_SETLK		F_OFD_SETLK
+#define zio_lock_disk_cache_files()
+#define zio_unlock_disk_cache_files()
+#else
+#define ZIO_DISK_CACHE_SETLKW		F_SETLKW
+#define ZIO_DISK_CACHE_SETLK		F_SETLK
+#define zio_lock_disk_cache_files() \
+	pthread_mutex_lock(&disk_cache_file_mutex)
+#define zio_unlock_disk_cache_files() \
+	pthread_mutex_unlock(&disk_cache_file_mutex)
+#ifdef ENABLE_PTHREAD
+static pthread_mutex_t disk_cache_file_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+#endif
+#endif /* ZIO_USE_DISK_CACHE */
 
 /*
  * Zio object counter.
@@ -161,12 +658,73 @@ static off_t cache_location;
 static int zio_counter = 0;
 
 /*
- * Mutex for cache variables.
+ * Whether files are mapped into memory when they are opened.
+ */
+static int mmap_mode = 0;
+
+/*
+ * Maximum total size of index tables loaded into memory, and the
+ * size currently used.
+ */
+static size_t index_cache_max_size = ZIO_DEFAULT_INDEX_CACHE_SIZE;
+static size_t index_cache_used_size = 0;
+
+#ifdef ZIO_USE_IO_URING
+/*
+ * Whether io_uring has failed to be set up.  (e.g. the kernel doesn't
+ * support it.)  Batches of raw reads are read by pread() after that.
+ */
+static int ring_unavailable = 0;
+#endif
+
+/*
+ * Mutex for `zio_counter', `mmap_mode', `cache_initialized',
+ * `index_cache_*' and `ring_unavailable'.
+ * (It is also used to emulate the positional read when pread() is not
+ * available, or `zio' is an ebnet file.)
  */
 #ifdef ENABLE_PTHREAD
 static pthread_mutex_t zio_mutex = PTHREAD_MUTEX_INITIALIZER;
 #endif
 
+/*
+ * I/O statistics of all Zio objects, sharded by Zio ID.  (Cache hits
+ * and misses of all Zio objects are counted in `cache_shards'.)
+ * Shards are padded so that they don't share a cache line.
+ */
+typedef struct {
+    Zio_Stats stats;
+    char padding[64];
+} Zio_Stats_Shard;
+
+static Zio_Stats_Shard global_stats[ZIO_CACHE_SHARD_COUNT];
+
+/*
+ * `global_stats' and `stats' members of Zio are counted by atomic
+ * operations.  If they are not available, they are counted under
+ * `stats_mutex'.
+ */
+#ifdef __ATOMIC_RELAXED
+#define zio_add_stat(member, value) \
+	__atomic_fetch_add(&(member), (value), __ATOMIC_RELAXED)
+#define zio_load_stat(member) __atomic_load_n(&(member), __ATOMIC_RELAXED)
+#define zio_lock_stats()
+#define zio_unlock_stats()
+#else
+#define zio_add_stat(member, value) ((member) += (value))
+#define zio_load_stat(member) (member)
+#define zio_lock_stats() pthread_mutex_lock(&stats_mutex)
+#define zio_unlock_stats() pthread_mutex_unlock(&stats_mutex)
+#ifdef ENABLE_PTHREAD
+static pthread_mutex_t stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+#endif
+
+/*
+ * Whether time spent in reading and uncompressing is measured.
+ */
+static int stats_timing = 0;
+
 /*
  * Test whether `off_t' represents a large integer.
  */
@@ -179,42 +737,199 @@ static pthread_mutex_t zio_mutex = PTHREAD_MUTEX_INITIALIZER;
 static int zio_reopen(Zio *zio, const char *file_name);
 static int zio_open_plain(Zio *zio, const char *file_name);
 static int zio_open_ebzip(Zio *zio, const char *file_name);
+#ifdef HAVE_ZSTD
+static int zio_load_ebzip2_dictionary(Zio *zio, off_t location,
+    size_t length);
+#endif
 static int zio_open_epwing(Zio *zio, const char *file_name);
 static int zio_open_epwing6(Zio *zio, const char *file_name);
 static int zio_make_epwing_huffman_tree(Zio *zio, int leaf_count);
-static ssize_t zio_read_ebzip(Zio *zio, char *buffer, size_t length);
-static ssize_t zio_read_epwing(Zio *zio, char *buffer, size_t length);
-static ssize_t zio_read_sebxa(Zio *zio, char *buffer, size_t length);
-static int zio_unzip_slice_ebzip1(Zio *zio, char *out_buffer,
-    size_t zipped_slice_size);
-static int zio_unzip_slice_epwing(Zio *zio, char *out_buffer);
-static int zio_unzip_slice_epwing6(Zio *zio, char *out_buffer);
-static int zio_unzip_slice_sebxa(Zio *zio, char *out_buffer);
+static int zio_sort_epwing_huffman_leaves(Zio_Huffman_Node *leaves,
+    int leaf_count);
+static int zio_huffman_winner(const int *frequencies, const int *winners,
+    int k);
+static void zio_push_huffman_heap(Zio_Huffman_Node **heap, int *heap_count,
+    Zio_Huffman_Node *node);
+static Zio_Huffman_Node *zio_pop_huffman_heap(Zio_Huffman_Node **heap,
+    int *heap_count);
+static int zio_load_index_table(Zio *zio, off_t location, off_t length);
+static void zio_unload_index_table(Zio *zio);
+static Zio_Cache_Entry *zio_cache_new_entry(int zio_id, off_t slice,
+    size_t size);
+static int zio_cache_copy(int zio_id, off_t slice, size_t offset,
+    char *buffer, size_t length);
+static int zio_cache_contains(int zio_id, off_t slice);
+static void zio_cache_insert(Zio_Cache_Entry *entry);
+static void zio_cache_purge(int zio_id);
+#ifdef ZIO_USE_SHARED_CACHE
+static unsigned int zio_shared_cache_set_count(size_t size);
+static size_t zio_shared_cache_length(unsigned int set_count);
+static size_t zio_shared_cache_slots_offset(void);
+static size_t zio_shared_cache_data_offset(unsigned int set_count);
+static void zio_shared_cache_sleep(void);
+static Zio_Shared_Slot *zio_shared_cache_set(Zio *zio, off_t chunk,
+    size_t slice_size, Zio_Shared_Slot *key);
+static int zio_shared_cache_match(Zio_Shared_Slot *slot,
+    const Zio_Shared_Slot *key);
+static int zio_shared_cache_is_abandoned(unsigned long long state,
+    unsigned int now);
+static int zio_shared_cache_read_chunk(Zio *zio, off_t chunk,
+    size_t slice_size, char *buffer);
+static void zio_shared_cache_write_chunk(Zio *zio, off_t chunk,
+    size_t slice_size, const char *buffer);
+#endif
+static int zio_shared_cache_copy(Zio *zio, off_t slice, char *buffer,
+    size_t size);
+static void zio_shared_cache_store(Zio *zio, off_t slice, const char *buffer,
+    size_t size);
+static void zio_open_disk_cache(Zio *zio);
+static void zio_close_disk_cache(Zio *zio);
+static int zio_disk_cache_read(Zio *zio, off_t slice, char *buffer,
+    size_t size);
+static void zio_disk_cache_write(Zio *zio, off_t slice, const char *buffer,
+    size_t size);
+#ifdef ZIO_USE_DISK_CACHE
+static void zio_disk_cache_drop(Zio_Disk_Cache *cache, off_t slice);
+#endif
+static int zio_load_stored_slice(Zio *zio, off_t slice);
+static int zio_copy_stored_slice(Zio *zio, off_t slice, char *buffer,
+    size_t size);
+static void zio_store_slice(Zio *zio, off_t slice, const char *buffer,
+    size_t size);
+static void zio_request_read_ahead(Zio *zio, off_t location, size_t length);
+static void zio_cancel_read_ahead(Zio *zio);
+static void zio_stop_read_ahead(void);
+#ifdef ENABLE_PTHREAD
+static void *zio_read_ahead_worker(void *arg);
+#endif
+static ssize_t zio_pread_materialized(Zio *zio, off_t location,
+    char *buffer, size_t length);
+static void zio_unlink_materialized(Zio_Materialized *materialized);
+static void zio_link_materialized(Zio_Materialized *materialized);
+static void zio_discard_materialized_buffer(Zio_Materialized *materialized);
+static void zio_free_materialized_buffer(Zio_Materialized *materialized);
+#ifdef ENABLE_PTHREAD
+static void *zio_materialize_worker(void *arg);
+#endif
+static void zio_add_stats(Zio_Stats *stats, Zio_Stats *source);
+static Zio_Stats *zio_global_stats(Zio *zio);
+static unsigned long long zio_clock(void);
+static unsigned long long zio_elapsed(unsigned long long start_time);
+static void zio_count_raw_read(Zio *zio, size_t length, int count,
+    unsigned long long nanoseconds);
+static void zio_count_slice(Zio *zio, unsigned long long nanoseconds);
+static void zio_count_cache_hits(Zio *zio, int hit_count);
+#ifdef ZIO_USE_SHARED_CACHE
+static void zio_count_shared_cache_hit(Zio *zio);
+#endif
+#ifdef ZIO_USE_DISK_CACHE
+static void zio_count_disk_cache_hit(Zio *zio);
+#endif
+static ssize_t zio_pread_ebzip(Zio *zio, off_t location, char *buffer,
+    size_t length);
+static int zio_uncompress_ebzip_slice(Zio *zio, off_t slice,
+    char *out_buffer);
+static int zio_load_ebzip_slices(Zio *zio, off_t slice, int slice_count);
+static ssize_t zio_pread_epwing(Zio *zio, off_t location, char *buffer,
+    size_t length);
+static int zio_uncompress_epwing_slice(Zio *zio, off_t slice,
+    char *out_buffer);
+static ssize_t zio_pread_sebxa(Zio *zio, off_t location, char *buffer,
+    size_t length);
+static int zio_uncompress_sebxa_slice(Zio *zio, int slice_index,
+    char *out_buffer);
+static int zio_unzip_slice_ebzip1(Zio *zio, off_t location, char *out_buffer,
+    size_t zipped_slice_size, const char *zipped_slice);
+static int zio_unzip_slice_ebzip2(Zio *zio, off_t location, char *out_buffer,
+    size_t zipped_slice_size, const char *zipped_slice);
+static Zio_Inflater *zio_get_inflater(void);
+static void zio_release_inflater(void);
+#ifdef ENABLE_PTHREAD
+static void zio_create_inflater_key(void);
+#endif
+static void zio_destroy_inflater(void *inflater);
+static void zio_open_bit_stream(Zio_Bit_Stream *stream, Zio *zio,
+    off_t location);
+static void zio_fill_bit_stream(Zio_Bit_Stream *stream);
+static Zio_Huffman_Node *zio_decode_huffman(Zio_Bit_Stream *stream);
+static int zio_unzip_slice_epwing(Zio *zio, off_t location, char *out_buffer);
+static int zio_unzip_slice_epwing6(Zio *zio, off_t location,
+    char *out_buffer);
+static int zio_unzip_slice_sebxa(Zio *zio, off_t location, char *out_buffer);
 static int zio_open_raw(Zio *zio, const char *file_name);
 static void zio_close_raw(Zio *zio);
 static off_t zio_lseek_raw(Zio *zio, off_t offset, int whence);
 static ssize_t zio_read_raw(Zio *zio, void *buffer, size_t length);
+static ssize_t zio_pread_raw(Zio *zio, off_t location, void *buffer,
+    size_t length);
+static int zio_pread_raw_batch(Zio *zio, Zio_Read_Request *requests,
+    int request_count);
+#ifdef ZIO_USE_IO_URING
+static Zio_Ring *zio_get_ring(void);
+static Zio_Ring *zio_open_ring(void);
+static void zio_close_ring(Zio_Ring *ring);
+static int zio_submit_ring(Zio_Ring *ring, Zio *zio,
+    Zio_Read_Request *requests, int request_count);
+#endif
 
 
 /*
- * Initialize cache buffer.
+ * Initialize the slice cache with the default size.
  */
 int
 zio_initialize_library(void)
 {
+    return zio_initialize_library2(ZIO_DEFAULT_CACHE_SIZE);
+}
+
+
+/*
+ * Initialize the slice cache.  It memories at most `cache_size' bytes
+ * of uncompressed slices.  (At least one slice is memorized in each
+ * shard, even if `cache_size' is very small.)
+ */
+int
+zio_initialize_library2(size_t cache_size)
+{
+    Zio_Cache_Shard *shard;
+    int bucket_count;
+    int i;
+
     pthread_mutex_lock(&zio_mutex);
-    LOG(("in: zio_initialize_library()"));
+    LOG(("in: zio_initialize_library2(cache_size=%ld)", (long)cache_size));
+
+    if (cache_initialized)
+	goto succeeded;
 
     /*
-     * Allocate memory for cache buffer.
+     * Allocate hash buckets.  The number of buckets is a power of two
+     * which is not less than the number of pages in a shard.
      */
-    if (cache_buffer == NULL) {
-	cache_buffer = (char *) malloc(ZIO_CACHE_BUFFER_SIZE);
-	if (cache_buffer == NULL)
+    bucket_count = ZIO_CACHE_MIN_BUCKET_COUNT;
+    while (bucket_count < cache_size / ZIO_CACHE_SHARD_COUNT / ZIO_SIZE_PAGE)
+	bucket_count <<= 1;
+
+    for (i = 0, shard = cache_shards; i < ZIO_CACHE_SHARD_COUNT;
+	 i++, shard++) {
+	shard->buckets = (Zio_Cache_Entry **)
+	    calloc(bucket_count, sizeof(Zio_Cache_Entry *));
+	if (shard->buckets == NULL)
 	    goto failed;
+	shard->bucket_count = bucket_count;
+	shard->lru_head = NULL;
+	shard->lru_tail = NULL;
+	shard->used_size = 0;
+	shard->max_size = cache_size / ZIO_CACHE_SHARD_COUNT;
+	shard->hit_count = 0;
+	shard->miss_count = 0;
+#ifdef ENABLE_PTHREAD
+	pthread_mutex_init(&shard->mutex, NULL);
+#endif
     }
+    cache_initialized = 1;
 
-    LOG(("out: zio_initialize_library() = %d", 0));
+  succeeded:
+    LOG(("out: zio_initialize_library2() = %d", 0));
     pthread_mutex_unlock(&zio_mutex);
     return 0;
 
@@ -222,25 +937,56 @@ zio_initialize_library(void)
      * An error occurs...
      */
   failed:
-    LOG(("out: zio_initialize_library() = %d", -1));
+    while (0 < i) {
+	i--;
+	free(cache_shards[i].buckets);
+	cache_shards[i].buckets = NULL;
+#ifdef ENABLE_PTHREAD
+	pthread_mutex_destroy(&cache_shards[i].mutex);
+#endif
+    }
+    LOG(("out: zio_initialize_library2() = %d", -1));
     pthread_mutex_unlock(&zio_mutex);
     return -1;
 }
 
 
 /*
- * Clear cache buffer.
+ * Clear the slice cache.
  */
 void
 zio_finalize_library(void)
 {
+    Zio_Cache_Shard *shard;
+    Zio_Cache_Entry *entry;
+    Zio_Cache_Entry *next_entry;
+    int i;
+
+    zio_stop_read_ahead();
+    zio_detach_shared_cache();
+
     pthread_mutex_lock(&zio_mutex);
     LOG(("in: zio_finalize_library()"));
 
-    if (cache_buffer != NULL)
-	free(cache_buffer);
-    cache_buffer = NULL;
-    cache_zio_id = ZIO_ID_NONE;
+    if (cache_initialized) {
+	for (i = 0, shard = cache_shards; i < ZIO_CACHE_SHARD_COUNT;
+	     i++, shard++) {
+	    for (entry = shard->lru_head; entry != NULL; entry = next_entry) {
+		next_entry = entry->lru_next;
+		free(entry);
+	    }
+	    free(shard->buckets);
+	    shard->buckets = NULL;
+	    shard->lru_head = NULL;
+	    shard->lru_tail = NULL;
+	    shard->used_size = 0;
+#ifdef ENABLE_PTHREAD
+	    pthread_mutex_destroy(&shard->mutex);
+#endif
+	}
+	cache_initialized = 0;
+    }
+    zio_release_inflater();
 
     LOG(("out: zio_finalize_library()"));
     pthread_mutex_unlock(&zio_mutex);
@@ -248,1014 +994,4006 @@ zio_finalize_library(void)
 
 
 /*
- * Initialize `zio'.
+ * Get hit and miss counts of the slice cache.
  */
 void
-zio_initialize(Zio *zio)
+zio_cache_statistics(unsigned long *hit_count, unsigned long *miss_count)
 {
-    LOG(("in: zio_initialize()"));
+    Zio_Cache_Shard *shard;
+    int i;
 
-    zio->id = -1;
-    zio->file = -1;
-    zio->huffman_nodes = NULL;
-    zio->huffman_root = NULL;
-    zio->code = ZIO_INVALID;
-    zio->file_size = 0;
-    zio->is_ebnet = 0;
+    LOG(("in: zio_cache_statistics()"));
 
-    LOG(("out: zio_initialize()"));
+    *hit_count = 0;
+    *miss_count = 0;
+
+    if (cache_initialized) {
+	for (i = 0, shard = cache_shards; i < ZIO_CACHE_SHARD_COUNT;
+	     i++, shard++) {
+	    pthread_mutex_lock(&shard->mutex);
+	    *hit_count += shard->hit_count;
+	    *miss_count += shard->miss_count;
+	    pthread_mutex_unlock(&shard->mutex);
+	}
+    }
+
+    LOG(("out: zio_cache_statistics(hit_count=%lu, miss_count=%lu)",
+	*hit_count, *miss_count));
 }
 
 
 /*
- * Finalize `zio'.
+ * Set the maximum total size of index tables loaded into memory.
+ * If `cache_size' is 0, no index table is loaded.  It affects files
+ * opened after the call.
  */
 void
-zio_finalize(Zio *zio)
+zio_set_index_cache_size(size_t cache_size)
 {
-    LOG(("in: zio_finalize(zio=%d)", (int)zio->id));
+    pthread_mutex_lock(&zio_mutex);
+    LOG(("in: zio_set_index_cache_size(cache_size=%ld)", (long)cache_size));
 
-    zio_close(zio);
-    if (zio->huffman_nodes != NULL)
-	free(zio->huffman_nodes);
+    index_cache_max_size = cache_size;
 
-    zio->id = -1;
-    zio->huffman_nodes = NULL;
-    zio->huffman_root = NULL;
-    zio->code = ZIO_INVALID;
+    LOG(("out: zio_set_index_cache_size()"));
+    pthread_mutex_unlock(&zio_mutex);
+}
 
-    LOG(("out: zio_finalize()"));
+
+/*
+ * Set whether files are mapped into memory when they are opened.
+ * Reading a mapped file doesn't need a system call, and
+ * zio_map_range() is available for a mapped plain file.
+ * If mmap() is not available, files are never mapped.
+ */
+void
+zio_set_mmap_mode(int flag)
+{
+    pthread_mutex_lock(&zio_mutex);
+    LOG(("in: zio_set_mmap_mode(flag=%d)", flag));
+
+    mmap_mode = flag;
+
+    LOG(("out: zio_set_mmap_mode()"));
+    pthread_mutex_unlock(&zio_mutex);
 }
 
 
 /*
- * Set S-EBXA compression mode.
+ * Allocate a cache entry for the slice `slice' of the Zio `zio_id'.
+ * The entry is not registered to the cache until zio_cache_insert()
+ * is called, so that the caller can uncompress a slice into
+ * `entry->buffer' without locking the cache.
  */
-int
-zio_set_sebxa_mode(Zio *zio, off_t index_location, off_t index_base,
-    off_t zio_start_location, off_t zio_end_location)
+static Zio_Cache_Entry *
+zio_cache_new_entry(int zio_id, off_t slice, size_t size)
 {
-    LOG(("in: zio_set_sebxa_mode(zio=%d, index_location=%ld, index_base=%ld, \
-zio_start_location=%ld, zio_end_location=%ld)",
-	(int)zio->id, (long)index_location, (long)index_base,
-	(long)zio_start_location, (long)zio_end_location));
+    Zio_Cache_Entry *entry;
 
-    if (zio->code != ZIO_PLAIN)
-	goto failed;
+    entry = (Zio_Cache_Entry *) malloc(sizeof(Zio_Cache_Entry) + size);
+    if (entry == NULL)
+	return NULL;
 
-    zio->code = ZIO_SEBXA;
-    zio->index_location = index_location;
-    zio->index_base = index_base;
-    zio->zio_start_location = zio_start_location;
-    zio->zio_end_location = zio_end_location;
-    zio->file_size = zio_end_location;
+    entry->zio_id = zio_id;
+    entry->slice = slice;
+    entry->size = size;
+    entry->buffer = (char *) (entry + 1);
+    entry->hash_next = NULL;
+    entry->lru_prev = NULL;
+    entry->lru_next = NULL;
 
-    LOG(("out: zio_set_sebxa_mode() = %d", 0));
-    return 0;
+    return entry;
+}
 
-    /*
-     * An error occurs...
-     */
-  failed:
-    LOG(("out: zio_set_sebxa_mode() = %d", -1));
-    return -1;
+
+/*
+ * Unlink `entry' from the LRU list of `shard'.
+ */
+static void
+zio_cache_unlink_lru(Zio_Cache_Shard *shard, Zio_Cache_Entry *entry)
+{
+    if (entry->lru_prev != NULL)
+	entry->lru_prev->lru_next = entry->lru_next;
+    else
+	shard->lru_head = entry->lru_next;
+    if (entry->lru_next != NULL)
+	entry->lru_next->lru_prev = entry->lru_prev;
+    else
+	shard->lru_tail = entry->lru_prev;
+    entry->lru_prev = NULL;
+    entry->lru_next = NULL;
 }
 
+
 /*
- * Open `file'.
+ * Link `entry' at the head (most recently used end) of the LRU list.
  */
-int
-zio_open(Zio *zio, const char *file_name, Zio_Code zio_code)
+static void
+zio_cache_link_lru(Zio_Cache_Shard *shard, Zio_Cache_Entry *entry)
 {
-    int result;
+    entry->lru_prev = NULL;
+    entry->lru_next = shard->lru_head;
+    if (shard->lru_head != NULL)
+	shard->lru_head->lru_prev = entry;
+    else
+	shard->lru_tail = entry;
+    shard->lru_head = entry;
+}
 
-    LOG(("in: zio_open(zio=%d, file_name=%s, zio_code=%d)",
-	(int)zio->id, file_name, zio_code));
 
-    if (0 <= zio->file) {
-	if (zio_code == ZIO_REOPEN) {
-	    result = 0;
-	    goto succeeded;
-	}
-	zio_finalize(zio);
-	zio_initialize(zio);
+/*
+ * Remove `entry' from `shard' and free it.
+ */
+static void
+zio_cache_remove(Zio_Cache_Shard *shard, Zio_Cache_Entry *entry)
+{
+    Zio_Cache_Entry **entry_p;
+    unsigned long hash;
+
+    hash = zio_cache_hash(entry->zio_id, entry->slice);
+    entry_p = shard->buckets
+	+ ((hash / ZIO_CACHE_SHARD_COUNT) & (shard->bucket_count - 1));
+    while (*entry_p != entry)
+	entry_p = &(*entry_p)->hash_next;
+    *entry_p = entry->hash_next;
+
+    zio_cache_unlink_lru(shard, entry);
+    shard->used_size -= entry->size;
+    free(entry);
+}
+
+
+/*
+ * Copy `length' bytes at `offset' in the cached slice to `buffer'.
+ * Return 0 upon cache hit, -1 upon cache miss.
+ */
+static int
+zio_cache_copy(int zio_id, off_t slice, size_t offset, char *buffer,
+    size_t length)
+{
+    Zio_Cache_Shard *shard;
+    Zio_Cache_Entry *entry;
+    unsigned long hash;
+
+    if (!cache_initialized || zio_id < 0)
+	return -1;
+
+    hash = zio_cache_hash(zio_id, slice);
+    shard = cache_shards + hash % ZIO_CACHE_SHARD_COUNT;
+
+    pthread_mutex_lock(&shard->mutex);
+    for (entry = shard->buckets[(hash / ZIO_CACHE_SHARD_COUNT)
+	     & (shard->bucket_count - 1)];
+	 entry != NULL; entry = entry->hash_next) {
+	if (entry->zio_id == zio_id && entry->slice == slice)
+	    break;
+    }
+    if (entry == NULL) {
+	shard->miss_count++;
+	pthread_mutex_unlock(&shard->mutex);
+	return -1;
     }
 
-    switch (zio_code) {
-    case ZIO_REOPEN:
-	result = zio_reopen(zio, file_name);
-	break;
-    case ZIO_PLAIN:
-	result = zio_open_plain(zio, file_name);
-	break;
-    case ZIO_EBZIP1:
-	result = zio_open_ebzip(zio, file_name);
-	break;
-    case ZIO_EPWING:
-	result = zio_open_epwing(zio, file_name);
-	break;
-    case ZIO_EPWING6:
-	result = zio_open_epwing6(zio, file_name);
-	break;
-    case ZIO_SEBXA:
-	result = zio_open_plain(zio, file_name);
-	break;
-    default:
-	result = -1;
+    memcpy(buffer, entry->buffer + offset, length);
+    if (shard->lru_head != entry) {
+	zio_cache_unlink_lru(shard, entry);
+	zio_cache_link_lru(shard, entry);
     }
+    shard->hit_count++;
+    pthread_mutex_unlock(&shard->mutex);
 
-  succeeded:
-    LOG(("out: zio_open() = %d", result));
-    return result;
+    return 0;
 }
 
 
 /*
- * Reopen a file.
+ * Test whether the slice `slice' of the Zio `zio_id' is in the slice
+ * cache.  A hit or a miss is not counted, and the LRU list is not
+ * updated.
  */
 static int
-zio_reopen(Zio *zio, const char *file_name)
+zio_cache_contains(int zio_id, off_t slice)
 {
-    LOG(("in: zio_reopen(zio=%d, file_name=%s)", (int)zio->id, file_name));
+    Zio_Cache_Shard *shard;
+    Zio_Cache_Entry *entry;
+    unsigned long hash;
 
-    if (zio->code == ZIO_INVALID)
-	goto failed;
+    if (!cache_initialized || zio_id < 0)
+	return 0;
 
-    if (zio_open_raw(zio, file_name) < 0) {
-	zio->code = ZIO_INVALID;
-	goto failed;
-    }
-    zio->location = 0;
+    hash = zio_cache_hash(zio_id, slice);
+    shard = cache_shards + hash % ZIO_CACHE_SHARD_COUNT;
 
-    LOG(("out: zio_reopen() = %d", zio->file));
-    return zio->file;
+    pthread_mutex_lock(&shard->mutex);
+    for (entry = shard->buckets[(hash / ZIO_CACHE_SHARD_COUNT)
+	     & (shard->bucket_count - 1)];
+	 entry != NULL; entry = entry->hash_next) {
+	if (entry->zio_id == zio_id && entry->slice == slice)
+	    break;
+    }
+    pthread_mutex_unlock(&shard->mutex);
 
-    /*
-     * An error occurs...
-     */
-  failed:
-    LOG(("out: zio_reopen() = %d", -1));
-    return -1;
+    return entry != NULL;
 }
 
 
 /*
- * Open an non-compressed file.
+ * Register `entry' to the slice cache.  Least recently used slices are
+ * discarded to keep the cache size.  If the cache already has the same
+ * slice (another thread has uncompressed it), `entry' is freed.
  */
-static int
-zio_open_plain(Zio *zio, const char *file_name)
+static void
+zio_cache_insert(Zio_Cache_Entry *entry)
 {
-    LOG(("in: zio_open_plain(zio=%d, file_name=%s)", (int)zio->id, file_name));
+    Zio_Cache_Shard *shard;
+    Zio_Cache_Entry *e;
+    Zio_Cache_Entry **bucket;
+    unsigned long hash;
+
+    if (!cache_initialized || entry->zio_id < 0) {
+	free(entry);
+	return;
+    }
 
-    if (zio_open_raw(zio, file_name) < 0)
-	goto failed;
+    hash = zio_cache_hash(entry->zio_id, entry->slice);
+    shard = cache_shards + hash % ZIO_CACHE_SHARD_COUNT;
+
+    pthread_mutex_lock(&shard->mutex);
+    bucket = shard->buckets
+	+ ((hash / ZIO_CACHE_SHARD_COUNT) & (shard->bucket_count - 1));
+    for (e = *bucket; e != NULL; e = e->hash_next) {
+	if (e->zio_id == entry->zio_id && e->slice == entry->slice) {
+	    pthread_mutex_unlock(&shard->mutex);
+	    free(entry);
+	    return;
+	}
+    }
 
-    zio->code = ZIO_PLAIN;
-    zio->slice_size = ZIO_SIZE_PAGE;
-    zio->file_size = zio_lseek_raw(zio, 0, SEEK_END);
-    if (zio->file_size < 0 || zio_lseek_raw(zio, 0, SEEK_SET) < 0)
-	goto failed;
+    while (shard->lru_tail != NULL
+	&& shard->max_size < shard->used_size + entry->size)
+	zio_cache_remove(shard, shard->lru_tail);
 
-    /*
-     * Assign ID.
-     */
-    pthread_mutex_lock(&zio_mutex);
-    zio->id = zio_counter++;
-    pthread_mutex_unlock(&zio_mutex);
+    entry->hash_next = *bucket;
+    *bucket = entry;
+    zio_cache_link_lru(shard, entry);
+    shard->used_size += entry->size;
+    pthread_mutex_unlock(&shard->mutex);
+}
 
-    LOG(("out: zio_open_plain(zio=%d) = %d", (int)zio->id, zio->file));
-    return zio->file;
 
-    /*
-     * An error occurs...
-     */
-  failed:
-    if (0 <= zio->file)
-	zio_close_raw(zio);
-    zio->file = -1;
-    zio->code = ZIO_INVALID;
+/*
+ * Discard all cached slices of the Zio `zio_id'.
+ */
+static void
+zio_cache_purge(int zio_id)
+{
+    Zio_Cache_Shard *shard;
+    Zio_Cache_Entry *entry;
+    Zio_Cache_Entry *next_entry;
+    int i;
 
-    LOG(("out: zio_open_plain() = %d", -1));
-    return -1;
+    if (!cache_initialized)
+	return;
+
+    for (i = 0, shard = cache_shards; i < ZIO_CACHE_SHARD_COUNT;
+	 i++, shard++) {
+	pthread_mutex_lock(&shard->mutex);
+	for (entry = shard->lru_head; entry != NULL; entry = next_entry) {
+	    next_entry = entry->lru_next;
+	    if (entry->zio_id == zio_id)
+		zio_cache_remove(shard, entry);
+	}
+	pthread_mutex_unlock(&shard->mutex);
+    }
 }
 
 
 /*
- * Open an EBZIP compression file.
+ * Attach the shared slice cache at `path', which has `size' bytes.
+ *
+ * Uncompressed slices are shared among processes through the cache.
+ * If `path' begins with `/' and has no other `/', it is a POSIX shared
+ * memory object (if shm_open() is available).  Otherwise, it is a file
+ * which is mapped into memory (e.g. a file in /dev/shm).  The cache is
+ * created if it doesn't exist.  Otherwise, the existing cache is
+ * attached, and `size' is ignored.
+ *
+ * It must not be called while Zio objects are read.
+ * If it succeeds, 0 is returned.  Otherwise, -1 is returned.
  */
-static int
-zio_open_ebzip(Zio *zio, const char *file_name)
+int
+zio_attach_shared_cache(const char *path, size_t size)
 {
-    char header[ZIO_SIZE_EBZIP_HEADER];
-    int ebzip_mode;
+#ifdef ZIO_USE_SHARED_CACHE
+    Zio_Shared_Cache *cache = NULL;
+    Zio_Shared_Header *header;
+    struct stat st;
+    void *map = MAP_FAILED;
+    size_t map_length = 0;
+    size_t slots_offset;
+    size_t data_offset;
+    unsigned int set_count;
+    int file = -1;
+    int is_created = 0;
+    int is_shm = 0;
+    int i;
+#endif
 
-    LOG(("in: zio_open_ebzip(zio=%d, file_name=%s)", (int)zio->id, file_name));
+    pthread_mutex_lock(&zio_mutex);
+    LOG(("in: zio_attach_shared_cache(path=%s, size=%ld)", path,
+	(long)size));
 
-    /*
-     * Try to open a `*.ebz' file.
-     */
-    if (zio_open_raw(zio, file_name) < 0)
+#ifdef ZIO_USE_SHARED_CACHE
+    if (shared_cache != NULL)
 	goto failed;
 
     /*
-     * Read header part of the ebzip'ped file.
+     * Open the cache, or create it.
      */
-    if (zio_read_raw(zio, header, ZIO_SIZE_EBZIP_HEADER)
-	!= ZIO_SIZE_EBZIP_HEADER)
+#ifdef HAVE_SHM_OPEN
+    if (*path == '/' && strchr(path + 1, '/') == NULL)
+	is_shm = 1;
+#endif
+    for (i = 0; i < 2 && file < 0; i++) {
+#ifdef HAVE_SHM_OPEN
+	if (is_shm)
+	    file = shm_open(path, O_RDWR | O_CREAT | O_EXCL, 0600);
+	else
+#endif
+	    file = open(path, O_RDWR | O_CREAT | O_EXCL | O_BINARY, 0600);
+	if (0 <= file) {
+	    is_created = 1;
+	    break;
+	}
+	if (errno != EEXIST)
+	    goto failed;
+#ifdef HAVE_SHM_OPEN
+	if (is_shm)
+	    file = shm_open(path, O_RDWR, 0);
+	else
+#endif
+	    file = open(path, O_RDWR | O_BINARY);
+	if (file < 0 && errno != ENOENT)
+	    goto failed;
+    }
+    if (file < 0)
 	goto failed;
-    ebzip_mode = zio_uint1(header + 5) >> 4;
-    zio->code = ZIO_EBZIP1;
-    zio->zip_level = zio_uint1(header + 5) & 0x0f;
-    zio->slice_size = ZIO_SIZE_PAGE << zio->zip_level;
-    zio->file_size = zio_uint5(header +  9);
-    zio->crc = zio_uint4(header + 14);
-    zio->mtime = zio_uint4(header + 18);
-    zio->location = 0;
 
-    if (zio->file_size      < (off_t) 1 << 16)
-	zio->index_width = 2;
-    else if (zio->file_size < (off_t) 1 << 24)
-	zio->index_width = 3;
-    else if (zio->file_size < (off_t) 1 << 32 || !off_t_is_large)
-	zio->index_width = 4;
-    else
-	zio->index_width = 5;
+    if (is_created) {
+	set_count = zio_shared_cache_set_count(size);
+	if (set_count == 0)
+	    goto failed;
+	map_length = zio_shared_cache_length(set_count);
+	if (ftruncate(file, (off_t) map_length) < 0)
+	    goto failed;
+    } else {
+	/*
+	 * Wait until the process creating the cache sets its size.
+	 */
+	for (i = 0; i < ZIO_SHARED_CACHE_WAIT_COUNT; i++) {
+	    if (fstat(file, &st) < 0)
+		goto failed;
+	    if ((off_t) sizeof(Zio_Shared_Header) <= st.st_size)
+		break;
+	    zio_shared_cache_sleep();
+	}
+	if (st.st_size < (off_t) sizeof(Zio_Shared_Header)
+	    || (off_t)(size_t) st.st_size != st.st_size)
+	    goto failed;
+	map_length = (size_t) st.st_size;
+    }
 
-    /*
-     * Check zio header information.
-     */
-    if (memcmp(header, "EBZip", 5) != 0
-	|| ZIO_SIZE_PAGE << ZIO_MAX_EBZIP_LEVEL < zio->slice_size)
+    map = mmap(NULL, map_length, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+    if (map == MAP_FAILED)
 	goto failed;
+    close(file);
+    file = -1;
+    header = (Zio_Shared_Header *) map;
 
-    if (off_t_is_large) {
-	if (ebzip_mode != 1 && ebzip_mode != 2)
-	    goto failed;
+    if (is_created) {
+	/*
+	 * Initialize the header.  The slots are filled with zero by
+	 * ftruncate(); that is, they are empty.
+	 */
+	header->slot_size = ZIO_SHARED_SLOT_SIZE;
+	header->way_count = ZIO_SHARED_WAY_COUNT;
+	header->set_count = set_count;
+	header->clock = 0;
+	memcpy(header->magic, ZIO_SHARED_CACHE_MAGIC, sizeof(header->magic));
+	__atomic_store_n(&header->is_ready, 1, __ATOMIC_RELEASE);
     } else {
-	if (ebzip_mode != 1)
+	/*
+	 * Wait until the process creating the cache initializes the
+	 * header, and check it.
+	 */
+	for (i = 0; i < ZIO_SHARED_CACHE_WAIT_COUNT; i++) {
+	    if (__atomic_load_n(&header->is_ready, __ATOMIC_ACQUIRE))
+		break;
+	    zio_shared_cache_sleep();
+	}
+	if (!__atomic_load_n(&header->is_ready, __ATOMIC_ACQUIRE)
+	    || memcmp(header->magic, ZIO_SHARED_CACHE_MAGIC,
+		sizeof(header->magic)) != 0
+	    || header->slot_size != ZIO_SHARED_SLOT_SIZE
+	    || header->way_count != ZIO_SHARED_WAY_COUNT
+	    || header->set_count == 0
+	    || map_length < zio_shared_cache_length(header->set_count))
 	    goto failed;
+	set_count = header->set_count;
     }
 
-    /*
-     * Assign ID.
-     */
-    pthread_mutex_lock(&zio_mutex);
-    zio->id = zio_counter++;
+    cache = (Zio_Shared_Cache *) malloc(sizeof(Zio_Shared_Cache));
+    if (cache == NULL)
+	goto failed;
+    slots_offset = zio_shared_cache_slots_offset();
+    data_offset = zio_shared_cache_data_offset(set_count);
+    cache->map = (char *) map;
+    cache->map_length = map_length;
+    cache->header = header;
+    cache->slots = (Zio_Shared_Slot *) ((char *) map + slots_offset);
+    cache->data = (char *) map + data_offset;
+    cache->set_count = set_count;
+    shared_cache = cache;
+
+    LOG(("out: zio_attach_shared_cache() = %d", 0));
     pthread_mutex_unlock(&zio_mutex);
-
-    LOG(("out: zio_open_ebzip(zio=%d) = %d", (int)zio->id, zio->file));
-    return zio->file;
+    return 0;
 
     /*
      * An error occurs...
      */
   failed:
-    if (0 <= zio->file)
-	zio_close_raw(zio);
-    zio->file = -1;
-    zio->code = ZIO_INVALID;
-    LOG(("out: zio_open_ebzip() = %d", -1));
+    if (map != MAP_FAILED)
+	munmap(map, map_length);
+    if (0 <= file)
+	close(file);
+    if (is_created) {
+#ifdef HAVE_SHM_OPEN
+	if (is_shm)
+	    shm_unlink(path);
+	else
+#endif
+	    unlink(path);
+    }
+#endif
+    LOG(("out: zio_attach_shared_cache() = %d", -1));
+    pthread_mutex_unlock(&zio_mutex);
     return -1;
 }
 
 
 /*
- * The buffer size must be 512 bytes, the number of 8 bit nodes.
+ * Detach the shared slice cache.  The cache itself remains, and other
+ * processes can still use it.
+ *
+ * It must not be called while Zio objects are read.
  */
-#define ZIO_EPWING_BUFFER_SIZE 512
+void
+zio_detach_shared_cache(void)
+{
+    pthread_mutex_lock(&zio_mutex);
+    LOG(("in: zio_detach_shared_cache()"));
+
+#ifdef ZIO_USE_SHARED_CACHE
+    if (shared_cache != NULL) {
+	munmap(shared_cache->map, shared_cache->map_length);
+	free(shared_cache);
+	shared_cache = NULL;
+    }
+#endif
+
+    LOG(("out: zio_detach_shared_cache()"));
+    pthread_mutex_unlock(&zio_mutex);
+}
+
 
+#ifdef ZIO_USE_SHARED_CACHE
 /*
- * Open an EPWING compression file.
+ * Get the number of sets of a shared slice cache which has at most
+ * `size' bytes.
+ */
+static unsigned int
+zio_shared_cache_set_count(size_t size)
+{
+    size_t set_size;
+    size_t set_count;
+
+    set_size = (sizeof(Zio_Shared_Slot) + ZIO_SHARED_SLOT_SIZE)
+	* ZIO_SHARED_WAY_COUNT;
+    if (size < zio_shared_cache_slots_offset() + ZIO_SHARED_SLOT_SIZE)
+	return 0;
+    set_count = (size - zio_shared_cache_slots_offset()
+	- ZIO_SHARED_SLOT_SIZE) / set_size;
+    if (UINT_MAX < set_count)
+	set_count = UINT_MAX;
+    return (unsigned int) set_count;
+}
+
+
+/*
+ * Get the length of a shared slice cache which has `set_count' sets.
+ */
+static size_t
+zio_shared_cache_length(unsigned int set_count)
+{
+    return zio_shared_cache_data_offset(set_count)
+	+ (size_t) set_count * ZIO_SHARED_WAY_COUNT * ZIO_SHARED_SLOT_SIZE;
+}
+
+
+/*
+ * Get the offset of the slots in a shared slice cache.
+ */
+static size_t
+zio_shared_cache_slots_offset(void)
+{
+    return (sizeof(Zio_Shared_Header) + ZIO_SHARED_ALIGNMENT - 1)
+	/ ZIO_SHARED_ALIGNMENT * ZIO_SHARED_ALIGNMENT;
+}
+
+
+/*
+ * Get the offset of slot data in a shared slice cache which has
+ * `set_count' sets.
+ */
+static size_t
+zio_shared_cache_data_offset(unsigned int set_count)
+{
+    size_t offset;
+
+    offset = zio_shared_cache_slots_offset()
+	+ (size_t) set_count * ZIO_SHARED_WAY_COUNT * sizeof(Zio_Shared_Slot);
+    return (offset + ZIO_SHARED_SLOT_SIZE - 1) / ZIO_SHARED_SLOT_SIZE
+	* ZIO_SHARED_SLOT_SIZE;
+}
+
+
+/*
+ * Sleep for a while, waiting for another process.
+ */
+static void
+zio_shared_cache_sleep(void)
+{
+    struct timespec interval;
+
+    interval.tv_sec = 0;
+    interval.tv_nsec = 1000000;
+    nanosleep(&interval, NULL);
+}
+
+
+/*
+ * Get the key of the `chunk'th chunk of slices in `zio' whose size is
+ * `slice_size', and return the set which the chunk belongs to.
+ */
+static Zio_Shared_Slot *
+zio_shared_cache_set(Zio *zio, off_t chunk, size_t slice_size,
+    Zio_Shared_Slot *key)
+{
+    unsigned long long hash;
+
+    key->device = (unsigned long long) zio->file_device;
+    key->inode = (unsigned long long) zio->file_inode;
+    key->mtime = (long long) zio->file_mtime;
+    key->chunk = (long long) chunk;
+    key->slice_size = (unsigned int) slice_size;
+
+    hash = key->device * 0x9e3779b97f4a7c15ULL;
+    hash = (hash ^ key->inode) * 0x9e3779b97f4a7c15ULL;
+    hash = (hash ^ (unsigned long long) key->mtime) * 0x9e3779b97f4a7c15ULL;
+    hash = (hash ^ (unsigned long long) key->chunk) * 0x9e3779b97f4a7c15ULL;
+    hash ^= hash >> 32;
+
+    return shared_cache->slots
+	+ (size_t) (hash % shared_cache->set_count) * ZIO_SHARED_WAY_COUNT;
+}
+
+
+/*
+ * Test whether `slot' has the key `key'.
+ * (The members of `slot' may be changed by another process during the
+ * test.  The caller must check the sequence number of `slot' after it.)
  */
 static int
-zio_open_epwing(Zio *zio, const char *file_name)
+zio_shared_cache_match(Zio_Shared_Slot *slot, const Zio_Shared_Slot *key)
 {
-    int leaf16_count;
-    int leaf_count;
-    char buffer[ZIO_EPWING_BUFFER_SIZE];
-    char *buffer_p;
-    ssize_t read_length;
-    Zio_Huffman_Node *tail_node_p;
+    return __atomic_load_n(&slot->chunk, __ATOMIC_RELAXED) == key->chunk
+	&& __atomic_load_n(&slot->inode, __ATOMIC_RELAXED) == key->inode
+	&& __atomic_load_n(&slot->device, __ATOMIC_RELAXED) == key->device
+	&& __atomic_load_n(&slot->mtime, __ATOMIC_RELAXED) == key->mtime
+	&& __atomic_load_n(&slot->slice_size, __ATOMIC_RELAXED)
+	== key->slice_size;
+}
+
+
+/*
+ * Test whether a slot in `state' has been claimed by a writer for
+ * ZIO_SHARED_CLAIM_TIMEOUT seconds or more at the time `now'.  The
+ * writer is regarded as dead or stuck.
+ */
+static int
+zio_shared_cache_is_abandoned(unsigned long long state, unsigned int now)
+{
+    if ((ZIO_SHARED_SEQUENCE(state) & 1) == 0)
+	return 0;
+    return ZIO_SHARED_CLAIM_TIMEOUT
+	<= (int) (now - ZIO_SHARED_CLAIM_TIME(state));
+}
+
+
+/*
+ * Copy the `chunk'th chunk of slices in `zio' from the shared slice
+ * cache into `buffer'.
+ *
+ * If the chunk is found, 0 is returned.  Otherwise, -1 is returned.
+ */
+static int
+zio_shared_cache_read_chunk(Zio *zio, off_t chunk, size_t slice_size,
+    char *buffer)
+{
+    Zio_Shared_Slot key;
+    Zio_Shared_Slot *slot;
+    const unsigned long long *data;
+    unsigned long long word;
+    unsigned long long state;
     int i;
+    int j;
 
-    LOG(("in: zio_open_epwing(zio=%d, file_name=%s)", (int)zio->id,
-	file_name));
+    slot = zio_shared_cache_set(zio, chunk, slice_size, &key);
+    for (i = 0; i < ZIO_SHARED_WAY_COUNT; i++, slot++) {
+	state = __atomic_load_n(&slot->state, __ATOMIC_ACQUIRE);
+	if (state == 0 || (ZIO_SHARED_SEQUENCE(state) & 1) != 0)
+	    continue;
+	if (!zio_shared_cache_match(slot, &key))
+	    continue;
+
+	data = (const unsigned long long *) (shared_cache->data
+	    + (size_t) (slot - shared_cache->slots) * ZIO_SHARED_SLOT_SIZE);
+	for (j = 0; j < (int) (ZIO_SHARED_SLOT_SIZE / sizeof(word)); j++) {
+	    word = __atomic_load_n(data + j, __ATOMIC_RELAXED);
+	    memcpy(buffer + j * sizeof(word), &word, sizeof(word));
+	}
 
-    zio->code = ZIO_EPWING;
-    zio->huffman_nodes = NULL;
+	/*
+	 * The slot has been rewritten during the copy, if its sequence
+	 * number has been changed.
+	 */
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	if (__atomic_load_n(&slot->state, __ATOMIC_RELAXED) != state)
+	    return -1;
+	return 0;
+    }
 
-    /*
-     * Open `HONMON2'.
-     */
-    if (zio_open_raw(zio, file_name) < 0)
-	goto failed;
+    return -1;
+}
+
+
+/*
+ * Store the `chunk'th chunk of slices in `zio', `buffer', into the
+ * shared slice cache.
+ *
+ * A slot is claimed by setting its sequence number odd with
+ * compare-and-swap, so that processes never wait for each other.  The
+ * chunk is not stored if it is stored already, or the slot to store
+ * it is claimed by another process.  A slot claimed for
+ * ZIO_SHARED_CLAIM_TIMEOUT seconds or more is claimed again, so that
+ * a slot left by a dead writer doesn't stay odd forever.
+ */
+static void
+zio_shared_cache_write_chunk(Zio *zio, off_t chunk, size_t slice_size,
+    const char *buffer)
+{
+    Zio_Shared_Slot key;
+    Zio_Shared_Slot *slot;
+    Zio_Shared_Slot *victim = NULL;
+    unsigned long long *data;
+    unsigned long long word;
+    unsigned long long state;
+    unsigned long long victim_state = 0;
+    unsigned long long claim_state;
+    unsigned int sequence;
+    unsigned int stamp;
+    unsigned int victim_stamp = 0;
+    unsigned int now;
+    int i;
+    int j;
 
     /*
-     * Read a header of `HONMON2' (32 bytes).
-     * When `frequencies_length' is shorter than 512, we assumes the
-     * file is broken.
+     * Choose a slot in the set.  An empty slot is preferred, an
+     * abandoned slot is next, and the least recently stored slot is
+     * chosen otherwise.  (An odd sequence number in `victim_state'
+     * means an abandoned slot.)
      */
-    if (zio_read_raw(zio, buffer, 32) != 32)
-	goto failed;
-    zio->location = 0;
-    zio->slice_size = ZIO_SIZE_PAGE;
-    zio->index_location = zio_uint4(buffer);
-    zio->index_length = zio_uint4(buffer + 4);
-    zio->frequencies_location = zio_uint4(buffer + 8);
-    zio->frequencies_length = zio_uint4(buffer + 12);
-    leaf16_count = (zio->frequencies_length - (256 * 2)) / 4;
-    leaf_count = leaf16_count + 256 + 1;
-    if (zio->index_length < 36 || zio->frequencies_length < 512)
-	goto failed;
+    now = (unsigned int) time(NULL);
+    slot = zio_shared_cache_set(zio, chunk, slice_size, &key);
+    for (i = 0; i < ZIO_SHARED_WAY_COUNT; i++, slot++) {
+	state = __atomic_load_n(&slot->state, __ATOMIC_ACQUIRE);
+	if ((ZIO_SHARED_SEQUENCE(state) & 1) != 0) {
+	    if (victim != NULL && (victim_state == 0
+		|| (ZIO_SHARED_SEQUENCE(victim_state) & 1) != 0))
+		continue;
+	    if (zio_shared_cache_is_abandoned(state, now)) {
+		victim = slot;
+		victim_state = state;
+	    }
+	    continue;
+	}
+	if (state == 0) {
+	    if (victim == NULL || victim_state != 0) {
+		victim = slot;
+		victim_state = 0;
+	    }
+	    continue;
+	}
+	if (zio_shared_cache_match(slot, &key))
+	    return;
+	if (victim != NULL && (victim_state == 0
+	    || (ZIO_SHARED_SEQUENCE(victim_state) & 1) != 0))
+	    continue;
+	stamp = __atomic_load_n(&slot->stamp, __ATOMIC_RELAXED);
+	if (victim == NULL || (int) (stamp - victim_stamp) < 0) {
+	    victim = slot;
+	    victim_state = state;
+	    victim_stamp = stamp;
+	}
+    }
+    if (victim == NULL)
+	return;
 
     /*
-     * Check for the length of an uncompressed file.
-     *
-     * If the index of the non-first page in the last index group
-     * is 0x0000, we assumes the data corresponding with the index
-     * doesn't exist.
+     * Claim the slot.  The sequence number of an abandoned slot is
+     * incremented by two to stay odd.  The claim time is stored in
+     * the same word, so that a writer which dies just after the claim
+     * still leaves a slot which can be reclaimed.
      */
-    if (zio_lseek_raw(zio, zio->index_location
-	    + ((off_t) zio->index_length - 36) / 36 * 36, SEEK_SET) < 0)
-	goto failed;
-    if (zio_read_raw(zio, buffer, 36) != 36)
-	goto failed;
-    zio->file_size = ((off_t) zio->index_length / 36) * (ZIO_SIZE_PAGE * 16);
-    for (i = 1, buffer_p = buffer + 4 + 2; i < 16; i++, buffer_p += 2) {
-	if (zio_uint2(buffer_p) == 0)
-	    break;
+    sequence = ZIO_SHARED_SEQUENCE(victim_state);
+    if ((sequence & 1) != 0)
+	sequence += 2;
+    else
+	sequence += 1;
+    claim_state = ((unsigned long long) now << 32) | sequence;
+    if (!__atomic_compare_exchange_n(&victim->state, &victim_state,
+	claim_state, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+	return;
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    __atomic_store_n(&victim->device, key.device, __ATOMIC_RELAXED);
+    __atomic_store_n(&victim->inode, key.inode, __ATOMIC_RELAXED);
+    __atomic_store_n(&victim->mtime, key.mtime, __ATOMIC_RELAXED);
+    __atomic_store_n(&victim->chunk, key.chunk, __ATOMIC_RELAXED);
+    __atomic_store_n(&victim->slice_size, key.slice_size, __ATOMIC_RELAXED);
+    __atomic_store_n(&victim->stamp,
+	__atomic_fetch_add(&shared_cache->header->clock, 1, __ATOMIC_RELAXED),
+	__ATOMIC_RELAXED);
+
+    data = (unsigned long long *) (shared_cache->data
+	+ (size_t) (victim - shared_cache->slots) * ZIO_SHARED_SLOT_SIZE);
+    for (j = 0; j < (int) (ZIO_SHARED_SLOT_SIZE / sizeof(word)); j++) {
+	memcpy(&word, buffer + j * sizeof(word), sizeof(word));
+	__atomic_store_n(data + j, word, __ATOMIC_RELAXED);
     }
-    zio->file_size -= ZIO_SIZE_PAGE * (16 - i);
 
     /*
-     * Allocate memory for huffman nodes.
+     * Release the slot.  (The sequence number 0 means an empty slot.)
      */
-    zio->huffman_nodes = (Zio_Huffman_Node *) malloc(sizeof(Zio_Huffman_Node)
-	* leaf_count * 2);
-    if (zio->huffman_nodes == NULL)
-	goto failed;
-    tail_node_p = zio->huffman_nodes;
+    sequence++;
+    if (sequence == 0)
+	sequence = 2;
+    state = claim_state;
+    if (__atomic_compare_exchange_n(&victim->state, &state,
+	(unsigned long long) sequence, 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+	return;
 
     /*
-     * Make leafs for 16bit character.
+     * This writer took so long that the slot has been reclaimed by
+     * another writer, and the data may be mixed.  Empty the slot if it
+     * has been released, or make the release of the current writer
+     * fail if it is still written.
      */
-    read_length = ZIO_EPWING_BUFFER_SIZE - (ZIO_EPWING_BUFFER_SIZE % 4);
-    if (zio_lseek_raw(zio, zio->frequencies_location, SEEK_SET) < 0)
-	goto failed;
-    if (zio_read_raw(zio, buffer, read_length) != read_length)
-	goto failed;
+    do {
+	if ((ZIO_SHARED_SEQUENCE(state) & 1) != 0) {
+	    claim_state = (state & ~0xffffffffULL)
+		| (unsigned int) (ZIO_SHARED_SEQUENCE(state) + 2);
+	} else
+	    claim_state = 0;
+    } while (!__atomic_compare_exchange_n(&victim->state, &state,
+	claim_state, 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+#endif /* ZIO_USE_SHARED_CACHE */
 
-    buffer_p = buffer;
-    for (i = 0; i < leaf16_count; i++) {
-	if (buffer + read_length <= buffer_p) {
-	    if (zio_read_raw(zio, buffer, read_length) != read_length)
-		goto failed;
-	    buffer_p = buffer;
-	}
-	tail_node_p->type = ZIO_HUFFMAN_NODE_LEAF16;
-	tail_node_p->value = zio_uint2(buffer_p);
-	tail_node_p->frequency = zio_uint2(buffer_p + 2);
-	tail_node_p->left = NULL;
-	tail_node_p->right = NULL;
-	buffer_p += 4;
-	tail_node_p++;
+
+/*
+ * Copy the slice `slice' of `zio', whose size is `size', from the
+ * shared slice cache into `buffer'.
+ *
+ * If the slice is found, 0 is returned.  Otherwise, -1 is returned.
+ */
+static int
+zio_shared_cache_copy(Zio *zio, off_t slice, char *buffer, size_t size)
+{
+#ifdef ZIO_USE_SHARED_CACHE
+    off_t chunk_count;
+    off_t i;
+
+    if (shared_cache == NULL || zio->file_inode == 0
+	|| size % ZIO_SHARED_SLOT_SIZE != 0)
+	return -1;
+
+    chunk_count = size / ZIO_SHARED_SLOT_SIZE;
+    for (i = 0; i < chunk_count; i++) {
+	if (zio_shared_cache_read_chunk(zio, slice * chunk_count + i, size,
+	    buffer + i * ZIO_SHARED_SLOT_SIZE) < 0)
+	    return -1;
     }
+    zio_count_shared_cache_hit(zio);
+    return 0;
+#else
+    return -1;
+#endif
+}
 
-    /*
-     * Make leafs for 8bit character.
-     */
-    if (zio_lseek_raw(zio, zio->frequencies_location + leaf16_count * 4,
-	SEEK_SET) < 0)
-	goto failed;
-    if (zio_read_raw(zio, buffer, 512) != 512)
-	goto failed;
 
-    buffer_p = buffer;
-    for (i = 0; i < 256; i++) {
-	tail_node_p->type = ZIO_HUFFMAN_NODE_LEAF8;
-	tail_node_p->value = i;
-	tail_node_p->frequency = zio_uint2(buffer_p);
-	tail_node_p->left = NULL;
-	tail_node_p->right = NULL;
-	buffer_p += 2;
-	tail_node_p++;
+/*
+ * Store the slice `slice' of `zio', `buffer' whose size is `size',
+ * into the shared slice cache.  (A slice larger than a slot is stored
+ * into several slots.)
+ */
+static void
+zio_shared_cache_store(Zio *zio, off_t slice, const char *buffer,
+    size_t size)
+{
+#ifdef ZIO_USE_SHARED_CACHE
+    off_t chunk_count;
+    off_t i;
+
+    if (shared_cache == NULL || zio->file_inode == 0
+	|| size % ZIO_SHARED_SLOT_SIZE != 0)
+	return;
+
+    chunk_count = size / ZIO_SHARED_SLOT_SIZE;
+    for (i = 0; i < chunk_count; i++) {
+	zio_shared_cache_write_chunk(zio, slice * chunk_count + i, size,
+	    buffer + i * ZIO_SHARED_SLOT_SIZE);
     }
+#endif
+}
 
-    /*
-     * Make a leaf for the end-of-page character.
-     */
-    tail_node_p->type = ZIO_HUFFMAN_NODE_EOF;
-    tail_node_p->value = 256;
-    tail_node_p->frequency = 1;
-    tail_node_p++;
 
-    /*
-     * Make a huffman tree.
-     */
-    if (zio_make_epwing_huffman_tree(zio, leaf_count) < 0)
-	goto failed;
+/*
+ * Set the directory of the disk cache.  Uncompressed slices of ebzip,
+ * ebzip2, EPWING and EPWING V6 files are written into a cache file in
+ * `directory', so that they are read without uncompression after the
+ * files are opened again, even by another process.  Cache files are
+ * created with mode 0600, and they are shared only among processes of
+ * the same user.  If `directory' is NULL, the disk cache is disabled.
+ * It affects files opened after the call.
+ *
+ * If it succeeds, 0 is returned.  Otherwise, -1 is returned.
+ */
+int
+zio_set_disk_cache_directory(const char *directory)
+{
+    char *copied_directory = NULL;
 
-    /*
-     * Assign ID.
-     */
     pthread_mutex_lock(&zio_mutex);
-    zio->id = zio_counter++;
-    pthread_mutex_unlock(&zio_mutex);
+    LOG(("in: zio_set_disk_cache_directory(directory=%s)",
+	(directory == NULL) ? "(null)" : directory));
 
-    LOG(("out: zio_open_epwing(zio=%d) = %d", (int)zio->id, zio->file));
-    return zio->file;
+#ifdef ZIO_USE_DISK_CACHE
+    if (directory != NULL) {
+	if (PATH_MAX < strlen(directory) + ZIO_DISK_CACHE_MAX_NAME_LENGTH)
+	    goto failed;
+	copied_directory = (char *) malloc(strlen(directory) + 1);
+	if (copied_directory == NULL)
+	    goto failed;
+	strcpy(copied_directory, directory);
+    }
+    if (disk_cache_directory != NULL)
+	free(disk_cache_directory);
+    disk_cache_directory = copied_directory;
+
+    LOG(("out: zio_set_disk_cache_directory() = %d", 0));
+    pthread_mutex_unlock(&zio_mutex);
+    return 0;
 
     /*
      * An error occurs...
      */
   failed:
-    if (0 <= zio->file)
-	zio_close_raw(zio);
-    if (zio->huffman_nodes != NULL)
-	free(zio->huffman_nodes);
-    zio->file = -1;
-    zio->huffman_nodes = NULL;
-    zio->huffman_root = NULL;
-    zio->code = ZIO_INVALID;
-
-    LOG(("out: zio_open_epwing() = %d", -1));
+#endif
+    LOG(("out: zio_set_disk_cache_directory() = %d", -1));
+    pthread_mutex_unlock(&zio_mutex);
     return -1;
 }
 
 
 /*
- * Open an EPWING compression file.
+ * Open the disk cache of `zio', if the directory of the disk cache is
+ * set.  (It is not an error that the cache cannot be opened.)
+ *
+ * The cache file is named after the identity of the uncompressed
+ * contents: the CRC and mtime in the header of an ebzip file, or the
+ * identity of an EPWING file.  The file has a header, a bitmap of
+ * valid slices, the checksums of the slices, and the slices.  It is a
+ * sparse file; a slice is written when it is uncompressed first.  The
+ * cache is cleared if its header doesn't match `zio'.
  */
-static int
-zio_open_epwing6(Zio *zio, const char *file_name)
+static void
+zio_open_disk_cache(Zio *zio)
 {
-    int leaf32_count;
-    int leaf16_count;
-    int leaf_count;
-    char buffer[ZIO_EPWING_BUFFER_SIZE];
-    char *buffer_p;
-    ssize_t read_length;
-    Zio_Huffman_Node *tail_node_p;
-    int i;
-
-    LOG(("in: zio_open_epwing6(zio=%d, file_name=%s)", (int)zio->id,
-	file_name));
+#ifdef ZIO_USE_DISK_CACHE
+    char path_name[PATH_MAX + 1];
+    Zio_Disk_Cache_Header header;
+    Zio_Disk_Cache_Header file_header;
+    Zio_Disk_Cache *cache = NULL;
+    struct flock lock;
+    struct stat st;
+    size_t slice_size;
+    size_t bitmap_length;
+    size_t checksums_length;
+    off_t slice_count;
+    off_t checksum_location;
+    off_t data_location;
+    int file = -1;
+    int is_locked = 0;
+
+    if (zio->disk_cache != NULL || zio->is_ebnet)
+	return;
 
-    zio->code = ZIO_EPWING6;
-    zio->huffman_nodes = NULL;
+    pthread_mutex_lock(&zio_mutex);
+    if (disk_cache_directory == NULL) {
+	pthread_mutex_unlock(&zio_mutex);
+	return;
+    }
+    strcpy(path_name, disk_cache_directory);
+    pthread_mutex_unlock(&zio_mutex);
 
     /*
-     * Open `HONMON2'.
+     * Make the header and the name of the cache file.
      */
-    if (zio_open_raw(zio, file_name) < 0)
-	goto failed;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, ZIO_DISK_CACHE_MAGIC, sizeof(header.magic));
+    header.file_size = (long long) zio->file_size;
+    switch (zio->code) {
+    case ZIO_EBZIP1:
+    case ZIO_EBZIP2:
+	slice_size = zio->slice_size;
+	header.crc = zio->crc;
+	header.mtime = (long long) zio->mtime;
+	sprintf(path_name + strlen(path_name), "/ebzip-%08x-%08lx-%llx-%d",
+	    header.crc, (unsigned long) header.mtime,
+	    (unsigned long long) header.file_size, zio->zip_level);
+	break;
+    case ZIO_EPWING:
+    case ZIO_EPWING6:
+	if (zio->file_inode == 0)
+	    return;
+	slice_size = ZIO_SIZE_PAGE;
+	header.device = (unsigned long long) zio->file_device;
+	header.inode = (unsigned long long) zio->file_inode;
+	header.mtime = (long long) zio->file_mtime;
+	sprintf(path_name + strlen(path_name), "/%s-%llx-%llx-%08lx",
+	    (zio->code == ZIO_EPWING) ? "epwing" : "epwing6",
+	    header.device, header.inode, (unsigned long) header.mtime);
+	break;
+    default:
+	return;
+    }
+    header.slice_size = (unsigned int) slice_size;
 
-    /*
-     * Read a header of `HONMON2' (48 bytes).
-     * When `frequencies_length' is shorter than 512, we assumes the
-     * file is broken.
-     */
-    if (zio_read_raw(zio, buffer, 48) != 48)
+    zio_lock_disk_cache_files();
+
+    slice_count = (zio->file_size + slice_size - 1) / slice_size;
+    bitmap_length = (slice_count + 7) / 8;
+    checksums_length = slice_count * sizeof(unsigned int);
+    if ((off_t) bitmap_length * 8 < slice_count
+	|| (off_t) (checksums_length / sizeof(unsigned int)) != slice_count)
 	goto failed;
-    zio->location = 0;
-    zio->slice_size = ZIO_SIZE_PAGE;
-    zio->index_location = zio_uint4(buffer);
-    zio->index_length = zio_uint4(buffer + 4);
-    zio->frequencies_location = zio_uint4(buffer + 8);
-    zio->frequencies_length = zio_uint4(buffer + 12);
-    leaf16_count = 0x400;
-    leaf32_count = (zio->frequencies_length - (leaf16_count * 4) - (256 * 2))
-	/ 6;
-    leaf_count = leaf32_count + leaf16_count + 256 + 1;
-    if (zio->index_length < 36 || zio->frequencies_length < 512)
+    checksum_location = (ZIO_DISK_CACHE_HEADER_SIZE + bitmap_length
+	+ sizeof(unsigned int) - 1)
+	/ sizeof(unsigned int) * sizeof(unsigned int);
+    data_location = (checksum_location + checksums_length
+	+ ZIO_DISK_CACHE_ALIGNMENT - 1)
+	/ ZIO_DISK_CACHE_ALIGNMENT * ZIO_DISK_CACHE_ALIGNMENT;
+
+    cache = (Zio_Disk_Cache *) malloc(sizeof(Zio_Disk_Cache));
+    if (cache == NULL)
+	goto failed;
+    cache->checksums = NULL;
+    cache->bitmap = (unsigned char *) malloc(bitmap_length + 1);
+    if (cache->bitmap == NULL)
+	goto failed;
+    cache->checksums = (unsigned int *) malloc(checksums_length + 1);
+    if (cache->checksums == NULL)
 	goto failed;
 
     /*
-     * Check for the length of an uncompressed file.
-     *
-     * If the index of the non-first page in the last index group
-     * is 0x0000, we assumes the data corresponding with the index
-     * doesn't exist.
+     * Open the cache file, and lock it while the header is checked.
+     * The file is private to the user, since another user could
+     * write any data into it.  A file owned by another user, or
+     * writable by others, is not used.
      */
-    if (zio_lseek_raw(zio, zio->index_location
-	+ ((off_t) zio->index_length - 36) / 36 * 36, SEEK_SET) < 0)
+    file = open(path_name, O_RDWR | O_CREAT | O_NOFOLLOW | O_BINARY, 0600);
+    if (file < 0)
 	goto failed;
-    if (zio_read_raw(zio, buffer, 36) != 36)
+    if (fstat(file, &st) < 0 || !S_ISREG(st.st_mode)
+	|| st.st_uid != geteuid() || (st.st_mode & (S_IWGRP | S_IWOTH)) != 0)
 	goto failed;
-    zio->file_size = ((off_t) zio->index_length / 36) * (ZIO_SIZE_PAGE * 16);
-    for (i = 1, buffer_p = buffer + 4 + 2; i < 16; i++, buffer_p += 2) {
-	if (zio_uint2(buffer_p) == 0)
-	    break;
-    }
-    zio->file_size -= ZIO_SIZE_PAGE * (16 - i);
+    lock.l_type = F_WRLCK;
+    lock.l_whence = SEEK_SET;
+    lock.l_start = 0;
+    lock.l_len = 0;
+    lock.l_pid = 0;
+    if (fcntl(file, ZIO_DISK_CACHE_SETLKW, &lock) < 0)
+	goto failed;
+    is_locked = 1;
 
     /*
-     * Allocate memory for huffman nodes.
+     * Clear the cache if its header doesn't match.
      */
-    zio->huffman_nodes = (Zio_Huffman_Node *) malloc(sizeof(Zio_Huffman_Node)
-	* leaf_count * 2);
-    if (zio->huffman_nodes == NULL)
+    if (pread(file, &file_header, sizeof(file_header), 0)
+	!= sizeof(file_header)
+	|| memcmp(&file_header, &header, sizeof(header)) != 0) {
+	if (ftruncate(file, 0) < 0
+	    || pwrite(file, &header, sizeof(header), 0) != sizeof(header)
+	    || ftruncate(file, data_location + slice_count * slice_size) < 0)
+	    goto failed;
+    }
+    if (pread(file, cache->bitmap, bitmap_length,
+	ZIO_DISK_CACHE_HEADER_SIZE) != bitmap_length
+	|| pread(file, cache->checksums, checksums_length, checksum_location)
+	!= checksums_length)
 	goto failed;
-    tail_node_p = zio->huffman_nodes;
+
+    lock.l_type = F_UNLCK;
+    fcntl(file, ZIO_DISK_CACHE_SETLK, &lock);
+    zio_unlock_disk_cache_files();
+
+    cache->file = file;
+    cache->slice_size = slice_size;
+    cache->slice_count = slice_count;
+    cache->checksum_location = checksum_location;
+    cache->data_location = data_location;
+    zio->disk_cache = cache;
+    return;
 
     /*
-     * Make leafs for 32bit character.
+     * An error occurs...
      */
-    read_length = ZIO_EPWING_BUFFER_SIZE - (ZIO_EPWING_BUFFER_SIZE % 6);
-    if (zio_lseek_raw(zio, zio->frequencies_location, SEEK_SET) < 0)
-	goto failed;
-    if (zio_read_raw(zio, buffer, read_length) != read_length)
-	goto failed;
-
-    buffer_p = buffer;
-    for (i = 0; i < leaf32_count; i++) {
-	if (buffer + read_length <= buffer_p) {
-	    if (zio_read_raw(zio, buffer, read_length) != read_length)
-		goto failed;
-	    buffer_p = buffer;
+  failed:
+    if (0 <= file) {
+	if (is_locked) {
+	    lock.l_type = F_UNLCK;
+	    fcntl(file, ZIO_DISK_CACHE_SETLK, &lock);
 	}
-	tail_node_p->type = ZIO_HUFFMAN_NODE_LEAF32;
-	tail_node_p->value = zio_uint4(buffer_p);
-	tail_node_p->frequency = zio_uint2(buffer_p + 4);
-	tail_node_p->left = NULL;
-	tail_node_p->right = NULL;
-	buffer_p += 6;
-	tail_node_p++;
+	close(file);
+    }
+    zio_unlock_disk_cache_files();
+    if (cache != NULL) {
+	if (cache->bitmap != NULL)
+	    free(cache->bitmap);
+	if (cache->checksums != NULL)
+	    free(cache->checksums);
+	free(cache);
     }
+#endif
+}
 
-    /*
-     * Make leafs for 16bit character.
-     */
-    read_length = ZIO_EPWING_BUFFER_SIZE - (ZIO_EPWING_BUFFER_SIZE % 4);
-    if (zio_lseek_raw(zio, zio->frequencies_location + leaf32_count * 6,
-	SEEK_SET) < 0)
-	goto failed;
-    if (zio_read_raw(zio, buffer, read_length) != read_length)
-	goto failed;
 
-    buffer_p = buffer;
-    for (i = 0; i < leaf16_count; i++) {
-	if (buffer + read_length <= buffer_p) {
-	    if (zio_read_raw(zio, buffer, read_length) != read_length)
-		goto failed;
-	    buffer_p = buffer;
-	}
-	tail_node_p->type = ZIO_HUFFMAN_NODE_LEAF16;
-	tail_node_p->value = zio_uint2(buffer_p);
-	tail_node_p->frequency = zio_uint2(buffer_p + 2);
-	tail_node_p->left = NULL;
-	tail_node_p->right = NULL;
-	buffer_p += 4;
-	tail_node_p++;
+/*
+ * Close the disk cache of `zio'.
+ */
+static void
+zio_close_disk_cache(Zio *zio)
+{
+#ifdef ZIO_USE_DISK_CACHE
+    Zio_Disk_Cache *cache = (Zio_Disk_Cache *) zio->disk_cache;
+
+    if (cache == NULL)
+	return;
+    zio_lock_disk_cache_files();
+    close(cache->file);
+    zio_unlock_disk_cache_files();
+    free(cache->bitmap);
+    free(cache->checksums);
+    free(cache);
+    zio->disk_cache = NULL;
+#endif
+}
+
+
+/*
+ * Read the slice `slice' of `zio', whose size is `size', from the disk
+ * cache into `buffer'.  A slice which doesn't match its checksum, torn
+ * by a crash for example, is dropped from the cache.
+ *
+ * If the slice is found, 0 is returned.  Otherwise, -1 is returned.
+ */
+static int
+zio_disk_cache_read(Zio *zio, off_t slice, char *buffer, size_t size)
+{
+#ifdef ZIO_USE_DISK_CACHE
+    Zio_Disk_Cache *cache = (Zio_Disk_Cache *) zio->disk_cache;
+    unsigned long long start_time;
+    unsigned int checksum;
+    int is_valid;
+
+    if (cache == NULL || size != cache->slice_size
+	|| slice < 0 || cache->slice_count <= slice)
+	return -1;
+
+    pthread_mutex_lock(&disk_cache_mutex);
+    is_valid = cache->bitmap[slice / 8] & (1 << (slice % 8));
+    checksum = cache->checksums[slice];
+    pthread_mutex_unlock(&disk_cache_mutex);
+    if (!is_valid)
+	return -1;
+
+    start_time = zio_clock();
+    if (pread(cache->file, buffer, size, cache->data_location + slice * size)
+	!= size)
+	return -1;
+    zio_count_raw_read(zio, size, 1, zio_elapsed(start_time));
+
+    if (crc32(0L, (Bytef *) buffer, (uInt) size) != checksum) {
+	zio_disk_cache_drop(cache, slice);
+	return -1;
     }
+    zio_count_disk_cache_hit(zio);
 
-    /*
-     * Make leafs for 8bit character.
-     */
-    if (zio_lseek_raw(zio, zio->frequencies_location + leaf32_count * 6
-	+ leaf16_count * 4, SEEK_SET) < 0)
-	goto failed;
-    if (zio_read_raw(zio, buffer, 512) != 512)
-	goto failed;
+    return 0;
+#else
+    return -1;
+#endif
+}
 
-    buffer_p = buffer;
-    for (i = 0; i < 256; i++) {
-	tail_node_p->type = ZIO_HUFFMAN_NODE_LEAF8;
-	tail_node_p->value = i;
-	tail_node_p->frequency = zio_uint2(buffer_p);
-	tail_node_p->left = NULL;
-	tail_node_p->right = NULL;
-	buffer_p += 2;
-	tail_node_p++;
+
+/*
+ * Write the slice `slice' of `zio', `buffer' whose size is `size',
+ * into the disk cache.  The slice and its checksum are written before
+ * its bit in the bitmap is set.  (It is not an error that the slice
+ * cannot be written.)
+ *
+ * The file is not synchronized.  After a crash, the bit may be set
+ * for a slice which has not reached the disk, but the slice doesn't
+ * match the checksum then, and zio_disk_cache_read() drops it.
+ */
+static void
+zio_disk_cache_write(Zio *zio, off_t slice, const char *buffer, size_t size)
+{
+#ifdef ZIO_USE_DISK_CACHE
+    Zio_Disk_Cache *cache = (Zio_Disk_Cache *) zio->disk_cache;
+    unsigned char *bitmap_p;
+    unsigned int checksum;
+    int is_valid;
+
+    if (cache == NULL || size != cache->slice_size
+	|| slice < 0 || cache->slice_count <= slice)
+	return;
+
+    pthread_mutex_lock(&disk_cache_mutex);
+    is_valid = cache->bitmap[slice / 8] & (1 << (slice % 8));
+    pthread_mutex_unlock(&disk_cache_mutex);
+    if (is_valid)
+	return;
+
+    checksum = crc32(0L, (const Bytef *) buffer, (uInt) size);
+    if (pwrite(cache->file, buffer, size, cache->data_location + slice * size)
+	!= size
+	|| pwrite(cache->file, &checksum, sizeof(checksum),
+	    cache->checksum_location + slice * sizeof(checksum))
+	!= sizeof(checksum))
+	return;
+
+    pthread_mutex_lock(&disk_cache_mutex);
+    cache->checksums[slice] = checksum;
+    bitmap_p = cache->bitmap + slice / 8;
+    *bitmap_p |= 1 << (slice % 8);
+    if (pwrite(cache->file, bitmap_p, 1,
+	ZIO_DISK_CACHE_HEADER_SIZE + slice / 8) != 1)
+	*bitmap_p &= ~(1 << (slice % 8));
+    pthread_mutex_unlock(&disk_cache_mutex);
+#endif
+}
+
+
+#ifdef ZIO_USE_DISK_CACHE
+/*
+ * Drop the slice `slice' from the disk cache `cache'.  Its bit in the
+ * bitmap is cleared, so that it is written again.
+ */
+static void
+zio_disk_cache_drop(Zio_Disk_Cache *cache, off_t slice)
+{
+    unsigned char *bitmap_p;
+
+    pthread_mutex_lock(&disk_cache_mutex);
+    bitmap_p = cache->bitmap + slice / 8;
+    *bitmap_p &= ~(1 << (slice % 8));
+    pwrite(cache->file, bitmap_p, 1, ZIO_DISK_CACHE_HEADER_SIZE + slice / 8);
+    pthread_mutex_unlock(&disk_cache_mutex);
+}
+#endif
+
+
+/*
+ * Copy the slice `slice' of the ebzip or ebzip2 file `zio' from the
+ * shared slice cache or the disk cache into the slice cache.
+ *
+ * If the slice is found, 0 is returned.  Otherwise, -1 is returned.
+ */
+static int
+zio_load_stored_slice(Zio *zio, off_t slice)
+{
+    Zio_Cache_Entry *entry;
+
+#ifdef ZIO_USE_SHARED_CACHE
+    if (shared_cache == NULL && zio->disk_cache == NULL)
+	return -1;
+#else
+    if (zio->disk_cache == NULL)
+	return -1;
+#endif
+
+    entry = zio_cache_new_entry(zio->id, slice, zio->slice_size);
+    if (entry == NULL)
+	return -1;
+    if (zio_copy_stored_slice(zio, slice, entry->buffer, zio->slice_size)
+	< 0) {
+	free(entry);
+	return -1;
     }
+    zio_cache_insert(entry);
+    return 0;
+}
 
-    /*
-     * Make a leaf for the end-of-page character.
-     */
-    tail_node_p->type = ZIO_HUFFMAN_NODE_EOF;
-    tail_node_p->value = 256;
-    tail_node_p->frequency = 1;
-    tail_node_p++;
 
-    /*
-     * Make a huffman tree.
-     */
-    if (zio_make_epwing_huffman_tree(zio, leaf_count) < 0)
-	goto failed;
+/*
+ * Copy the slice `slice' of `zio', whose size is `size', from the
+ * shared slice cache or the disk cache into `buffer'.  A slice found
+ * in the disk cache is also stored into the shared slice cache.
+ *
+ * If the slice is found, 0 is returned.  Otherwise, -1 is returned.
+ */
+static int
+zio_copy_stored_slice(Zio *zio, off_t slice, char *buffer, size_t size)
+{
+    if (zio_shared_cache_copy(zio, slice, buffer, size) == 0)
+	return 0;
+    if (zio_disk_cache_read(zio, slice, buffer, size) == 0) {
+	zio_shared_cache_store(zio, slice, buffer, size);
+	return 0;
+    }
+    return -1;
+}
 
-    /*
-     * Assign ID.
-     */
-    pthread_mutex_lock(&zio_mutex);
-    zio->id = zio_counter++;
-    pthread_mutex_unlock(&zio_mutex);
 
-    LOG(("out: zio_open_epwing6(zio=%d) = %d", (int)zio->id, zio->file));
-    return zio->file;
+/*
+ * Store the uncompressed slice `slice' of `zio', `buffer' whose size
+ * is `size', into the shared slice cache and the disk cache.
+ */
+static void
+zio_store_slice(Zio *zio, off_t slice, const char *buffer, size_t size)
+{
+    zio_shared_cache_store(zio, slice, buffer, size);
+    zio_disk_cache_write(zio, slice, buffer, size);
+}
 
-    /*
-     * An error occurs...
-     */
-  failed:
-    if (0 <= zio->file)
-	zio_close_raw(zio);
-    if (zio->huffman_nodes != NULL)
-	free(zio->huffman_nodes);
+
+/*
+ * Initialize `zio'.
+ */
+void
+zio_initialize(Zio *zio)
+{
+    LOG(("in: zio_initialize()"));
+
+    zio->id = -1;
     zio->file = -1;
     zio->huffman_nodes = NULL;
     zio->huffman_root = NULL;
+    zio->huffman_table = NULL;
+    zio->index_table = NULL;
+    zio->index_table_length = 0;
     zio->code = ZIO_INVALID;
+    zio->file_size = 0;
+    zio->is_ebnet = 0;
+    zio->file_device = 0;
+    zio->file_inode = 0;
+    zio->file_mtime = 0;
+    zio->read_ahead_count = 0;
+    zio->read_ahead_last = -1;
+    zio->read_ahead_location = 0;
+    zio->map = NULL;
+    zio->map_length = 0;
+    zio->dictionary = NULL;
+    zio->materialized = NULL;
+    zio->disk_cache = NULL;
+    memset(&zio->stats, 0, sizeof(Zio_Stats));
 
-    LOG(("out: zio_open_epwing6() = %d", -1));
-    return -1;
+    LOG(("out: zio_initialize()"));
 }
 
 
 /*
- * Make a huffman tree for decompressing EPWING compression data.
+ * Finalize `zio'.
  */
-static int
-zio_make_epwing_huffman_tree(Zio *zio, int leaf_count)
+void
+zio_finalize(Zio *zio)
 {
-    Zio_Huffman_Node *target_node;
-    Zio_Huffman_Node *most_node;
-    Zio_Huffman_Node *node_p;
-    Zio_Huffman_Node temporary_node;
-    Zio_Huffman_Node *least_node_p;
-    Zio_Huffman_Node *tail_node_p;
-    int i;
-    int j;
+    LOG(("in: zio_finalize(zio=%d)", (int)zio->id));
 
-    LOG(("in: zio_make_epwing_huffman_tree(zio=%d, leaf_count=%d)",
+    zio_discard_materialized(zio);
+    zio_close(zio);
+    if (0 <= zio->id)
+	zio_cache_purge(zio->id);
+    if (zio->huffman_nodes != NULL)
+	free(zio->huffman_nodes);
+    if (zio->huffman_table != NULL)
+	free(zio->huffman_table);
+#ifdef HAVE_ZSTD
+    if (zio->dictionary != NULL)
+	ZSTD_freeDDict((ZSTD_DDict *) zio->dictionary);
+#endif
+    zio_unload_index_table(zio);
+
+    zio->id = -1;
+    zio->huffman_nodes = NULL;
+    zio->huffman_root = NULL;
+    zio->huffman_table = NULL;
+    zio->dictionary = NULL;
+    zio->code = ZIO_INVALID;
+
+    LOG(("out: zio_finalize()"));
+}
+
+
+/*
+ * Set S-EBXA compression mode.
+ */
+int
+zio_set_sebxa_mode(Zio *zio, off_t index_location, off_t index_base,
+    off_t zio_start_location, off_t zio_end_location)
+{
+    LOG(("in: zio_set_sebxa_mode(zio=%d, index_location=%ld, index_base=%ld, \
+zio_start_location=%ld, zio_end_location=%ld)",
+	(int)zio->id, (long)index_location, (long)index_base,
+	(long)zio_start_location, (long)zio_end_location));
+
+    if (zio->code != ZIO_PLAIN)
+	goto failed;
+
+    zio->code = ZIO_SEBXA;
+    zio->index_location = index_location;
+    zio->index_base = index_base;
+    zio->zio_start_location = zio_start_location;
+    zio->zio_end_location = zio_end_location;
+    zio->file_size = zio_end_location;
+
+    LOG(("out: zio_set_sebxa_mode() = %d", 0));
+    return 0;
+
+    /*
+     * An error occurs...
+     */
+  failed:
+    LOG(("out: zio_set_sebxa_mode() = %d", -1));
+    return -1;
+}
+
+/*
+ * Open `file'.
+ */
+int
+zio_open(Zio *zio, const char *file_name, Zio_Code zio_code)
+{
+    int result;
+
+    LOG(("in: zio_open(zio=%d, file_name=%s, zio_code=%d)",
+	(int)zio->id, file_name, zio_code));
+
+    /*
+     * The contents in memory are kept only for ZIO_REOPEN.  Otherwise,
+     * they may belong to another file, and the worker thread still
+     * uses the index and Huffman tables which are replaced below.
+     */
+    if (zio_code != ZIO_REOPEN)
+	zio_discard_materialized(zio);
+
+    if (0 <= zio->file) {
+	if (zio_code == ZIO_REOPEN) {
+	    result = 0;
+	    goto succeeded;
+	}
+	zio_finalize(zio);
+	zio_initialize(zio);
+    }
+
+    switch (zio_code) {
+    case ZIO_REOPEN:
+	result = zio_reopen(zio, file_name);
+	break;
+    case ZIO_PLAIN:
+	result = zio_open_plain(zio, file_name);
+	break;
+    case ZIO_EBZIP1:
+    case ZIO_EBZIP2:
+	result = zio_open_ebzip(zio, file_name);
+	break;
+    case ZIO_EPWING:
+	result = zio_open_epwing(zio, file_name);
+	break;
+    case ZIO_EPWING6:
+	result = zio_open_epwing6(zio, file_name);
+	break;
+    case ZIO_SEBXA:
+	result = zio_open_plain(zio, file_name);
+	break;
+    default:
+	result = -1;
+    }
+    if (0 <= result)
+	zio_open_disk_cache(zio);
+
+  succeeded:
+    LOG(("out: zio_open() = %d", result));
+    return result;
+}
+
+
+/*
+ * Reopen a file.
+ */
+static int
+zio_reopen(Zio *zio, const char *file_name)
+{
+    dev_t file_device;
+    ino_t file_inode;
+    time_t file_mtime;
+
+    LOG(("in: zio_reopen(zio=%d, file_name=%s)", (int)zio->id, file_name));
+
+    if (zio->code == ZIO_INVALID)
+	goto failed;
+
+    file_device = zio->file_device;
+    file_inode = zio->file_inode;
+    file_mtime = zio->file_mtime;
+    if (zio_open_raw(zio, file_name) < 0) {
+	zio->code = ZIO_INVALID;
+	goto failed;
+    }
+    zio->location = 0;
+
+    /*
+     * Discard the contents in memory if the file has been replaced.
+     */
+    if (zio->file_device != file_device || zio->file_inode != file_inode
+	|| zio->file_mtime != file_mtime)
+	zio_discard_materialized(zio);
+
+    LOG(("out: zio_reopen() = %d", zio->file));
+    return zio->file;
+
+    /*
+     * An error occurs...
+     */
+  failed:
+    LOG(("out: zio_reopen() = %d", -1));
+    return -1;
+}
+
+
+/*
+ * Open an non-compressed file.
+ */
+static int
+zio_open_plain(Zio *zio, const char *file_name)
+{
+    LOG(("in: zio_open_plain(zio=%d, file_name=%s)", (int)zio->id, file_name));
+
+    if (zio_open_raw(zio, file_name) < 0)
+	goto failed;
+
+    zio->code = ZIO_PLAIN;
+    zio->slice_size = ZIO_SIZE_PAGE;
+    zio->file_size = zio_lseek_raw(zio, 0, SEEK_END);
+    if (zio->file_size < 0 || zio_lseek_raw(zio, 0, SEEK_SET) < 0)
+	goto failed;
+    zio->location = 0;
+
+    /*
+     * Assign ID.
+     */
+    pthread_mutex_lock(&zio_mutex);
+    zio->id = zio_counter++;
+    pthread_mutex_unlock(&zio_mutex);
+
+    LOG(("out: zio_open_plain(zio=%d) = %d", (int)zio->id, zio->file));
+    return zio->file;
+
+    /*
+     * An error occurs...
+     */
+  failed:
+    if (0 <= zio->file)
+	zio_close_raw(zio);
+    zio->file = -1;
+    zio_close_disk_cache(zio);
+    zio->code = ZIO_INVALID;
+
+    LOG(("out: zio_open_plain() = %d", -1));
+    return -1;
+}
+
+
+/*
+ * Open an EBZIP compression file.
+ */
+static int
+zio_open_ebzip(Zio *zio, const char *file_name)
+{
+    char header[ZIO_SIZE_EBZIP_HEADER];
+    int ebzip_mode;
+    off_t index_length;
+
+    LOG(("in: zio_open_ebzip(zio=%d, file_name=%s)", (int)zio->id, file_name));
+
+    /*
+     * Try to open a `*.ebz' file.
+     */
+    if (zio_open_raw(zio, file_name) < 0)
+	goto failed;
+
+    /*
+     * Read header part of the ebzip'ped file.
+     */
+    if (zio_read_raw(zio, header, ZIO_SIZE_EBZIP_HEADER)
+	!= ZIO_SIZE_EBZIP_HEADER)
+	goto failed;
+    ebzip_mode = zio_uint1(header + 5) >> 4;
+    if (ebzip_mode == 3 || ebzip_mode == 4)
+	zio->code = ZIO_EBZIP2;
+    else
+	zio->code = ZIO_EBZIP1;
+    zio->zip_level = zio_uint1(header + 5) & 0x0f;
+    zio->slice_size = ZIO_SIZE_PAGE << zio->zip_level;
+    zio->file_size = zio_uint5(header +  9);
+    zio->crc = zio_uint4(header + 14);
+    zio->mtime = zio_uint4(header + 18);
+    zio->location = 0;
+
+    if (zio->file_size      < (off_t) 1 << 16)
+	zio->index_width = 2;
+    else if (zio->file_size < (off_t) 1 << 24)
+	zio->index_width = 3;
+    else if (zio->file_size < (off_t) 1 << 32 || !off_t_is_large)
+	zio->index_width = 4;
+    else
+	zio->index_width = 5;
+
+    /*
+     * Check zio header information.
+     */
+    if (memcmp(header, "EBZip", 5) != 0
+	|| ZIO_SIZE_PAGE << ZIO_MAX_EBZIP_LEVEL < zio->slice_size)
+	goto failed;
+
+    /*
+     * Mode 1 and 3 are for a file smaller than 4GB, mode 2 and 4 are
+     * for a larger file.  Mode 3 and 4 are the ebzip2 format.
+     */
+    if (off_t_is_large) {
+	if (ebzip_mode < 1 || 4 < ebzip_mode)
+	    goto failed;
+    } else {
+	if (ebzip_mode != 1 && ebzip_mode != 3)
+	    goto failed;
+    }
+#ifndef HAVE_ZSTD
+    if (zio->code == ZIO_EBZIP2)
+	goto failed;
+#endif
+
+    /*
+     * Load the index table into memory, if possible.  The table has
+     * an entry for each slice, and an extra entry which points to the
+     * end of the last slice.  (It is not an error that the table is
+     * not loaded.)
+     */
+    index_length = ((zio->file_size + zio->slice_size - 1) / zio->slice_size
+	+ 1) * zio->index_width;
+    zio_load_index_table(zio, ZIO_SIZE_EBZIP_HEADER, index_length);
+
+#ifdef HAVE_ZSTD
+    /*
+     * An ebzip2 file has a dictionary between the index table and the
+     * first slice.  Its length is recorded in the header.
+     */
+    if (zio->code == ZIO_EBZIP2
+	&& zio_load_ebzip2_dictionary(zio,
+	    ZIO_SIZE_EBZIP_HEADER + index_length, zio_uint3(header + 6)) < 0)
+	goto failed;
+#endif
+
+    /*
+     * Assign ID.
+     */
+    pthread_mutex_lock(&zio_mutex);
+    zio->id = zio_counter++;
+    pthread_mutex_unlock(&zio_mutex);
+
+    LOG(("out: zio_open_ebzip(zio=%d) = %d", (int)zio->id, zio->file));
+    return zio->file;
+
+    /*
+     * An error occurs...
+     */
+  failed:
+    if (0 <= zio->file)
+	zio_close_raw(zio);
+    zio_unload_index_table(zio);
+    zio->file = -1;
+    zio->code = ZIO_INVALID;
+    LOG(("out: zio_open_ebzip() = %d", -1));
+    return -1;
+}
+
+
+#ifdef HAVE_ZSTD
+/*
+ * Load a dictionary of `length' bytes at `location' in the ebzip2 file
+ * `zio', to uncompress slices.  If `length' is 0, the file has no
+ * dictionary.
+ *
+ * If it succeeds, 0 is returned.  Otherwise, -1 is returned.
+ */
+static int
+zio_load_ebzip2_dictionary(Zio *zio, off_t location, size_t length)
+{
+    char *buffer = NULL;
+
+    LOG(("in: zio_load_ebzip2_dictionary(zio=%d, location=%ld, length=%ld)",
+	(int)zio->id, (long)location, (long)length));
+
+    if (length == 0)
+	goto succeeded;
+    if (ZIO_MAX_EBZIP2_DICTIONARY_LENGTH < length)
+	goto failed;
+
+    buffer = (char *) malloc(length);
+    if (buffer == NULL)
+	goto failed;
+    if (zio_pread_raw(zio, location, buffer, length) != length)
+	goto failed;
+    zio->dictionary = ZSTD_createDDict(buffer, length);
+    if (zio->dictionary == NULL)
+	goto failed;
+    free(buffer);
+
+  succeeded:
+    LOG(("out: zio_load_ebzip2_dictionary() = %d", 0));
+    return 0;
+
+    /*
+     * An error occurs...
+     */
+  failed:
+    if (buffer != NULL)
+	free(buffer);
+    LOG(("out: zio_load_ebzip2_dictionary() = %d", -1));
+    return -1;
+}
+#endif
+
+
+/*
+ * The buffer size must be 512 bytes, the number of 8 bit nodes.
+ */
+#define ZIO_EPWING_BUFFER_SIZE 512
+
+/*
+ * Open an EPWING compression file.
+ */
+static int
+zio_open_epwing(Zio *zio, const char *file_name)
+{
+    int leaf16_count;
+    int leaf_count;
+    char buffer[ZIO_EPWING_BUFFER_SIZE];
+    char *buffer_p;
+    ssize_t read_length;
+    Zio_Huffman_Node *tail_node_p;
+    int i;
+
+    LOG(("in: zio_open_epwing(zio=%d, file_name=%s)", (int)zio->id,
+	file_name));
+
+    zio->code = ZIO_EPWING;
+    zio->huffman_nodes = NULL;
+    zio->huffman_table = NULL;
+
+    /*
+     * Open `HONMON2'.
+     */
+    if (zio_open_raw(zio, file_name) < 0)
+	goto failed;
+
+    /*
+     * Read a header of `HONMON2' (32 bytes).
+     * When `frequencies_length' is shorter than 512, we assumes the
+     * file is broken.
+     */
+    if (zio_read_raw(zio, buffer, 32) != 32)
+	goto failed;
+    zio->location = 0;
+    zio->slice_size = ZIO_SIZE_PAGE;
+    zio->index_location = zio_uint4(buffer);
+    zio->index_length = zio_uint4(buffer + 4);
+    zio->frequencies_location = zio_uint4(buffer + 8);
+    zio->frequencies_length = zio_uint4(buffer + 12);
+    leaf16_count = (zio->frequencies_length - (256 * 2)) / 4;
+    leaf_count = leaf16_count + 256 + 1;
+    if (zio->index_length < 36 || zio->frequencies_length < 512)
+	goto failed;
+
+    /*
+     * Check for the length of an uncompressed file.
+     *
+     * If the index of the non-first page in the last index group
+     * is 0x0000, we assumes the data corresponding with the index
+     * doesn't exist.
+     */
+    if (zio_lseek_raw(zio, zio->index_location
+	    + ((off_t) zio->index_length - 36) / 36 * 36, SEEK_SET) < 0)
+	goto failed;
+    if (zio_read_raw(zio, buffer, 36) != 36)
+	goto failed;
+    zio->file_size = ((off_t) zio->index_length / 36) * (ZIO_SIZE_PAGE * 16);
+    for (i = 1, buffer_p = buffer + 4 + 2; i < 16; i++, buffer_p += 2) {
+	if (zio_uint2(buffer_p) == 0)
+	    break;
+    }
+    zio->file_size -= ZIO_SIZE_PAGE * (16 - i);
+
+    /*
+     * Allocate memory for huffman nodes.
+     */
+    zio->huffman_nodes = (Zio_Huffman_Node *) malloc(sizeof(Zio_Huffman_Node)
+	* leaf_count * 2);
+    if (zio->huffman_nodes == NULL)
+	goto failed;
+    tail_node_p = zio->huffman_nodes;
+
+    /*
+     * Make leafs for 16bit character.
+     */
+    read_length = ZIO_EPWING_BUFFER_SIZE - (ZIO_EPWING_BUFFER_SIZE % 4);
+    if (zio_lseek_raw(zio, zio->frequencies_location, SEEK_SET) < 0)
+	goto failed;
+    if (zio_read_raw(zio, buffer, read_length) != read_length)
+	goto failed;
+
+    buffer_p = buffer;
+    for (i = 0; i < leaf16_count; i++) {
+	if (buffer + read_length <= buffer_p) {
+	    if (zio_read_raw(zio, buffer, read_length) != read_length)
+		goto failed;
+	    buffer_p = buffer;
+	}
+	tail_node_p->type = ZIO_HUFFMAN_NODE_LEAF16;
+	tail_node_p->value = zio_uint2(buffer_p);
+	tail_node_p->frequency = zio_uint2(buffer_p + 2);
+	tail_node_p->left = NULL;
+	tail_node_p->right = NULL;
+	buffer_p += 4;
+	tail_node_p++;
+    }
+
+    /*
+     * Make leafs for 8bit character.
+     */
+    if (zio_lseek_raw(zio, zio->frequencies_location + leaf16_count * 4,
+	SEEK_SET) < 0)
+	goto failed;
+    if (zio_read_raw(zio, buffer, 512) != 512)
+	goto failed;
+
+    buffer_p = buffer;
+    for (i = 0; i < 256; i++) {
+	tail_node_p->type = ZIO_HUFFMAN_NODE_LEAF8;
+	tail_node_p->value = i;
+	tail_node_p->frequency = zio_uint2(buffer_p);
+	tail_node_p->left = NULL;
+	tail_node_p->right = NULL;
+	buffer_p += 2;
+	tail_node_p++;
+    }
+
+    /*
+     * Make a leaf for the end-of-page character.
+     */
+    tail_node_p->type = ZIO_HUFFMAN_NODE_EOF;
+    tail_node_p->value = 256;
+    tail_node_p->frequency = 1;
+    tail_node_p++;
+
+    /*
+     * Make a huffman tree.
+     */
+    if (zio_make_epwing_huffman_tree(zio, leaf_count) < 0)
+	goto failed;
+
+    /*
+     * Load the index table into memory, if possible.
+     * (It is not an error that the table is not loaded.)
+     */
+    zio_load_index_table(zio, zio->index_location,
+	(off_t) zio->index_length / 36 * 36);
+
+    /*
+     * Assign ID.
+     */
+    pthread_mutex_lock(&zio_mutex);
+    zio->id = zio_counter++;
+    pthread_mutex_unlock(&zio_mutex);
+
+    LOG(("out: zio_open_epwing(zio=%d) = %d", (int)zio->id, zio->file));
+    return zio->file;
+
+    /*
+     * An error occurs...
+     */
+  failed:
+    if (0 <= zio->file)
+	zio_close_raw(zio);
+    if (zio->huffman_nodes != NULL)
+	free(zio->huffman_nodes);
+    if (zio->huffman_table != NULL)
+	free(zio->huffman_table);
+    zio->file = -1;
+    zio->huffman_nodes = NULL;
+    zio->huffman_root = NULL;
+    zio->huffman_table = NULL;
+    zio->code = ZIO_INVALID;
+
+    LOG(("out: zio_open_epwing() = %d", -1));
+    return -1;
+}
+
+
+/*
+ * Open an EPWING compression file.
+ */
+static int
+zio_open_epwing6(Zio *zio, const char *file_name)
+{
+    int leaf32_count;
+    int leaf16_count;
+    int leaf_count;
+    char buffer[ZIO_EPWING_BUFFER_SIZE];
+    char *buffer_p;
+    ssize_t read_length;
+    Zio_Huffman_Node *tail_node_p;
+    int i;
+
+    LOG(("in: zio_open_epwing6(zio=%d, file_name=%s)", (int)zio->id,
+	file_name));
+
+    zio->code = ZIO_EPWING6;
+    zio->huffman_nodes = NULL;
+    zio->huffman_table = NULL;
+
+    /*
+     * Open `HONMON2'.
+     */
+    if (zio_open_raw(zio, file_name) < 0)
+	goto failed;
+
+    /*
+     * Read a header of `HONMON2' (48 bytes).
+     * When `frequencies_length' is shorter than 512, we assumes the
+     * file is broken.
+     */
+    if (zio_read_raw(zio, buffer, 48) != 48)
+	goto failed;
+    zio->location = 0;
+    zio->slice_size = ZIO_SIZE_PAGE;
+    zio->index_location = zio_uint4(buffer);
+    zio->index_length = zio_uint4(buffer + 4);
+    zio->frequencies_location = zio_uint4(buffer + 8);
+    zio->frequencies_length = zio_uint4(buffer + 12);
+    leaf16_count = 0x400;
+    leaf32_count = (zio->frequencies_length - (leaf16_count * 4) - (256 * 2))
+	/ 6;
+    leaf_count = leaf32_count + leaf16_count + 256 + 1;
+    if (zio->index_length < 36 || zio->frequencies_length < 512)
+	goto failed;
+
+    /*
+     * Check for the length of an uncompressed file.
+     *
+     * If the index of the non-first page in the last index group
+     * is 0x0000, we assumes the data corresponding with the index
+     * doesn't exist.
+     */
+    if (zio_lseek_raw(zio, zio->index_location
+	+ ((off_t) zio->index_length - 36) / 36 * 36, SEEK_SET) < 0)
+	goto failed;
+    if (zio_read_raw(zio, buffer, 36) != 36)
+	goto failed;
+    zio->file_size = ((off_t) zio->index_length / 36) * (ZIO_SIZE_PAGE * 16);
+    for (i = 1, buffer_p = buffer + 4 + 2; i < 16; i++, buffer_p += 2) {
+	if (zio_uint2(buffer_p) == 0)
+	    break;
+    }
+    zio->file_size -= ZIO_SIZE_PAGE * (16 - i);
+
+    /*
+     * Allocate memory for huffman nodes.
+     */
+    zio->huffman_nodes = (Zio_Huffman_Node *) malloc(sizeof(Zio_Huffman_Node)
+	* leaf_count * 2);
+    if (zio->huffman_nodes == NULL)
+	goto failed;
+    tail_node_p = zio->huffman_nodes;
+
+    /*
+     * Make leafs for 32bit character.
+     */
+    read_length = ZIO_EPWING_BUFFER_SIZE - (ZIO_EPWING_BUFFER_SIZE % 6);
+    if (zio_lseek_raw(zio, zio->frequencies_location, SEEK_SET) < 0)
+	goto failed;
+    if (zio_read_raw(zio, buffer, read_length) != read_length)
+	goto failed;
+
+    buffer_p = buffer;
+    for (i = 0; i < leaf32_count; i++) {
+	if (buffer + read_length <= buffer_p) {
+	    if (zio_read_raw(zio, buffer, read_length) != read_length)
+		goto failed;
+	    buffer_p = buffer;
+	}
+	tail_node_p->type = ZIO_HUFFMAN_NODE_LEAF32;
+	tail_node_p->value = zio_uint4(buffer_p);
+	tail_node_p->frequency = zio_uint2(buffer_p + 4);
+	tail_node_p->left = NULL;
+	tail_node_p->right = NULL;
+	buffer_p += 6;
+	tail_node_p++;
+    }
+
+    /*
+     * Make leafs for 16bit character.
+     */
+    read_length = ZIO_EPWING_BUFFER_SIZE - (ZIO_EPWING_BUFFER_SIZE % 4);
+    if (zio_lseek_raw(zio, zio->frequencies_location + leaf32_count * 6,
+	SEEK_SET) < 0)
+	goto failed;
+    if (zio_read_raw(zio, buffer, read_length) != read_length)
+	goto failed;
+
+    buffer_p = buffer;
+    for (i = 0; i < leaf16_count; i++) {
+	if (buffer + read_length <= buffer_p) {
+	    if (zio_read_raw(zio, buffer, read_length) != read_length)
+		goto failed;
+	    buffer_p = buffer;
+	}
+	tail_node_p->type = ZIO_HUFFMAN_NODE_LEAF16;
+	tail_node_p->value = zio_uint2(buffer_p);
+	tail_node_p->frequency = zio_uint2(buffer_p + 2);
+	tail_node_p->left = NULL;
+	tail_node_p->right = NULL;
+	buffer_p += 4;
+	tail_node_p++;
+    }
+
+    /*
+     * Make leafs for 8bit character.
+     */
+    if (zio_lseek_raw(zio, zio->frequencies_location + leaf32_count * 6
+	+ leaf16_count * 4, SEEK_SET) < 0)
+	goto failed;
+    if (zio_read_raw(zio, buffer, 512) != 512)
+	goto failed;
+
+    buffer_p = buffer;
+    for (i = 0; i < 256; i++) {
+	tail_node_p->type = ZIO_HUFFMAN_NODE_LEAF8;
+	tail_node_p->value = i;
+	tail_node_p->frequency = zio_uint2(buffer_p);
+	tail_node_p->left = NULL;
+	tail_node_p->right = NULL;
+	buffer_p += 2;
+	tail_node_p++;
+    }
+
+    /*
+     * Make a leaf for the end-of-page character.
+     */
+    tail_node_p->type = ZIO_HUFFMAN_NODE_EOF;
+    tail_node_p->value = 256;
+    tail_node_p->frequency = 1;
+    tail_node_p++;
+
+    /*
+     * Make a huffman tree.
+     */
+    if (zio_make_epwing_huffman_tree(zio, leaf_count) < 0)
+	goto failed;
+
+    /*
+     * Load the index table into memory, if possible.
+     * (It is not an error that the table is not loaded.)
+     */
+    zio_load_index_table(zio, zio->index_location,
+	(off_t) zio->index_length / 36 * 36);
+
+    /*
+     * Assign ID.
+     */
+    pthread_mutex_lock(&zio_mutex);
+    zio->id = zio_counter++;
+    pthread_mutex_unlock(&zio_mutex);
+
+    LOG(("out: zio_open_epwing6(zio=%d) = %d", (int)zio->id, zio->file));
+    return zio->file;
+
+    /*
+     * An error occurs...
+     */
+  failed:
+    if (0 <= zio->file)
+	zio_close_raw(zio);
+    if (zio->huffman_nodes != NULL)
+	free(zio->huffman_nodes);
+    if (zio->huffman_table != NULL)
+	free(zio->huffman_table);
+    zio->file = -1;
+    zio->huffman_nodes = NULL;
+    zio->huffman_root = NULL;
+    zio->huffman_table = NULL;
+    zio->code = ZIO_INVALID;
+
+    LOG(("out: zio_open_epwing6() = %d", -1));
+    return -1;
+}
+
+
+/*
+ * Load an index table of `length' bytes at `location' in `zio->file'
+ * into memory.  It fails if the table doesn't fit in the rest of the
+ * index cache.
+ */
+static int
+zio_load_index_table(Zio *zio, off_t location, off_t length)
+{
+    LOG(("in: zio_load_index_table(zio=%d, location=%ld, length=%ld)",
+	(int)zio->id, (long)location, (long)length));
+
+    /*
+     * Discard a table left by an earlier open of `zio', in case that
+     * it is re-opened without zio_finalize().
+     */
+    if (zio->index_table != NULL)
+	zio_unload_index_table(zio);
+
+    if (length <= 0)
+	goto failed;
+
+    /*
+     * Reserve a part of the index cache.
+     */
+    pthread_mutex_lock(&zio_mutex);
+    if (index_cache_max_size < index_cache_used_size
+	|| (off_t)(index_cache_max_size - index_cache_used_size) < length) {
+	pthread_mutex_unlock(&zio_mutex);
+	goto failed;
+    }
+    index_cache_used_size += length;
+    zio->index_table_length = length;
+    pthread_mutex_unlock(&zio_mutex);
+
+    /*
+     * Read the table.
+     */
+    zio->index_table = (char *)malloc(length);
+    if (zio->index_table == NULL)
+	goto failed;
+    if (zio_pread_raw(zio, location, zio->index_table, length) != length)
+	goto failed;
+
+    LOG(("out: zio_load_index_table() = %d", 0));
+    return 0;
+
+    /*
+     * An error occurs...
+     */
+  failed:
+    zio_unload_index_table(zio);
+    LOG(("out: zio_load_index_table() = %d", -1));
+    return -1;
+}
+
+
+/*
+ * Discard an index table loaded by zio_load_index_table().
+ */
+static void
+zio_unload_index_table(Zio *zio)
+{
+    LOG(("in: zio_unload_index_table(zio=%d)", (int)zio->id));
+
+    if (zio->index_table != NULL)
+	free(zio->index_table);
+    pthread_mutex_lock(&zio_mutex);
+    index_cache_used_size -= zio->index_table_length;
+    pthread_mutex_unlock(&zio_mutex);
+
+    zio->index_table = NULL;
+    zio->index_table_length = 0;
+
+    LOG(("out: zio_unload_index_table()"));
+}
+
+
+/*
+ * Make a huffman tree for decompressing EPWING compression data.
+ *
+ * The shape of the tree must be the same as the one made by the
+ * encoder.  Leaf nodes are sorted in descending order of frequency
+ * by selection sort, and then the two least frequent nodes are merged
+ * repeatedly.  If two or more nodes have the least frequency, the
+ * last one in `zio->huffman_nodes' is chosen.
+ */
+static int
+zio_make_epwing_huffman_tree(Zio *zio, int leaf_count)
+{
+    Zio_Huffman_Node **heap = NULL;
+    int heap_count;
+    Zio_Huffman_Node *node_p;
+    Zio_Huffman_Node *least_node_p;
+    Zio_Huffman_Node *tail_node_p;
+    int i;
+    int j;
+
+    LOG(("in: zio_make_epwing_huffman_tree(zio=%d, leaf_count=%d)",
 	(int)zio->id, leaf_count));
 
-    tail_node_p = zio->huffman_nodes + leaf_count;
+    /*
+     * Sort the leaf nodes in frequency order.
+     */
+    if (zio_sort_epwing_huffman_leaves(zio->huffman_nodes, leaf_count) < 0)
+	goto failed;
+
+    /*
+     * Put the leaf nodes into a heap, ordered by frequency and
+     * location.  A node whose frequency is 0 is never used.
+     */
+    heap = (Zio_Huffman_Node **) malloc(sizeof(Zio_Huffman_Node *)
+	* leaf_count);
+    if (heap == NULL)
+	goto failed;
+    heap_count = 0;
+    for (i = 0, node_p = zio->huffman_nodes; i < leaf_count; i++, node_p++) {
+	if (node_p->frequency != 0)
+	    zio_push_huffman_heap(heap, &heap_count, node_p);
+    }
+
+    /*
+     * Make intermediate nodes of the huffman tree.
+     * The number of intermediate nodes of the tree is <the number of
+     * leaf nodes> - 1.
+     */
+    tail_node_p = zio->huffman_nodes + leaf_count;
+    for (i = 1; i < leaf_count; i++) {
+	/*
+	 * Initialize a new intermediate node.
+	 */
+	tail_node_p->type = ZIO_HUFFMAN_NODE_INTERMEDIATE;
+	tail_node_p->left = NULL;
+	tail_node_p->right = NULL;
+
+	/*
+	 * Take a least frequent node.
+	 * That node becomes a left child of the new intermediate node.
+	 */
+	least_node_p = zio_pop_huffman_heap(heap, &heap_count);
+	if (least_node_p == NULL)
+	    goto failed;
+	tail_node_p->left = least_node_p;
+	tail_node_p->frequency = least_node_p->frequency;
+	least_node_p->frequency = 0;
+
+	/*
+	 * Take a next least frequent node.
+	 * That node becomes a right child of the new intermediate node.
+	 */
+	least_node_p = zio_pop_huffman_heap(heap, &heap_count);
+	if (least_node_p == NULL)
+	    goto failed;
+	tail_node_p->right = least_node_p;
+	tail_node_p->frequency += least_node_p->frequency;
+	least_node_p->frequency = 0;
+
+	zio_push_huffman_heap(heap, &heap_count, tail_node_p);
+	tail_node_p++;
+    }
+    free(heap);
+    heap = NULL;
+
+    /*
+     * Set a root node of the huffman tree.
+     */
+    zio->huffman_root = tail_node_p - 1;
+
+    /*
+     * Make a lookup table of the huffman tree.  The entry at `i'
+     * holds the node reached by the leading ZIO_HUFFMAN_TABLE_BITS
+     * bits of `i'.
+     */
+    zio->huffman_table = (Zio_Huffman_Entry *)
+	malloc(sizeof(Zio_Huffman_Entry) << ZIO_HUFFMAN_TABLE_BITS);
+    if (zio->huffman_table == NULL)
+	goto failed;
+
+    for (i = 0; i < 1 << ZIO_HUFFMAN_TABLE_BITS; i++) {
+	node_p = zio->huffman_root;
+	for (j = 0; j < ZIO_HUFFMAN_TABLE_BITS; j++) {
+	    if (node_p == NULL
+		|| node_p->type != ZIO_HUFFMAN_NODE_INTERMEDIATE)
+		break;
+	    if ((i >> (ZIO_HUFFMAN_TABLE_BITS - 1 - j)) & 0x01)
+		node_p = node_p->left;
+	    else
+		node_p = node_p->right;
+	}
+	zio->huffman_table[i].node = node_p;
+	zio->huffman_table[i].length = j;
+    }
+
+    LOG(("out: zio_make_epwing_huffman_tree() = %d", 0));
+    return 0;
+
+    /*
+     * An error occurs...
+     */
+  failed:
+    if (heap != NULL)
+	free(heap);
+    LOG(("out: zio_make_epwing_huffman_tree() = %d", -1));
+    return -1;
+}
+
+
+/*
+ * Sort the leaf nodes of a huffman tree in descending order of
+ * frequency.
+ *
+ * The result is the same as the selection sort which moves the first
+ * most frequent node in `leaves[i..]' to `leaves[i]' by swapping the
+ * two nodes, for each `i'.  To find that node quickly, the frequencies
+ * of unsorted nodes are put on a tournament tree; `winners[k]' is
+ * the index of the first most frequent node under `k'.
+ */
+static int
+zio_sort_epwing_huffman_leaves(Zio_Huffman_Node *leaves, int leaf_count)
+{
+    Zio_Huffman_Node temporary_node;
+    int *frequencies = NULL;
+    int *winners = NULL;
+    int size;
+    int most;
+    int i;
+    int k;
+
+    LOG(("in: zio_sort_epwing_huffman_leaves(leaf_count=%d)", leaf_count));
+
+    size = 1;
+    while (size < leaf_count)
+	size <<= 1;
+
+    frequencies = (int *) malloc(sizeof(int) * size);
+    winners = (int *) malloc(sizeof(int) * size * 2);
+    if (frequencies == NULL || winners == NULL)
+	goto failed;
+
+    /*
+     * Sorted nodes and padding have frequency -1, so that they never
+     * win.
+     */
+    for (i = 0; i < size; i++) {
+	if (i < leaf_count)
+	    frequencies[i] = leaves[i].frequency;
+	else
+	    frequencies[i] = -1;
+	winners[size + i] = i;
+    }
+    for (k = size - 1; 0 < k; k--)
+	winners[k] = zio_huffman_winner(frequencies, winners, k);
+
+    for (i = 0; i < leaf_count - 1; i++) {
+	most = winners[1];
+
+	temporary_node.type = leaves[most].type;
+	temporary_node.value = leaves[most].value;
+	temporary_node.frequency = leaves[most].frequency;
+
+	leaves[most].type = leaves[i].type;
+	leaves[most].value = leaves[i].value;
+	leaves[most].frequency = leaves[i].frequency;
+
+	leaves[i].type = temporary_node.type;
+	leaves[i].value = temporary_node.value;
+	leaves[i].frequency = temporary_node.frequency;
+
+	/*
+	 * Update the tournament tree.
+	 */
+	frequencies[most] = leaves[most].frequency;
+	frequencies[i] = -1;
+	for (k = (size + most) / 2; 0 < k; k /= 2)
+	    winners[k] = zio_huffman_winner(frequencies, winners, k);
+	for (k = (size + i) / 2; 0 < k; k /= 2)
+	    winners[k] = zio_huffman_winner(frequencies, winners, k);
+    }
+
+    free(frequencies);
+    free(winners);
+    LOG(("out: zio_sort_epwing_huffman_leaves() = %d", 0));
+    return 0;
+
+    /*
+     * An error occurs...
+     */
+  failed:
+    if (frequencies != NULL)
+	free(frequencies);
+    if (winners != NULL)
+	free(winners);
+    LOG(("out: zio_sort_epwing_huffman_leaves() = %d", -1));
+    return -1;
+}
+
+
+/*
+ * Return the winner of the node `k' of a tournament tree: the more
+ * frequent one of the winners of its children.  The left one wins
+ * a tie.
+ */
+static int
+zio_huffman_winner(const int *frequencies, const int *winners, int k)
+{
+    int left = winners[k * 2];
+    int right = winners[k * 2 + 1];
+
+    if (frequencies[left] < frequencies[right])
+	return right;
+    return left;
+}
+
+
+/*
+ * Compare two nodes in a heap of huffman nodes.  It returns true if
+ * `node1' is taken before `node2'; that is, `node1' is less frequent,
+ * or they have the same frequency and `node1' is located after `node2'.
+ */
+#define zio_huffman_node_precedes(node1, node2) \
+	((node1)->frequency < (node2)->frequency \
+	 || ((node1)->frequency == (node2)->frequency && (node2) < (node1)))
+
+/*
+ * Add `node' to a heap of huffman nodes.
+ */
+static void
+zio_push_huffman_heap(Zio_Huffman_Node **heap, int *heap_count,
+    Zio_Huffman_Node *node)
+{
+    int i;
+
+    i = (*heap_count)++;
+    while (0 < i && zio_huffman_node_precedes(node, heap[(i - 1) / 2])) {
+	heap[i] = heap[(i - 1) / 2];
+	i = (i - 1) / 2;
+    }
+    heap[i] = node;
+}
+
+
+/*
+ * Remove the first node from a heap of huffman nodes, and return it.
+ * It returns NULL if the heap is empty.
+ */
+static Zio_Huffman_Node *
+zio_pop_huffman_heap(Zio_Huffman_Node **heap, int *heap_count)
+{
+    Zio_Huffman_Node *first_node;
+    Zio_Huffman_Node *last_node;
+    int child;
+    int i;
+
+    if (*heap_count == 0)
+	return NULL;
+
+    first_node = heap[0];
+    last_node = heap[--(*heap_count)];
+    i = 0;
+    for (;;) {
+	child = i * 2 + 1;
+	if (*heap_count <= child)
+	    break;
+	if (child + 1 < *heap_count
+	    && zio_huffman_node_precedes(heap[child + 1], heap[child]))
+	    child++;
+	if (!zio_huffman_node_precedes(heap[child], last_node))
+	    break;
+	heap[i] = heap[child];
+	i = child;
+    }
+    heap[i] = last_node;
+
+    return first_node;
+}
+
+
+/*
+ * Close `zio'.
+ */
+void
+zio_close(Zio *zio)
+{
+    zio_cancel_read_ahead(zio);
+
+    pthread_mutex_lock(&zio_mutex);
+    LOG(("in: zio_close(zio=%d)", (int)zio->id));
+
+    /*
+     * If contents of the file is cached, clear the cache.
+     */
+    if (0 <= zio->file)
+	zio_close_raw(zio);
+    zio->file = -1;
+    zio_close_disk_cache(zio);
+
+    LOG(("out: zio_close()"));
+    pthread_mutex_unlock(&zio_mutex);
+}
+
+
+/*
+ * Return file descriptor of `zio'.
+ */
+int
+zio_file(Zio *zio)
+{
+    LOG(("in+out: zio_file(zio=%d) = %d", (int)zio->id, zio->file));
+
+    return zio->file;
+}
+
+
+/*
+ * Return compression mode of `zio'.
+ */
+Zio_Code
+zio_mode(Zio *zio)
+{
+    LOG(("in+out: zio_mode(zio=%d) = %d", (int)zio->id, zio->code));
+
+    return zio->code;
+}
+
+
+/*
+ * Seek `zio'.
+ *
+ * It only updates `zio->location'.  The offset of the file descriptor
+ * is not changed, since read operations use the positional read.
+ */
+off_t
+zio_lseek(Zio *zio, off_t location, int whence)
+{
+    off_t result;
+
+    LOG(("in: zio_lseek(zio=%d, location=%ld, whence=%d)",
+	(int)zio->id, (long)location, whence));
+
+    if (zio->file < 0)
+	goto failed;
+
+    if (zio->code == ZIO_PLAIN) {
+	/*
+	 * If `zio' is not compressed, behave like lseek().
+	 */
+	switch (whence) {
+	case SEEK_SET:
+	    result = location;
+	    break;
+	case SEEK_CUR:
+	    result = zio->location + location;
+	    break;
+	case SEEK_END:
+	    result = zio->file_size + location;
+	    break;
+	default:
+#ifdef EINVAL
+	    errno = EINVAL;
+#endif
+	    goto failed;
+	}
+
+	if (result < 0) {
+#ifdef EINVAL
+	    errno = EINVAL;
+#endif
+	    goto failed;
+	}
+	zio->location = result;
+    } else {
+	/*
+	 * Calculate new location according with `whence'.
+	 */
+	switch (whence) {
+	case SEEK_SET:
+	    zio->location = location;
+	    break;
+	case SEEK_CUR:
+	    zio->location = zio->location + location;
+	    break;
+	case SEEK_END:
+	    zio->location = zio->file_size - location;
+	    break;
+	default:
+#ifdef EINVAL
+	    errno = EINVAL;
+#endif
+	    goto failed;
+	}
+
+	/*
+	 * Adjust location.
+	 */
+	if (zio->location < 0)
+	    zio->location = 0;
+	if (zio->file_size < zio->location)
+	    zio->location = zio->file_size;
+
+	result = zio->location;
+    }
+
+    LOG(("out: zio_lseek() = %ld", (long)result));
+    return result;
+
+    /*
+     * An error occurs...
+     */
+  failed:
+    LOG(("out: zio_lseek() = %ld", (long)-1));
+    return -1;
+}
+
+
+/*
+ * Read data from `zio' file, and advance `zio->location'.
+ */
+ssize_t
+zio_read(Zio *zio, char *buffer, size_t length)
+{
+    ssize_t read_length;
+
+    LOG(("in: zio_read(zio=%d, length=%ld)", (int)zio->id, (long)length));
+
+    read_length = zio_pread(zio, zio->location, buffer, length);
+    if (0 < read_length)
+	zio->location += read_length;
+
+    LOG(("out: zio_read() = %ld", (long)read_length));
+    return read_length;
+}
+
+
+/*
+ * Read data at `location' from `zio' file.
+ *
+ * Unlike zio_read(), it doesn't use nor update `zio->location', and it
+ * doesn't lock `zio' at all.  Threads can read the same `zio' at the
+ * same time, as long as nobody opens or closes it.
+ */
+ssize_t
+zio_pread(Zio *zio, off_t location, char *buffer, size_t length)
+{
+    ssize_t read_length;
+
+    LOG(("in: zio_pread(zio=%d, location=%ld, length=%ld)", (int)zio->id,
+	(long)location, (long)length));
+
+    if (zio->file < 0 || location < 0)
+	goto failed;
+
+    /*
+     * Copy data from memory, if the whole file has been materialized.
+     */
+    if (zio->materialized != NULL) {
+	read_length = zio_pread_materialized(zio, location, buffer, length);
+	if (0 <= read_length)
+	    goto succeeded;
+    }
+
+    switch (zio->code) {
+    case ZIO_PLAIN:
+	read_length = zio_pread_raw(zio, location, buffer, length);
+	break;
+    case ZIO_EBZIP1:
+    case ZIO_EBZIP2:
+	read_length = zio_pread_ebzip(zio, location, buffer, length);
+	break;
+    case ZIO_EPWING:
+    case ZIO_EPWING6:
+	read_length = zio_pread_epwing(zio, location, buffer, length);
+	break;
+    case ZIO_SEBXA:
+	read_length = zio_pread_sebxa(zio, location, buffer, length);
+	break;
+    default:
+	goto failed;
+    }
+
+    if (0 < zio->read_ahead_count && 0 < read_length)
+	zio_request_read_ahead(zio, location, read_length);
+
+  succeeded:
+    LOG(("out: zio_pread() = %ld", (long)read_length));
+    return read_length;
+
+    /*
+     * An error occurs...
+     */
+  failed:
+    LOG(("out: zio_pread() = %ld", (long)-1));
+    return -1;
+}
+
+
+/*
+ * Get a read-only view of `length' bytes at `location' in `zio'.
+ * It is available only when `zio' is a plain file mapped into memory.
+ * Otherwise it returns NULL, and the caller should use zio_pread()
+ * instead.  The view is valid until `zio' is closed.
+ */
+const char *
+zio_map_range(Zio *zio, off_t location, size_t length)
+{
+    const char *view;
+
+    LOG(("in: zio_map_range(zio=%d, location=%ld, length=%ld)",
+	(int)zio->id, (long)location, (long)length));
+
+    if (zio->file < 0 || zio->code != ZIO_PLAIN || zio->map == NULL
+	|| location < 0 || (off_t) zio->map_length < location
+	|| zio->map_length - location < length)
+	goto failed;
+    view = zio->map + location;
+
+    LOG(("out: zio_map_range() = %p", view));
+    return view;
+
+    /*
+     * An error occurs...
+     */
+  failed:
+    LOG(("out: zio_map_range() = NULL"));
+    return NULL;
+}
+
+
+/*
+ * Uncompress the whole contents of `zio' into memory by a worker
+ * thread.  After that, zio_pread() and zio_read() copy data from
+ * memory.  The contents are kept while `zio' is closed and reopened
+ * with ZIO_REOPEN, unless the file has been replaced.  They are
+ * discarded when `zio' is opened with another code or finalized, or
+ * to keep the budget set by zio_set_materialize_budget().  (The least
+ * recently used contents are discarded first.)  If the contents of
+ * `zio' are in memory already, they become the most recently used.
+ *
+ * It is not supported for ebnet files, and unless the library is
+ * built with pthread.  Like zio_open(), the first call for `zio' must
+ * not be made while other threads read `zio'.
+ *
+ * If it succeeds, 0 is returned.  Otherwise, -1 is returned.
+ */
+int
+zio_materialize(Zio *zio)
+{
+#ifdef ENABLE_PTHREAD
+    Zio_Materialized *materialized = NULL;
+    Zio *source;
+    pthread_t thread;
+    size_t budget;
+    int is_new = 0;
+#endif
+
+    LOG(("in: zio_materialize(zio=%d)", (int)zio->id));
+
+#ifdef ENABLE_PTHREAD
+    if (zio->file < 0 || zio->is_ebnet || zio->code == ZIO_INVALID
+	|| zio->file_size <= 0)
+	goto failed;
+
+    /*
+     * If the contents are in memory (or being uncompressed), make them
+     * the most recently used.  If they have been discarded, wait for
+     * the worker thread and readers, and uncompress them again.
+     */
+    if (zio->materialized != NULL) {
+	materialized = (Zio_Materialized *) zio->materialized;
+	pthread_mutex_lock(&materialize_mutex);
+	if (!materialized->is_discarded) {
+	    zio_unlink_materialized(materialized);
+	    zio_link_materialized(materialized);
+	    pthread_mutex_unlock(&materialize_mutex);
+	    goto succeeded;
+	}
+	while (materialized->is_running || 0 < materialized->user_count)
+	    pthread_cond_wait(&materialize_done_cond, &materialize_mutex);
+	pthread_mutex_unlock(&materialize_mutex);
+    } else {
+	materialized = (Zio_Materialized *) malloc(sizeof(Zio_Materialized));
+	if (materialized == NULL)
+	    goto failed;
+	is_new = 1;
+	materialized->buffer = NULL;
+	materialized->is_complete = 0;
+	materialized->is_running = 0;
+	materialized->is_discarded = 1;
+	materialized->user_count = 0;
+	materialized->lru_prev = NULL;
+	materialized->lru_next = NULL;
+	zio_initialize(&materialized->source);
+    }
+
+    pthread_mutex_lock(&materialize_mutex);
+    budget = materialize_budget;
+    pthread_mutex_unlock(&materialize_mutex);
+    if ((off_t) budget < zio->file_size)
+	goto failed;
+
+    /*
+     * Make a copy of `zio' for the worker thread.  It has its own file
+     * descriptor, and doesn't use the slice cache nor the memory
+     * mapping of `zio'.
+     */
+    source = &materialized->source;
+    zio_initialize(source);
+    source->code = zio->code;
+    source->file_size = zio->file_size;
+    source->slice_size = zio->slice_size;
+    source->zip_level = zio->zip_level;
+    source->index_width = zio->index_width;
+    source->crc = zio->crc;
+    source->mtime = zio->mtime;
+    source->dictionary = zio->dictionary;
+    source->index_location = zio->index_location;
+    source->index_length = zio->index_length;
+    source->index_table = zio->index_table;
+    source->index_table_length = zio->index_table_length;
+    source->frequencies_location = zio->frequencies_location;
+    source->frequencies_length = zio->frequencies_length;
+    source->huffman_nodes = zio->huffman_nodes;
+    source->huffman_root = zio->huffman_root;
+    source->huffman_table = zio->huffman_table;
+    source->zio_start_location = zio->zio_start_location;
+    source->zio_end_location = zio->zio_end_location;
+    source->index_base = zio->index_base;
+    source->file_device = zio->file_device;
+    source->file_inode = zio->file_inode;
+    source->file_mtime = zio->file_mtime;
+    source->file = dup(zio->file);
+    if (source->file < 0)
+	goto failed;
+
+    /*
+     * Allocate memory.  Anonymous mapping is preferred, since the
+     * kernel may back it with huge pages.
+     */
+    materialized->length = zio->file_size;
+    materialized->is_mapped = 0;
+#if defined(HAVE_MMAP) && defined(MAP_ANONYMOUS)
+    materialized->buffer = (char *) mmap(NULL, materialized->length,
+	PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (materialized->buffer == MAP_FAILED) {
+	materialized->buffer = NULL;
+    } else {
+	materialized->is_mapped = 1;
+#ifdef MADV_HUGEPAGE
+	madvise(materialized->buffer, materialized->length, MADV_HUGEPAGE);
+#endif
+    }
+#endif
+    if (materialized->buffer == NULL) {
+	materialized->buffer = (char *) malloc(materialized->length);
+	if (materialized->buffer == NULL)
+	    goto failed;
+    }
+
+    /*
+     * Discard the least recently used contents to keep the budget,
+     * and start the worker thread.
+     */
+    pthread_mutex_lock(&materialize_mutex);
+    while (materialize_lru_tail != NULL
+	&& materialize_budget < materialize_used_size + materialized->length)
+	zio_discard_materialized_buffer(materialize_lru_tail);
+    zio_link_materialized(materialized);
+    materialize_used_size += materialized->length;
+    materialized->is_complete = 0;
+    materialized->is_discarded = 0;
+    materialized->is_running = 1;
+    pthread_mutex_unlock(&materialize_mutex);
+
+    if (pthread_create(&thread, NULL, zio_materialize_worker, materialized)
+	!= 0) {
+	pthread_mutex_lock(&materialize_mutex);
+	materialized->is_running = 0;
+	zio_discard_materialized_buffer(materialized);
+	pthread_mutex_unlock(&materialize_mutex);
+	goto failed;
+    }
+    pthread_detach(thread);
+    if (is_new)
+	zio->materialized = materialized;
+
+  succeeded:
+    LOG(("out: zio_materialize() = %d", 0));
+    return 0;
+
+    /*
+     * An error occurs...
+     */
+  failed:
+    if (materialized != NULL) {
+	if (0 <= materialized->source.file) {
+	    close(materialized->source.file);
+	    materialized->source.file = -1;
+	}
+	zio_free_materialized_buffer(materialized);
+	if (is_new)
+	    free(materialized);
+    }
+#endif
+    LOG(("out: zio_materialize() = %d", -1));
+    return -1;
+}
+
+
+/*
+ * Discard the contents of `zio' uncompressed by zio_materialize().
+ * It waits until the worker thread and readers finish.  Like
+ * zio_close(), it must not be called while other threads read `zio'.
+ */
+void
+zio_discard_materialized(Zio *zio)
+{
+    Zio_Materialized *materialized;
+
+    if (zio->materialized == NULL)
+	return;
+
+    LOG(("in: zio_discard_materialized(zio=%d)", (int)zio->id));
+
+    materialized = (Zio_Materialized *) zio->materialized;
+    pthread_mutex_lock(&materialize_mutex);
+    if (!materialized->is_discarded)
+	zio_discard_materialized_buffer(materialized);
+#ifdef ENABLE_PTHREAD
+    while (materialized->is_running || 0 < materialized->user_count)
+	pthread_cond_wait(&materialize_done_cond, &materialize_mutex);
+#endif
+    pthread_mutex_unlock(&materialize_mutex);
+
+    free(materialized);
+    zio->materialized = NULL;
+
+    LOG(("out: zio_discard_materialized()"));
+}
+
+
+/*
+ * Set the maximum total size of files materialized in memory by
+ * zio_materialize().  The least recently used contents are discarded
+ * to keep it.
+ */
+void
+zio_set_materialize_budget(size_t budget)
+{
+    pthread_mutex_lock(&materialize_mutex);
+    LOG(("in: zio_set_materialize_budget(budget=%ld)", (long)budget));
+
+    materialize_budget = budget;
+    while (materialize_lru_tail != NULL && budget < materialize_used_size)
+	zio_discard_materialized_buffer(materialize_lru_tail);
+
+    LOG(("out: zio_set_materialize_budget()"));
+    pthread_mutex_unlock(&materialize_mutex);
+}
+
+
+/*
+ * Read data from the contents of `zio' in memory.
+ * If the contents are not available, -1 is returned.
+ */
+static ssize_t
+zio_pread_materialized(Zio *zio, off_t location, char *buffer, size_t length)
+{
+    Zio_Materialized *materialized;
+    ssize_t read_length;
+
+    materialized = (Zio_Materialized *) zio->materialized;
+
+    pthread_mutex_lock(&materialize_mutex);
+    if (!materialized->is_complete || materialized->is_discarded) {
+	pthread_mutex_unlock(&materialize_mutex);
+	return -1;
+    }
+    materialized->user_count++;
+    if (materialize_lru_head != materialized) {
+	zio_unlink_materialized(materialized);
+	zio_link_materialized(materialized);
+    }
+    pthread_mutex_unlock(&materialize_mutex);
+
+    if ((off_t) materialized->length <= location)
+	read_length = 0;
+    else if (materialized->length - location < length)
+	read_length = materialized->length - location;
+    else
+	read_length = length;
+    memcpy(buffer, materialized->buffer + location, read_length);
+
+    pthread_mutex_lock(&materialize_mutex);
+    materialized->user_count--;
+    if (materialized->is_discarded && materialized->user_count == 0) {
+	if (!materialized->is_running)
+	    zio_free_materialized_buffer(materialized);
+#ifdef ENABLE_PTHREAD
+	pthread_cond_broadcast(&materialize_done_cond);
+#endif
+    }
+    pthread_mutex_unlock(&materialize_mutex);
+
+    return read_length;
+}
+
+
+/*
+ * Unlink `materialized' from the LRU list.
+ * The caller must lock `materialize_mutex'.
+ */
+static void
+zio_unlink_materialized(Zio_Materialized *materialized)
+{
+    if (materialized->lru_prev != NULL)
+	materialized->lru_prev->lru_next = materialized->lru_next;
+    else
+	materialize_lru_head = materialized->lru_next;
+    if (materialized->lru_next != NULL)
+	materialized->lru_next->lru_prev = materialized->lru_prev;
+    else
+	materialize_lru_tail = materialized->lru_prev;
+    materialized->lru_prev = NULL;
+    materialized->lru_next = NULL;
+}
+
+
+/*
+ * Link `materialized' to the head of the LRU list.
+ * The caller must lock `materialize_mutex'.
+ */
+static void
+zio_link_materialized(Zio_Materialized *materialized)
+{
+    materialized->lru_prev = NULL;
+    materialized->lru_next = materialize_lru_head;
+    if (materialize_lru_head != NULL)
+	materialize_lru_head->lru_prev = materialized;
+    else
+	materialize_lru_tail = materialized;
+    materialize_lru_head = materialized;
+}
+
+
+/*
+ * Mark the contents in `materialized' discarded, and remove them from
+ * the LRU list.  The memory is freed now if nobody uses it, or when
+ * the worker thread or the last reader finishes.
+ * The caller must lock `materialize_mutex'.
+ */
+static void
+zio_discard_materialized_buffer(Zio_Materialized *materialized)
+{
+    zio_unlink_materialized(materialized);
+    materialize_used_size -= materialized->length;
+    materialized->is_discarded = 1;
+    if (!materialized->is_running && materialized->user_count == 0)
+	zio_free_materialized_buffer(materialized);
+}
+
+
+/*
+ * Free the memory for the contents in `materialized'.
+ */
+static void
+zio_free_materialized_buffer(Zio_Materialized *materialized)
+{
+    if (materialized->buffer == NULL)
+	return;
+#ifdef HAVE_MMAP
+    if (materialized->is_mapped)
+	munmap(materialized->buffer, materialized->length);
+    else
+	free(materialized->buffer);
+#else
+    free(materialized->buffer);
+#endif
+    materialized->buffer = NULL;
+}
+
+
+#ifdef ENABLE_PTHREAD
+/*
+ * The worker thread which uncompresses the whole contents of a file
+ * into memory.  It stops when the contents are discarded.
+ */
+static void *
+zio_materialize_worker(void *arg)
+{
+    Zio_Materialized *materialized = (Zio_Materialized *) arg;
+    Zio *source = &materialized->source;
+    ssize_t read_length;
+    size_t length;
+    off_t location = 0;
+    int is_discarded;
+
+    while (location < (off_t) materialized->length) {
+	pthread_mutex_lock(&materialize_mutex);
+	is_discarded = materialized->is_discarded;
+	pthread_mutex_unlock(&materialize_mutex);
+	if (is_discarded)
+	    break;
+
+	length = ZIO_MATERIALIZE_CHUNK_SIZE;
+	if (materialized->length - location < length)
+	    length = materialized->length - location;
+
+	switch (source->code) {
+	case ZIO_PLAIN:
+	    read_length = zio_pread_raw(source, location,
+		materialized->buffer + location, length);
+	    break;
+	case ZIO_EBZIP1:
+	case ZIO_EBZIP2:
+	    read_length = zio_pread_ebzip(source, location,
+		materialized->buffer + location, length);
+	    break;
+	case ZIO_EPWING:
+	case ZIO_EPWING6:
+	    read_length = zio_pread_epwing(source, location,
+		materialized->buffer + location, length);
+	    break;
+	case ZIO_SEBXA:
+	    read_length = zio_pread_sebxa(source, location,
+		materialized->buffer + location, length);
+	    break;
+	default:
+	    read_length = -1;
+	    break;
+	}
+	if (read_length != length)
+	    break;
+	location += length;
+    }
+
+    zio_close_raw(source);
+    source->file = -1;
+
+    pthread_mutex_lock(&materialize_mutex);
+    if (location == (off_t) materialized->length)
+	materialized->is_complete = 1;
+    else if (!materialized->is_discarded)
+	zio_discard_materialized_buffer(materialized);
+    materialized->is_running = 0;
+    if (materialized->is_discarded && materialized->user_count == 0)
+	zio_free_materialized_buffer(materialized);
+    pthread_cond_broadcast(&materialize_done_cond);
+    pthread_mutex_unlock(&materialize_mutex);
+
+    return NULL;
+}
+#endif
+
+
+/*
+ * Set whether time spent in reading and uncompressing is measured for
+ * I/O statistics.  It is not measured by default, since it needs
+ * clock_gettime() twice for each read and each uncompressed slice.
+ */
+void
+zio_set_stats_timing(int flag)
+{
+    pthread_mutex_lock(&zio_mutex);
+    LOG(("in: zio_set_stats_timing(flag=%d)", flag));
+
+    stats_timing = flag;
+
+    LOG(("out: zio_set_stats_timing()"));
+    pthread_mutex_unlock(&zio_mutex);
+}
+
+
+/*
+ * Get I/O statistics of `zio'.  If `zio' is NULL, statistics of all
+ * Zio objects since the library was initialized are returned.
+ */
+void
+zio_get_stats(Zio *zio, Zio_Stats *stats)
+{
+    unsigned long hit_count;
+    unsigned long miss_count;
+    int i;
+
+    LOG(("in: zio_get_stats(zio=%d)", (zio == NULL) ? -1 : (int)zio->id));
+
+    memset(stats, 0, sizeof(Zio_Stats));
+    zio_lock_stats();
+    if (zio != NULL)
+	zio_add_stats(stats, &zio->stats);
+    else {
+	for (i = 0; i < ZIO_CACHE_SHARD_COUNT; i++)
+	    zio_add_stats(stats, &global_stats[i].stats);
+    }
+    zio_unlock_stats();
+
+    if (zio == NULL) {
+	zio_cache_statistics(&hit_count, &miss_count);
+	stats->cache_hit_count = hit_count;
+	stats->cache_miss_count = miss_count;
+    }
+
+    LOG(("out: zio_get_stats()"));
+}
+
+
+/*
+ * Enable or disable read-ahead of `zio'.
+ *
+ * If enabled, a worker thread uncompresses at most `slice_count'
+ * slices following the last read into the slice cache, when `zio' is
+ * read sequentially; that is, when a read starts at the end of the
+ * previous read.  If `slice_count' is 0, read-ahead is disabled.
+ * It is not supported for plain files, and unless the library is
+ * built with pthread.
+ */
+int
+zio_set_read_ahead(Zio *zio, int slice_count)
+{
+    LOG(("in: zio_set_read_ahead(zio=%d, slice_count=%d)", (int)zio->id,
+	slice_count));
+
+#ifdef ENABLE_PTHREAD
+    if (slice_count < 0)
+	goto failed;
+    if (0 < slice_count && zio->code != ZIO_EBZIP1
+	&& zio->code != ZIO_EBZIP2 && zio->code != ZIO_EPWING
+	&& zio->code != ZIO_EPWING6 && zio->code != ZIO_SEBXA)
+	goto failed;
+
+    pthread_mutex_lock(&read_ahead_mutex);
+    zio->read_ahead_count = slice_count;
+    pthread_mutex_unlock(&read_ahead_mutex);
+
+    LOG(("out: zio_set_read_ahead() = %d", 0));
+    return 0;
+
+    /*
+     * An error occurs...
+     */
+  failed:
+#endif
+    LOG(("out: zio_set_read_ahead() = %d", -1));
+    return -1;
+}
+
+
+/*
+ * Request the worker thread to read slices ahead, after `length' bytes
+ * have been read from `location' in `zio'.
+ */
+static void
+zio_request_read_ahead(Zio *zio, off_t location, size_t length)
+{
+#ifdef ENABLE_PTHREAD
+    Zio_Read_Ahead_Request *request;
+    size_t slice_length;
+    size_t cache_size;
+    off_t next_location;
+    off_t limit_location;
+    int slice_count;
+    int sequential;
+
+    pthread_mutex_lock(&read_ahead_mutex);
+
+    sequential = (location == zio->read_ahead_last);
+    zio->read_ahead_last = location + length;
+    if (!sequential || zio->read_ahead_count <= 0 || read_ahead_stopping)
+	goto succeeded;
+
+    switch (zio->code) {
+    case ZIO_EBZIP1:
+    case ZIO_EBZIP2:
+	slice_length = zio->slice_size;
+	break;
+    case ZIO_EPWING:
+    case ZIO_EPWING6:
+	slice_length = ZIO_SIZE_PAGE;
+	break;
+    case ZIO_SEBXA:
+	slice_length = ZIO_SEBXA_SLICE_LENGTH;
+	break;
+    default:
+	goto succeeded;
+    }
+
+    /*
+     * Don't read ahead more than half of the slice cache, or the
+     * slices would push each other out.
+     */
+    slice_count = zio->read_ahead_count;
+    if (cache_initialized) {
+	cache_size = cache_shards[0].max_size * ZIO_CACHE_SHARD_COUNT;
+	if (cache_size / 2 < slice_length * slice_count)
+	    slice_count = cache_size / 2 / slice_length;
+    }
+
+    /*
+     * Request slices from the one following the last read.
+     * Slices requested before are skipped.
+     */
+    next_location = (location + length + slice_length - 1) / slice_length
+	* slice_length;
+    limit_location = next_location + (off_t) slice_length * slice_count;
+    if (zio->file_size < limit_location)
+	limit_location = zio->file_size;
+    if (next_location < zio->read_ahead_location)
+	next_location = zio->read_ahead_location;
+
+    while (next_location < limit_location
+	&& read_ahead_queue_length < ZIO_READ_AHEAD_QUEUE_LENGTH) {
+	request = read_ahead_queue + (read_ahead_queue_head
+	    + read_ahead_queue_length) % ZIO_READ_AHEAD_QUEUE_LENGTH;
+	request->zio = zio;
+	request->location = next_location;
+	read_ahead_queue_length++;
+	next_location += slice_length;
+    }
+    if (zio->read_ahead_location < next_location)
+	zio->read_ahead_location = next_location;
+
+    /*
+     * Start the worker thread, if it is not running.
+     */
+    if (read_ahead_queue_length == 0)
+	goto succeeded;
+    if (!read_ahead_running) {
+	if (pthread_create(&read_ahead_thread, NULL, zio_read_ahead_worker,
+	    NULL) != 0) {
+	    read_ahead_queue_length = 0;
+	    goto succeeded;
+	}
+	read_ahead_running = 1;
+    }
+    pthread_cond_signal(&read_ahead_request_cond);
+
+  succeeded:
+    pthread_mutex_unlock(&read_ahead_mutex);
+#endif
+}
+
+
+/*
+ * Discard read-ahead requests for `zio', and wait until the worker
+ * thread finishes reading a slice of `zio'.
+ */
+static void
+zio_cancel_read_ahead(Zio *zio)
+{
+#ifdef ENABLE_PTHREAD
+    Zio_Read_Ahead_Request *request;
+    int length;
+    int i;
+
+    pthread_mutex_lock(&read_ahead_mutex);
+
+    length = 0;
+    for (i = 0; i < read_ahead_queue_length; i++) {
+	request = read_ahead_queue
+	    + (read_ahead_queue_head + i) % ZIO_READ_AHEAD_QUEUE_LENGTH;
+	if (request->zio == zio)
+	    continue;
+	read_ahead_queue[(read_ahead_queue_head + length)
+	    % ZIO_READ_AHEAD_QUEUE_LENGTH] = *request;
+	length++;
+    }
+    read_ahead_queue_length = length;
+
+    while (read_ahead_current == zio)
+	pthread_cond_wait(&read_ahead_done_cond, &read_ahead_mutex);
+
+    zio->read_ahead_last = -1;
+    zio->read_ahead_location = 0;
+
+    pthread_mutex_unlock(&read_ahead_mutex);
+#endif
+}
+
 
-    /*
-     * Sort the leaf nodes in frequency order.
-     */
-    for (i = 0; i < leaf_count - 1; i++) {
-        target_node = zio->huffman_nodes + i;
-        most_node = target_node;
-        node_p = zio->huffman_nodes + i + 1;
+/*
+ * Stop the worker thread, and discard all read-ahead requests.
+ */
+static void
+zio_stop_read_ahead(void)
+{
+#ifdef ENABLE_PTHREAD
+    pthread_mutex_lock(&read_ahead_mutex);
+    if (!read_ahead_running) {
+	pthread_mutex_unlock(&read_ahead_mutex);
+	return;
+    }
+    read_ahead_stopping = 1;
+    pthread_cond_signal(&read_ahead_request_cond);
+    pthread_mutex_unlock(&read_ahead_mutex);
 
-        for (j = i + 1; j < leaf_count; j++) {
-            if (most_node->frequency < node_p->frequency)
-                most_node = node_p;
-            node_p++;
-        }
+    pthread_join(read_ahead_thread, NULL);
 
-        temporary_node.type = most_node->type;
-        temporary_node.value = most_node->value;
-        temporary_node.frequency = most_node->frequency;
+    pthread_mutex_lock(&read_ahead_mutex);
+    read_ahead_queue_length = 0;
+    read_ahead_running = 0;
+    read_ahead_stopping = 0;
+    pthread_mutex_unlock(&read_ahead_mutex);
+#endif
+}
 
-        most_node->type = target_node->type;
-        most_node->value = target_node->value;
-        most_node->frequency = target_node->frequency;
 
-        target_node->type = temporary_node.type;
-        target_node->value = temporary_node.value;
-        target_node->frequency = temporary_node.frequency;
-    }
+#ifdef ENABLE_PTHREAD
+/*
+ * The worker thread which reads slices ahead.  It reads a byte of
+ * each requested slice, so that the slice is uncompressed into the
+ * slice cache.  Requests for adjacent ebzip slices are taken together,
+ * and the slices are uncompressed by a batch.
+ */
+static void *
+zio_read_ahead_worker(void *arg)
+{
+    Zio_Read_Ahead_Request request;
+    Zio_Read_Ahead_Request *next_request;
+    char buffer[1];
+    int slice_count;
+    int i;
 
-    /*
-     * Make intermediate nodes of the huffman tree.
-     * The number of intermediate nodes of the tree is <the number of
-     * leaf nodes> - 1.
-     */
-    for (i = 1; i < leaf_count; i++) {
-	/*
-	 * Initialize a new intermediate node.
-	 */
-	tail_node_p->type = ZIO_HUFFMAN_NODE_INTERMEDIATE;
-	tail_node_p->left = NULL;
-	tail_node_p->right = NULL;
+    pthread_mutex_lock(&read_ahead_mutex);
+    for (;;) {
+	while (read_ahead_queue_length == 0 && !read_ahead_stopping)
+	    pthread_cond_wait(&read_ahead_request_cond, &read_ahead_mutex);
+	if (read_ahead_stopping)
+	    break;
 
-	/*
-	 * Find for a least frequent node.
-	 * That node becomes a left child of the new intermediate node.
-	 */
-	least_node_p = NULL;
-	for (node_p = zio->huffman_nodes; node_p < tail_node_p; node_p++) {
-	    if (node_p->frequency == 0)
-		continue;
-	    if (least_node_p == NULL
-		|| node_p->frequency <= least_node_p->frequency)
-		least_node_p = node_p;
+	request = read_ahead_queue[read_ahead_queue_head];
+	read_ahead_queue_head = (read_ahead_queue_head + 1)
+	    % ZIO_READ_AHEAD_QUEUE_LENGTH;
+	read_ahead_queue_length--;
+
+	slice_count = 1;
+	if (request.zio->code == ZIO_EBZIP1
+	    || request.zio->code == ZIO_EBZIP2) {
+	    while (0 < read_ahead_queue_length
+		&& slice_count < ZIO_MAX_BATCH_SLICES) {
+		next_request = read_ahead_queue + read_ahead_queue_head;
+		if (next_request->zio != request.zio
+		    || next_request->location != request.location
+		    + (off_t) request.zio->slice_size * slice_count)
+		    break;
+		read_ahead_queue_head = (read_ahead_queue_head + 1)
+		    % ZIO_READ_AHEAD_QUEUE_LENGTH;
+		read_ahead_queue_length--;
+		slice_count++;
+	    }
 	}
-	if (least_node_p == NULL)
-	    goto failed;
-	tail_node_p->left = least_node_p;
-	tail_node_p->frequency = least_node_p->frequency;
-	least_node_p->frequency = 0;
-
-	/*
-	 * Find for a next least frequent node.
-	 * That node becomes a right child of the new intermediate node.
-	 */
-	least_node_p = NULL;
-	for (node_p = zio->huffman_nodes; node_p < tail_node_p; node_p++) {
-	    if (node_p->frequency == 0)
-		continue;
-	    if (least_node_p == NULL
-		|| node_p->frequency <= least_node_p->frequency)
-		least_node_p = node_p;
+	read_ahead_current = request.zio;
+	pthread_mutex_unlock(&read_ahead_mutex);
+
+	switch (request.zio->code) {
+	case ZIO_EBZIP1:
+	case ZIO_EBZIP2:
+	    if (zio_load_ebzip_slices(request.zio,
+		request.location / request.zio->slice_size, slice_count) < 0) {
+		for (i = 0; i < slice_count; i++) {
+		    zio_pread_ebzip(request.zio, request.location
+			+ (off_t) request.zio->slice_size * i, buffer, 1);
+		}
+	    }
+	    break;
+	case ZIO_EPWING:
+	case ZIO_EPWING6:
+	    zio_pread_epwing(request.zio, request.location, buffer, 1);
+	    break;
+	case ZIO_SEBXA:
+	    zio_pread_sebxa(request.zio, request.location, buffer, 1);
+	    break;
 	}
-	if (least_node_p == NULL)
-	    goto failed;
-	tail_node_p->right = least_node_p;
-	tail_node_p->frequency += least_node_p->frequency;
-	least_node_p->frequency = 0;
 
-	tail_node_p++;
+	pthread_mutex_lock(&read_ahead_mutex);
+	read_ahead_current = NULL;
+	pthread_cond_broadcast(&read_ahead_done_cond);
     }
+    pthread_mutex_unlock(&read_ahead_mutex);
 
-    /*
-     * Set a root node of the huffman tree.
-     */
-    zio->huffman_root = tail_node_p - 1;
+    return NULL;
+}
+#endif
 
-    LOG(("out: zio_make_epwing_huffman_tree() = %d", 0));
-    return 0;
 
-    /*
-     * An error occurs...
-     */
-  failed:
-    LOG(("out: zio_make_epwing_huffman_tree() = %d", -1));
-    return -1;
+/*
+ * Add `source' to `stats'.
+ */
+static void
+zio_add_stats(Zio_Stats *stats, Zio_Stats *source)
+{
+    stats->raw_read_bytes += zio_load_stat(source->raw_read_bytes);
+    stats->raw_read_count += zio_load_stat(source->raw_read_count);
+    stats->raw_read_nanoseconds
+	+= zio_load_stat(source->raw_read_nanoseconds);
+    stats->ebzip_slice_count += zio_load_stat(source->ebzip_slice_count);
+    stats->ebzip2_slice_count += zio_load_stat(source->ebzip2_slice_count);
+    stats->epwing_slice_count += zio_load_stat(source->epwing_slice_count);
+    stats->epwing6_slice_count
+	+= zio_load_stat(source->epwing6_slice_count);
+    stats->sebxa_slice_count += zio_load_stat(source->sebxa_slice_count);
+    stats->decode_nanoseconds += zio_load_stat(source->decode_nanoseconds);
+    stats->cache_hit_count += zio_load_stat(source->cache_hit_count);
+    stats->cache_miss_count += zio_load_stat(source->cache_miss_count);
+    stats->shared_cache_hit_count
+	+= zio_load_stat(source->shared_cache_hit_count);
+    stats->disk_cache_hit_count
+	+= zio_load_stat(source->disk_cache_hit_count);
 }
 
 
 /*
- * Close `zio'.
+ * Get the shard of `global_stats' which `zio' is counted in.
  */
-void
-zio_close(Zio *zio)
+static Zio_Stats *
+zio_global_stats(Zio *zio)
 {
-    pthread_mutex_lock(&zio_mutex);
-    LOG(("in: zio_close(zio=%d)", (int)zio->id));
+    return &global_stats[(unsigned int) zio->id % ZIO_CACHE_SHARD_COUNT]
+	.stats;
+}
 
-    /*
-     * If contents of the file is cached, clear the cache.
-     */
-    if (0 <= zio->file)
-	zio_close_raw(zio);
-    zio->file = -1;
 
-    LOG(("out: zio_close()"));
-    pthread_mutex_unlock(&zio_mutex);
+/*
+ * Get the current time for I/O statistics, in nanoseconds.
+ * If the time is not measured (see zio_set_stats_timing()), or
+ * clock_gettime() is not available, it always returns 0.
+ */
+static unsigned long long
+zio_clock(void)
+{
+#ifdef HAVE_CLOCK_GETTIME
+    struct timespec now;
+
+    if (!stats_timing)
+	return 0;
+    if (clock_gettime(CLOCK_MONOTONIC, &now) < 0)
+	return 0;
+    return (unsigned long long)now.tv_sec * 1000000000
+	+ (unsigned long long)now.tv_nsec;
+#else
+    return 0;
+#endif
 }
 
 
 /*
- * Return file descriptor of `zio'.
+ * Get the time elapsed since `start_time', which zio_clock() returned,
+ * in nanoseconds.  If the time is not measured, it returns 0.
  */
-int
-zio_file(Zio *zio)
+static unsigned long long
+zio_elapsed(unsigned long long start_time)
 {
-    LOG(("in+out: zio_file(zio=%d) = %d", (int)zio->id, zio->file));
-
-    return zio->file;
+    unsigned long long now;
+
+    if (start_time == 0)
+	return 0;
+    now = zio_clock();
+    if (now < start_time)
+	return 0;
+    return now - start_time;
 }
 
 
 /*
- * Return compression mode of `zio'.
+ * Count `length' bytes read from `zio->file' by `count' system calls
+ * in `nanoseconds'.
  */
-Zio_Code
-zio_mode(Zio *zio)
+static void
+zio_count_raw_read(Zio *zio, size_t length, int count,
+    unsigned long long nanoseconds)
 {
-    LOG(("in+out: zio_mode(zio=%d) = %d", (int)zio->id, zio->code));
+    Zio_Stats *targets[2];
+    int i;
 
-    return zio->code;
+    targets[0] = &zio->stats;
+    targets[1] = zio_global_stats(zio);
+
+    zio_lock_stats();
+    for (i = 0; i < 2; i++) {
+	zio_add_stat(targets[i]->raw_read_bytes, length);
+	zio_add_stat(targets[i]->raw_read_count, count);
+	if (0 < nanoseconds)
+	    zio_add_stat(targets[i]->raw_read_nanoseconds, nanoseconds);
+    }
+    zio_unlock_stats();
 }
 
 
 /*
- * Seek `zio'.
+ * Count a slice of `zio' uncompressed in `nanoseconds', on a miss of
+ * the slice cache.
  */
-off_t
-zio_lseek(Zio *zio, off_t location, int whence)
+static void
+zio_count_slice(Zio *zio, unsigned long long nanoseconds)
 {
-    off_t result;
-
-    LOG(("in: zio_lseek(zio=%d, location=%ld, whence=%d)",
-	(int)zio->id, (long)location, whence));
+    Zio_Stats *targets[2];
+    int i;
 
-    if (zio->file < 0)
-	goto failed;
+    targets[0] = &zio->stats;
+    targets[1] = zio_global_stats(zio);
 
-    if (zio->code == ZIO_PLAIN) {
-	/*
-	 * If `zio' is not compressed, simply call lseek().
-	 */
-	result = zio_lseek_raw(zio, location, whence);
-    } else {
-	/*
-	 * Calculate new location according with `whence'.
-	 */
-	switch (whence) {
-	case SEEK_SET:
-	    zio->location = location;
+    zio_lock_stats();
+    for (i = 0; i < 2; i++) {
+	switch (zio->code) {
+	case ZIO_EBZIP1:
+	    zio_add_stat(targets[i]->ebzip_slice_count, 1);
 	    break;
-	case SEEK_CUR:
-	    zio->location = zio->location + location;
+	case ZIO_EBZIP2:
+	    zio_add_stat(targets[i]->ebzip2_slice_count, 1);
 	    break;
-	case SEEK_END:
-	    zio->location = zio->file_size - location;
+	case ZIO_EPWING:
+	    zio_add_stat(targets[i]->epwing_slice_count, 1);
+	    break;
+	case ZIO_EPWING6:
+	    zio_add_stat(targets[i]->epwing6_slice_count, 1);
+	    break;
+	case ZIO_SEBXA:
+	    zio_add_stat(targets[i]->sebxa_slice_count, 1);
 	    break;
 	default:
-#ifdef EINVAL
-	    errno = EINVAL;
-#endif
-	    goto failed;
+	    break;
 	}
+	if (0 < nanoseconds)
+	    zio_add_stat(targets[i]->decode_nanoseconds, nanoseconds);
+	zio_add_stat(targets[i]->cache_miss_count, 1);
+    }
+    zio_unlock_stats();
+}
 
-	/*
-	 * Adjust location.
-	 */
-	if (zio->location < 0)
-	    zio->location = 0;
-	if (zio->file_size < zio->location)
-	    zio->location = zio->file_size;
+
+/*
+ * Count `hit_count' hits of the slice cache for `zio'.
+ */
+static void
+zio_count_cache_hits(Zio *zio, int hit_count)
+{
+    if (hit_count == 0)
+	return;
+
+    zio_lock_stats();
+    zio_add_stat(zio->stats.cache_hit_count, hit_count);
+    zio_add_stat(zio_global_stats(zio)->cache_hit_count, hit_count);
+    zio_unlock_stats();
+}
+
+
+#ifdef ZIO_USE_SHARED_CACHE
+/*
+ * Count a hit of the shared slice cache for `zio'.  (It is also a miss
+ * of the slice cache.)
+ */
+static void
+zio_count_shared_cache_hit(Zio *zio)
+{
+    Zio_Stats *stats = zio_global_stats(zio);
+
+    zio_lock_stats();
+    zio_add_stat(zio->stats.shared_cache_hit_count, 1);
+    zio_add_stat(zio->stats.cache_miss_count, 1);
+    zio_add_stat(stats->shared_cache_hit_count, 1);
+    zio_add_stat(stats->cache_miss_count, 1);
+    zio_unlock_stats();
+}
+#endif
+
+
+#ifdef ZIO_USE_DISK_CACHE
+/*
+ * Count a hit of the disk cache for `zio'.  (It is also a miss of the
+ * slice cache.)
+ */
+static void
+zio_count_disk_cache_hit(Zio *zio)
+{
+    Zio_Stats *stats = zio_global_stats(zio);
+
+    zio_lock_stats();
+    zio_add_stat(zio->stats.disk_cache_hit_count, 1);
+    zio_add_stat(zio->stats.cache_miss_count, 1);
+    zio_add_stat(stats->disk_cache_hit_count, 1);
+    zio_add_stat(stats->cache_miss_count, 1);
+    zio_unlock_stats();
+}
+#endif
+
+
+/*
+ * Read data from the `zio' file compressed with the ebzip or ebzip2
+ * compression format.
+ */
+static ssize_t
+zio_pread_ebzip(Zio *zio, off_t location, char *buffer, size_t length)
+{
+    ssize_t read_length = 0;
+    Zio_Cache_Entry *entry = NULL;
+    off_t slice;
+    size_t offset;
+    int n;
+    int hit_count = 0;
+
+    LOG(("in: zio_pread_ebzip(zio=%d, location=%ld, length=%ld)",
+	(int)zio->id, (long)location, (long)length));
+
+    /*
+     * If the data spans several slices, uncompress them by a batch.
+     * (If it fails, the slices are read one by one below.)
+     */
+    if (zio->map == NULL && 0 <= zio->id && 0 < length
+	&& location < zio->file_size) {
+	slice = location / zio->slice_size;
+	n = (location + length - 1) / zio->slice_size - slice + 1;
+	if (1 < n)
+	    zio_load_ebzip_slices(zio, slice, n);
+    }
+
+    /*
+     * Read data.
+     */
+    while (read_length < length) {
+	if (zio->file_size <= location)
+	    goto succeeded;
+
+	slice = location / zio->slice_size;
+	offset = location % zio->slice_size;
+	n = zio->slice_size - offset;
+	if (length - read_length < n)
+	    n = length - read_length;
+	if (zio->file_size - location < n)
+	    n = zio->file_size - location;
 
 	/*
-	 * Update `zio->location'.
-	 * (We don't actually seek the file.)
+	 * If the slice is not in the cache, read data from `zio->file'.
 	 */
-	result = zio->location;
+	if (zio_cache_copy(zio->id, slice, offset, buffer + read_length, n)
+	    < 0) {
+	    entry = zio_cache_new_entry(zio->id, slice, zio->slice_size);
+	    if (entry == NULL)
+		goto failed;
+	    if (zio_copy_stored_slice(zio, slice, entry->buffer,
+		zio->slice_size) < 0) {
+		if (zio_uncompress_ebzip_slice(zio, slice, entry->buffer) < 0)
+		    goto failed;
+		zio_store_slice(zio, slice, entry->buffer,
+		    zio->slice_size);
+	    }
+
+	    memcpy(buffer + read_length, entry->buffer + offset, n);
+	    zio_cache_insert(entry);
+	    entry = NULL;
+	} else {
+	    hit_count++;
+	}
+	read_length += n;
+	location += n;
     }
 
-    LOG(("out: zio_lseek() = %ld", (long)result));
-    return result;
+  succeeded:
+    zio_count_cache_hits(zio, hit_count);
+    LOG(("out: zio_pread_ebzip() = %ld", (long)read_length));
+    return read_length;
 
     /*
      * An error occurs...
      */
   failed:
-    LOG(("out: zio_lseek() = %ld", (long)-1));
+    if (entry != NULL)
+	free(entry);
+    zio_count_cache_hits(zio, hit_count);
+    LOG(("out: zio_pread_ebzip() = %ld", (long)-1));
     return -1;
 }
 
 
 /*
- * Read data from `zio' file.
+ * Uncompress the slice `slice' of the `zio' file compressed with the
+ * ebzip or ebzip2 compression format into `out_buffer'.
+ *
+ * If it succeeds, 0 is returned.  Otherwise, -1 is returned.
  */
-ssize_t
-zio_read(Zio *zio, char *buffer, size_t length)
+static int
+zio_uncompress_ebzip_slice(Zio *zio, off_t slice, char *out_buffer)
 {
-    ssize_t read_length;
-
-    pthread_mutex_lock(&zio_mutex);
-    LOG(("in: zio_read(zio=%d, length=%ld)", (int)zio->id, (long)length));
+    char temporary_buffer[10];
+    const char *index_entry;
+    size_t zipped_slice_size;
+    off_t slice_location;
+    off_t next_slice_location;
+    unsigned long long start_time;
 
     /*
-     * If the zio `file' is not compressed, call read() and return.
+     * Get buffer location and size from the index table in memory,
+     * or in `zio->file'.
      */
-    if (zio->file < 0)
-	goto failed;
+    if ((slice + 2) * zio->index_width <= zio->index_table_length) {
+	index_entry = zio->index_table + slice * zio->index_width;
+    } else {
+	if (zio_pread_raw(zio, slice * zio->index_width
+	    + ZIO_SIZE_EBZIP_HEADER, temporary_buffer,
+	    zio->index_width * 2) != zio->index_width * 2)
+	    return -1;
+	index_entry = temporary_buffer;
+    }
 
-    switch (zio->code) {
-    case ZIO_PLAIN:
-	read_length = zio_read_raw(zio, buffer, length);
+    switch (zio->index_width) {
+    case 2:
+	slice_location = zio_uint2(index_entry);
+	next_slice_location = zio_uint2(index_entry + 2);
 	break;
-    case ZIO_EBZIP1:
-	read_length = zio_read_ebzip(zio, buffer, length);
+    case 3:
+	slice_location = zio_uint3(index_entry);
+	next_slice_location = zio_uint3(index_entry + 3);
 	break;
-    case ZIO_EPWING:
-    case ZIO_EPWING6:
-	read_length = zio_read_epwing(zio, buffer, length);
+    case 4:
+	slice_location = zio_uint4(index_entry);
+	next_slice_location = zio_uint4(index_entry + 4);
 	break;
-    case ZIO_SEBXA:
-	read_length = zio_read_sebxa(zio, buffer, length);
+    case 5:
+	slice_location = zio_uint5(index_entry);
+	next_slice_location = zio_uint5(index_entry + 5);
 	break;
     default:
-	goto failed;
+	return -1;
     }
+    zipped_slice_size = next_slice_location - slice_location;
 
-    LOG(("out: zio_read() = %ld", (long)read_length));
-    pthread_mutex_unlock(&zio_mutex);
-
-    return read_length;
+    if (next_slice_location <= slice_location
+	|| zio->slice_size < zipped_slice_size)
+	return -1;
 
     /*
-     * An error occurs...
+     * Read a compressed slice from `zio->file' and uncompress it.
+     * The data is not compressed if its size is equals to slice size.
      */
-  failed:
-    LOG(("out: zio_read() = %ld", (long)-1));
-    return -1;
+    start_time = zio_clock();
+    if (zio->code == ZIO_EBZIP1) {
+	if (zio_unzip_slice_ebzip1(zio, slice_location, out_buffer,
+	    zipped_slice_size, NULL) < 0)
+	    return -1;
+    } else {
+	if (zio_unzip_slice_ebzip2(zio, slice_location, out_buffer,
+	    zipped_slice_size, NULL) < 0)
+	    return -1;
+    }
+    zio_count_slice(zio, zio_elapsed(start_time));
+
+    return 0;
 }
 
 
 /*
- * Read data from the `zio' file compressed with the ebzip compression
- * format.
+ * Uncompress `slice_count' ebzip or ebzip2 slices from `slice' in
+ * `zio' into the slice cache.  Slices in the cache already are
+ * skipped.  The compressed slices are read by a batch of raw reads
+ * (adjacent slices are read by a request), and then uncompressed.
+ * `slice_count' is limited by ZIO_MAX_BATCH_SLICES, and by the size
+ * of the slice cache.
+ *
+ * If it succeeds, 0 is returned.  Otherwise, -1 is returned.
  */
-static ssize_t
-zio_read_ebzip(Zio *zio, char *buffer, size_t length)
+static int
+zio_load_ebzip_slices(Zio *zio, off_t slice, int slice_count)
 {
-    char temporary_buffer[8];
-    ssize_t read_length = 0;
+    char index_buffer[(ZIO_MAX_BATCH_SLICES + 1) * 5];
+    const char *index_entry;
+    off_t slice_locations[ZIO_MAX_BATCH_SLICES + 1];
+    int missing_slices[ZIO_MAX_BATCH_SLICES];
+    Zio_Read_Request requests[ZIO_MAX_BATCH_SLICES];
+    Zio_Cache_Entry *entry = NULL;
+    char *zipped_buffer = NULL;
+    char *zipped_p;
+    size_t zipped_length;
     size_t zipped_slice_size;
-    off_t slice_location;
-    off_t next_slice_location;
-    int n;
+    size_t cache_size;
+    off_t last_slice;
+    int missing_count;
+    int request_count;
+    int result;
+    int i;
+    unsigned long long start_time;
+
+    LOG(("in: zio_load_ebzip_slices(zio=%d, slice=%ld, slice_count=%d)",
+	(int)zio->id, (long)slice, slice_count));
 
-    LOG(("in: zio_read_ebzip(zio=%d, length=%ld)", (int)zio->id,
-	(long)length));
+    if (!cache_initialized)
+	goto failed;
 
     /*
-     * Read data.
+     * Limit the number of slices.  Don't uncompress more than half of
+     * the slice cache, or the slices would push each other out.
      */
-    while (read_length < length) {
-	if (zio->file_size <= zio->location)
-	    goto succeeded;
+    last_slice = (zio->file_size + zio->slice_size - 1) / zio->slice_size;
+    if (last_slice - slice < slice_count)
+	slice_count = last_slice - slice;
+    if (ZIO_MAX_BATCH_SLICES < slice_count)
+	slice_count = ZIO_MAX_BATCH_SLICES;
+    cache_size = cache_shards[0].max_size * ZIO_CACHE_SHARD_COUNT;
+    if (cache_size / 2 < zio->slice_size * slice_count)
+	slice_count = cache_size / 2 / zio->slice_size;
+    if (slice_count <= 0)
+	goto failed;
 
-	/*
-	 * If data in `cache_buffer' is out of range, read data from
-	 * `zio->file'.
-	 */
-	if (cache_zio_id != zio->id
-	    || zio->location < cache_location
-	    || cache_location + zio->slice_size <= zio->location) {
+    /*
+     * Slices in the shared slice cache or the disk cache are copied
+     * into the slice cache here.
+     */
+    missing_count = 0;
+    for (i = 0; i < slice_count; i++) {
+	if (zio_cache_contains(zio->id, slice + i))
+	    continue;
+	if (zio_load_stored_slice(zio, slice + i) < 0)
+	    missing_slices[missing_count++] = i;
+    }
+    if (missing_count == 0)
+	goto succeeded;
 
-	    cache_zio_id = ZIO_ID_NONE;
-	    cache_location = zio->location - (zio->location % zio->slice_size);
+    /*
+     * Get buffer locations of the slices from the index table in
+     * memory, or in `zio->file'.
+     */
+    if ((slice + slice_count + 1) * zio->index_width
+	<= zio->index_table_length) {
+	index_entry = zio->index_table + slice * zio->index_width;
+    } else {
+	if (zio_pread_raw(zio, slice * zio->index_width
+	    + ZIO_SIZE_EBZIP_HEADER, index_buffer,
+	    zio->index_width * (slice_count + 1))
+	    != zio->index_width * (slice_count + 1))
+	    goto failed;
+	index_entry = index_buffer;
+    }
 
-	    /*
-	     * Get buffer location and size from index table in `zio->file'.
-	     */
-	    if (zio_lseek_raw(zio, zio->location / zio->slice_size
-		* zio->index_width + ZIO_SIZE_EBZIP_HEADER, SEEK_SET) < 0)
-		goto failed;
-	    if (zio_read_raw(zio, temporary_buffer, zio->index_width * 2)
-		!= zio->index_width * 2)
-		goto failed;
+    for (i = 0; i <= slice_count; i++) {
+	switch (zio->index_width) {
+	case 2:
+	    slice_locations[i] = zio_uint2(index_entry);
+	    break;
+	case 3:
+	    slice_locations[i] = zio_uint3(index_entry);
+	    break;
+	case 4:
+	    slice_locations[i] = zio_uint4(index_entry);
+	    break;
+	case 5:
+	    slice_locations[i] = zio_uint5(index_entry);
+	    break;
+	default:
+	    goto failed;
+	}
+	index_entry += zio->index_width;
+    }
 
-	    switch (zio->index_width) {
-	    case 2:
-		slice_location = zio_uint2(temporary_buffer);
-		next_slice_location = zio_uint2(temporary_buffer + 2);
-		break;
-	    case 3:
-		slice_location = zio_uint3(temporary_buffer);
-		next_slice_location = zio_uint3(temporary_buffer + 3);
-		break;
-	    case 4:
-		slice_location = zio_uint4(temporary_buffer);
-		next_slice_location = zio_uint4(temporary_buffer + 4);
-		break;
-	    case 5:
-		slice_location = zio_uint5(temporary_buffer);
-		next_slice_location = zio_uint5(temporary_buffer + 5);
-		break;
-	    default:
-		goto failed;
-	    }
-	    zipped_slice_size = next_slice_location - slice_location;
+    /*
+     * Make a read request for each run of adjacent missing slices.
+     * The compressed slices are read into `zipped_buffer' in order.
+     */
+    zipped_length = 0;
+    for (i = 0; i < missing_count; i++) {
+	zipped_slice_size = slice_locations[missing_slices[i] + 1]
+	    - slice_locations[missing_slices[i]];
+	if (slice_locations[missing_slices[i] + 1]
+	    <= slice_locations[missing_slices[i]]
+	    || zio->slice_size < zipped_slice_size)
+	    goto failed;
+	zipped_length += zipped_slice_size;
+    }
+    zipped_buffer = (char *) malloc(zipped_length);
+    if (zipped_buffer == NULL)
+	goto failed;
 
-	    if (next_slice_location <= slice_location
-		|| zio->slice_size < zipped_slice_size)
-		goto failed;
+    request_count = 0;
+    zipped_p = zipped_buffer;
+    for (i = 0; i < missing_count; i++) {
+	zipped_slice_size = slice_locations[missing_slices[i] + 1]
+	    - slice_locations[missing_slices[i]];
+	if (0 < i && missing_slices[i - 1] + 1 == missing_slices[i]) {
+	    requests[request_count - 1].length += zipped_slice_size;
+	} else {
+	    requests[request_count].location
+		= slice_locations[missing_slices[i]];
+	    requests[request_count].buffer = zipped_p;
+	    requests[request_count].length = zipped_slice_size;
+	    request_count++;
+	}
+	zipped_p += zipped_slice_size;
+    }
 
-	    /*
-	     * Read a compressed slice from `zio->file' and uncompress it.
-	     * The data is not compressed if its size is equals to
-	     * slice size.
-	     */
-	    if (zio_lseek_raw(zio, slice_location, SEEK_SET) < 0)
-		goto failed;
-	    if (zio_unzip_slice_ebzip1(zio, cache_buffer, zipped_slice_size)
-		< 0)
-		goto failed;
+    if (zio_pread_raw_batch(zio, requests, request_count) < 0)
+	goto failed;
+
+    /*
+     * Uncompress the slices.
+     */
+    zipped_p = zipped_buffer;
+    for (i = 0; i < missing_count; i++) {
+	zipped_slice_size = slice_locations[missing_slices[i] + 1]
+	    - slice_locations[missing_slices[i]];
+	entry = zio_cache_new_entry(zio->id, slice + missing_slices[i],
+	    zio->slice_size);
+	if (entry == NULL)
+	    goto failed;
 
-	    cache_zio_id = zio->id;
+	start_time = zio_clock();
+	if (zio->code == ZIO_EBZIP1) {
+	    result = zio_unzip_slice_ebzip1(zio,
+		slice_locations[missing_slices[i]], entry->buffer,
+		zipped_slice_size, zipped_p);
+	} else {
+	    result = zio_unzip_slice_ebzip2(zio,
+		slice_locations[missing_slices[i]], entry->buffer,
+		zipped_slice_size, zipped_p);
 	}
+	if (result < 0)
+	    goto failed;
+	zio_count_slice(zio, zio_elapsed(start_time));
+	zio_store_slice(zio, slice + missing_slices[i], entry->buffer,
+	    zio->slice_size);
 
-	/*
-	 * Copy data from `cache_buffer' to `buffer'.
-	 */
-	n = zio->slice_size - (zio->location % zio->slice_size);
-	if (length - read_length < n)
-	    n = length - read_length;
-	if (zio->file_size - zio->location < n)
-	    n = zio->file_size - zio->location;
-	memcpy(buffer + read_length,
-	    cache_buffer + (zio->location % zio->slice_size), n);
-	read_length += n;
-	zio->location += n;
+	zio_cache_insert(entry);
+	entry = NULL;
+	zipped_p += zipped_slice_size;
     }
 
   succeeded:
-    LOG(("out: zio_read_ebzip() = %ld", (long)read_length));
-    return read_length;
+    if (zipped_buffer != NULL)
+	free(zipped_buffer);
+    LOG(("out: zio_load_ebzip_slices() = %d", 0));
+    return 0;
 
     /*
      * An error occurs...
      */
   failed:
-    LOG(("out: zio_read_ebzip() = %ld", (long)-1));
+    if (entry != NULL)
+	free(entry);
+    if (zipped_buffer != NULL)
+	free(zipped_buffer);
+    LOG(("out: zio_load_ebzip_slices() = %d", -1));
     return -1;
 }
 
@@ -1265,318 +5003,656 @@ zio_read_ebzip(Zio *zio, char *buffer, size_t length)
  * compression format.
  */
 static ssize_t
-zio_read_epwing(Zio *zio, char *buffer, size_t length)
+zio_pread_epwing(Zio *zio, off_t location, char *buffer, size_t length)
 {
-    char temporary_buffer[36];
     ssize_t read_length = 0;
-    off_t page_location;
+    Zio_Cache_Entry *entry = NULL;
+    off_t slice;
+    size_t offset;
     int n;
+    int hit_count = 0;
 
-    LOG(("in: zio_read_epwing(zio=%d, length=%ld)", (int)zio->id,
-	(long)length));
+    LOG(("in: zio_pread_epwing(zio=%d, location=%ld, length=%ld)",
+	(int)zio->id, (long)location, (long)length));
 
     /*
      * Read data.
      */
     while (read_length < length) {
-	if (zio->file_size <= zio->location)
+	if (zio->file_size <= location)
 	    goto succeeded;
 
+	slice = location / ZIO_SIZE_PAGE;
+	offset = location % ZIO_SIZE_PAGE;
+	n = ZIO_SIZE_PAGE - offset;
+	if (length - read_length < n)
+	    n = length - read_length;
+	if (zio->file_size - location < n)
+	    n = zio->file_size - location;
+
 	/*
-	 * If data in `cache_buffer' is out of range, read data from the zio
-	 * file.
+	 * If the page is not in the cache, read data from the zio file.
 	 */
-	if (cache_zio_id != zio->id
-	    || zio->location < cache_location
-	    || cache_location + zio->slice_size <= zio->location) {
-	    cache_zio_id = ZIO_ID_NONE;
-	    cache_location = zio->location - (zio->location % zio->slice_size);
-
-	    /*
-	     * Get page location from index table in `zio->file'.
-	     */
-	    if (zio_lseek_raw(zio, zio->index_location
-		+ zio->location / (ZIO_SIZE_PAGE * 16) * 36, SEEK_SET) < 0)
+	if (zio_cache_copy(zio->id, slice, offset, buffer + read_length, n)
+	    < 0) {
+	    entry = zio_cache_new_entry(zio->id, slice, ZIO_SIZE_PAGE);
+	    if (entry == NULL)
 		goto failed;
-	    if (zio_read_raw(zio, temporary_buffer, 36) != 36)
-		goto failed;
-	    page_location = zio_uint4(temporary_buffer)
-		+ zio_uint2(temporary_buffer + 4
-		    + (zio->location / ZIO_SIZE_PAGE % 16) * 2);
-
-	    /*
-	     * Read a compressed page from `zio->file' and uncompress it.
-	     */
-	    if (zio_lseek_raw(zio, page_location, SEEK_SET) < 0)
-		goto failed;
-	    if (zio->code == ZIO_EPWING) {
-		if (zio_unzip_slice_epwing(zio, cache_buffer) < 0)
-		    goto failed;
-	    } else {
-		if (zio_unzip_slice_epwing6(zio, cache_buffer) < 0)
+	    if (zio_copy_stored_slice(zio, slice, entry->buffer,
+		ZIO_SIZE_PAGE) < 0) {
+		if (zio_uncompress_epwing_slice(zio, slice, entry->buffer) < 0)
 		    goto failed;
+		zio_store_slice(zio, slice, entry->buffer,
+		    ZIO_SIZE_PAGE);
 	    }
 
-	    cache_zio_id = zio->id;
+	    memcpy(buffer + read_length, entry->buffer + offset, n);
+	    zio_cache_insert(entry);
+	    entry = NULL;
+	} else {
+	    hit_count++;
 	}
-
-	/*
-	 * Copy data from `cache_buffer' to `buffer'.
-	 */
-	n = ZIO_SIZE_PAGE - (zio->location % ZIO_SIZE_PAGE);
-	if (length - read_length < n)
-	    n = length - read_length;
-	if (zio->file_size - zio->location < n)
-	    n = zio->file_size - zio->location;
-	memcpy(buffer + read_length,
-	    cache_buffer + (zio->location - cache_location), n);
 	read_length += n;
-	zio->location += n;
+	location += n;
     }
 
   succeeded:
-    LOG(("out: zio_read_epwing() = %ld", (long)read_length));
+    zio_count_cache_hits(zio, hit_count);
+    LOG(("out: zio_pread_epwing() = %ld", (long)read_length));
     return read_length;
 
     /*
      * An error occurs...
      */
   failed:
-    LOG(("out: zio_read_epwing() = %ld", (long)-1));
+    if (entry != NULL)
+	free(entry);
+    zio_count_cache_hits(zio, hit_count);
+    LOG(("out: zio_pread_epwing() = %ld", (long)-1));
     return -1;
 }
 
 
-#define ZIO_SEBXA_SLICE_LENGTH	4096
+/*
+ * Uncompress the page `slice' of the `zio' file compressed with the
+ * EPWING or EPWING V6 compression format into `out_buffer'.
+ *
+ * If it succeeds, 0 is returned.  Otherwise, -1 is returned.
+ */
+static int
+zio_uncompress_epwing_slice(Zio *zio, off_t slice, char *out_buffer)
+{
+    char temporary_buffer[36];
+    const char *index_group;
+    off_t page_location;
+    unsigned long long start_time;
+
+    /*
+     * Get page location from the index table in memory, or in
+     * `zio->file'.  An index group consists of 16 pages.
+     */
+    if ((slice / 16 + 1) * 36 <= zio->index_table_length) {
+	index_group = zio->index_table + slice / 16 * 36;
+    } else {
+	if (zio_pread_raw(zio, zio->index_location + slice / 16 * 36,
+	    temporary_buffer, 36) != 36)
+	    return -1;
+	index_group = temporary_buffer;
+    }
+    page_location = zio_uint4(index_group)
+	+ zio_uint2(index_group + 4 + (slice % 16) * 2);
+
+    /*
+     * Read a compressed page from `zio->file' and uncompress it.
+     */
+    start_time = zio_clock();
+    if (zio->code == ZIO_EPWING) {
+	if (zio_unzip_slice_epwing(zio, page_location, out_buffer) < 0)
+	    return -1;
+    } else {
+	if (zio_unzip_slice_epwing6(zio, page_location, out_buffer) < 0)
+	    return -1;
+    }
+    zio_count_slice(zio, zio_elapsed(start_time));
+
+    return 0;
+}
+
 
 /*
  * Read data from the zio `file' compressed with the S-EBXA compression
  * format.
  */
 static ssize_t
-zio_read_sebxa(Zio *zio, char *buffer, size_t length)
+zio_pread_sebxa(Zio *zio, off_t location, char *buffer, size_t length)
 {
-    char temporary_buffer[4];
     ssize_t read_length = 0;
-    off_t slice_location;
+    Zio_Cache_Entry *entry = NULL;
+    off_t slice;
+    size_t offset;
     ssize_t n;
+    int hit_count = 0;
     int slice_index;
 
-    LOG(("in: zio_read_sebxa(zio=%d, length=%ld)", (int)zio->id,
-	(long)length));
+    LOG(("in: zio_pread_sebxa(zio=%d, location=%ld, length=%ld)",
+	(int)zio->id, (long)location, (long)length));
 
     /*
      * Read data.
      */
     while (read_length < length) {
-	if (zio->file_size <= zio->location)
+	if (zio->file_size <= location)
 	    goto succeeded;
 
-	if (zio->location < zio->zio_start_location) {
+	if (location < zio->zio_start_location) {
 	    /*
 	     * Data is located in front of compressed text.
 	     */
-	    if (zio->zio_start_location - zio->location < length - read_length)
-		n = zio->zio_start_location - zio->location;
+	    if (zio->zio_start_location - location < length - read_length)
+		n = zio->zio_start_location - location;
 	    else
 		n = length - read_length;
-	    if (zio_lseek_raw(zio, zio->location, SEEK_SET) < 0)
-		goto failed;
-	    if (zio_read_raw(zio, buffer, n) != n)
+	    if (zio_pread_raw(zio, location, buffer + read_length, n) != n)
 		goto failed;
 	    read_length += n;
+	    location += n;
 
-	} else if (zio->zio_end_location <= zio->location) {
+	} else if (zio->zio_end_location <= location) {
 	    /*
 	     * Data is located behind compressed text.
 	     */
-	    if (zio_lseek_raw(zio, zio->location, SEEK_SET) < 0)
-		goto failed;
-	    if (zio_read_raw(zio, buffer, length - read_length)
-		!= length - read_length)
+	    n = length - read_length;
+	    if (zio_pread_raw(zio, location, buffer + read_length, n) != n)
 		goto failed;
-	    read_length = length;
+	    read_length += n;
+	    location += n;
 
 	} else {
 	    /*
 	     * Data is located in compressed text.
-	     *
-	     * If data in `cache_buffer' is out of range, read data from
-	     * `file'.
 	     */
-	    if (cache_zio_id != zio->id
-		|| zio->location < cache_location
-		|| cache_location + ZIO_SEBXA_SLICE_LENGTH <= zio->location) {
-
-		cache_zio_id = ZIO_ID_NONE;
-		cache_location = zio->location
-		    - (zio->location % ZIO_SEBXA_SLICE_LENGTH);
+	    slice = location / ZIO_SEBXA_SLICE_LENGTH;
+	    offset = location % ZIO_SEBXA_SLICE_LENGTH;
+	    n = ZIO_SEBXA_SLICE_LENGTH - offset;
+	    if (length - read_length < n)
+		n = length - read_length;
+	    if (zio->file_size - location < n)
+		n = zio->file_size - location;
 
-		/*
-		 * Get buffer location and size.
-		 */
-		slice_index = (zio->location - zio->zio_start_location)
-		    / ZIO_SEBXA_SLICE_LENGTH;
-		if (slice_index == 0)
-		    slice_location = zio->index_base;
-		else {
-		    if (zio_lseek_raw(zio, ((off_t) slice_index - 1) * 4
-			+ zio->index_location, SEEK_SET) < 0)
-			goto failed;
-		    if (zio_read_raw(zio, temporary_buffer, 4) != 4)
+	    /*
+	     * If the slice is not in the cache, read data from `file'.
+	     */
+	    if (zio_cache_copy(zio->id, slice, offset, buffer + read_length,
+		n) < 0) {
+		entry = zio_cache_new_entry(zio->id, slice,
+		    ZIO_SEBXA_SLICE_LENGTH);
+		if (entry == NULL)
+		    goto failed;
+		if (zio_copy_stored_slice(zio, slice, entry->buffer,
+		    ZIO_SEBXA_SLICE_LENGTH) < 0) {
+		    slice_index = (location - zio->zio_start_location)
+			/ ZIO_SEBXA_SLICE_LENGTH;
+		    if (zio_uncompress_sebxa_slice(zio, slice_index,
+			entry->buffer) < 0)
 			goto failed;
-		    slice_location = zio->index_base
-			+ zio_uint4(temporary_buffer);
+		    zio_store_slice(zio, slice, entry->buffer,
+			ZIO_SEBXA_SLICE_LENGTH);
 		}
 
-		/*
-		 * Read a compressed slice from `zio->file' and uncompress it.
-		 */
-		if (zio_lseek_raw(zio, slice_location, SEEK_SET) < 0)
-		    goto failed;
-		if (zio_unzip_slice_sebxa(zio, cache_buffer) < 0)
-		    goto failed;
-
-		cache_zio_id = zio->id;
+		memcpy(buffer + read_length, entry->buffer + offset, n);
+		zio_cache_insert(entry);
+		entry = NULL;
+	    } else {
+		hit_count++;
 	    }
-
-	    /*
-	     * Copy data from `cache_buffer' to `buffer'.
-	     */
-	    n = ZIO_SEBXA_SLICE_LENGTH
-		- (zio->location % ZIO_SEBXA_SLICE_LENGTH);
-	    if (length - read_length < n)
-		n = length - read_length;
-	    if (zio->file_size - zio->location < n)
-		n = zio->file_size - zio->location;
-	    memcpy(buffer + read_length,
-		cache_buffer + (zio->location - cache_location), n);
 	    read_length += n;
-	    zio->location += n;
+	    location += n;
 	}
     }
 
   succeeded:
-    LOG(("out: zio_read_sebxa() = %ld", (long)read_length));
+    zio_count_cache_hits(zio, hit_count);
+    LOG(("out: zio_pread_sebxa() = %ld", (long)read_length));
     return read_length;
 
     /*
      * An error occurs...
      */
   failed:
-    LOG(("out: zio_read_sebxa() = %ld", (long)-1));
+    if (entry != NULL)
+	free(entry);
+    zio_count_cache_hits(zio, hit_count);
+    LOG(("out: zio_pread_sebxa() = %ld", (long)-1));
     return -1;
 }
 
 
 /*
- * Uncompress an ebzip'ped slice.
+ * Uncompress the `slice_index'th compressed slice of the `zio' file
+ * compressed with the S-EBXA compression format into `out_buffer'.
  *
  * If it succeeds, 0 is returned.  Otherwise, -1 is returned.
  */
 static int
-zio_unzip_slice_ebzip1(Zio *zio, char *out_buffer, size_t zipped_slice_size)
+zio_uncompress_sebxa_slice(Zio *zio, int slice_index, char *out_buffer)
 {
-    char in_buffer[ZIO_SIZE_PAGE];
-    z_stream stream;
-    size_t read_length;
+    char temporary_buffer[4];
+    off_t slice_location;
+    unsigned long long start_time;
+
+    /*
+     * Get buffer location and size.
+     */
+    if (slice_index == 0)
+	slice_location = zio->index_base;
+    else {
+	if (zio_pread_raw(zio, ((off_t) slice_index - 1) * 4
+	    + zio->index_location, temporary_buffer, 4) != 4)
+	    return -1;
+	slice_location = zio->index_base + zio_uint4(temporary_buffer);
+    }
+
+    /*
+     * Read a compressed slice from `zio->file' and uncompress it.
+     */
+    start_time = zio_clock();
+    if (zio_unzip_slice_sebxa(zio, slice_location, out_buffer) < 0)
+	return -1;
+    zio_count_slice(zio, zio_elapsed(start_time));
+
+    return 0;
+}
+
+
+/*
+ * Uncompress an ebzip'ped slice located at `location' in `zio->file'.
+ * Uncompressed data are put into `out_buffer'.  If `zipped_slice' is
+ * not NULL, it has the slice read from `zio->file' already.
+ *
+ * If it succeeds, 0 is returned.  Otherwise, -1 is returned.
+ */
+static int
+zio_unzip_slice_ebzip1(Zio *zio, off_t location, char *out_buffer,
+    size_t zipped_slice_size, const char *zipped_slice)
+{
+    Zio_Inflater *inflater;
+    z_stream *stream;
+    const char *in_buffer;
     int z_result;
 
-    LOG(("in: zio_unzip_slice_ebzip1(zio=%d, zipped_slice_size=%ld)",
-	(int)zio->id, (long)zipped_slice_size));
+    LOG(("in: zio_unzip_slice_ebzip1(zio=%d, location=%ld, \
+zipped_slice_size=%ld)",
+	(int)zio->id, (long)location, (long)zipped_slice_size));
+
+    if (zio->slice_size == zipped_slice_size) {
+	/*
+	 * The input slice is not compressed.
+	 * Read the target page in the slice.
+	 */
+	if (zipped_slice != NULL)
+	    memcpy(out_buffer, zipped_slice, zipped_slice_size);
+	else if (zio_pread_raw(zio, location, out_buffer, zipped_slice_size)
+	    != zipped_slice_size)
+	    goto failed;
+
+    } else {
+	/*
+	 * The input slice is compressed.
+	 * Read the whole slice at once (unless the file is mapped into
+	 * memory), and uncompress it.
+	 */
+	inflater = zio_get_inflater();
+	if (inflater == NULL)
+	    goto failed;
+	if (zipped_slice != NULL) {
+	    in_buffer = zipped_slice;
+	} else if (zio->map != NULL && location + zipped_slice_size
+	    <= (off_t) zio->map_length) {
+	    in_buffer = zio->map + location;
+	} else {
+	    if (zio_pread_raw(zio, location, inflater->in_buffer,
+		zipped_slice_size) != zipped_slice_size)
+		goto failed;
+	    in_buffer = inflater->in_buffer;
+	}
+
+	stream = &inflater->stream;
+	if (inflateReset(stream) != Z_OK)
+	    goto failed;
+	stream->next_in = (Bytef *) in_buffer;
+	stream->avail_in = zipped_slice_size;
+	stream->next_out = (Bytef *) out_buffer;
+	stream->avail_out = zio->slice_size;
+
+	z_result = inflate(stream, Z_SYNC_FLUSH);
+	if (z_result != Z_STREAM_END) {
+	    if (z_result != Z_OK && z_result != Z_BUF_ERROR)
+		goto failed;
+	    if (stream->total_out < zio->slice_size)
+		goto failed;
+	}
+    }
+
+    LOG(("out: zio_unzip_slice_ebzip1() = %d", 0));
+    return 0;
+
+    /*
+     * An error occurs...
+     */
+  failed:
+    LOG(("out: zio_unzip_slice_ebzip1() = %d", -1));
+    return -1;
+}
+
+
+/*
+ * Uncompress an ebzip2'ped slice located at `location' in `zio->file'.
+ * Uncompressed data are put into `out_buffer'.  If `zipped_slice' is
+ * not NULL, it has the slice read from `zio->file' already.
+ *
+ * If it succeeds, 0 is returned.  Otherwise, -1 is returned.
+ */
+static int
+zio_unzip_slice_ebzip2(Zio *zio, off_t location, char *out_buffer,
+    size_t zipped_slice_size, const char *zipped_slice)
+{
+#ifdef HAVE_ZSTD
+    Zio_Inflater *inflater;
+    const char *in_buffer;
+    size_t result;
+#endif
+
+    LOG(("in: zio_unzip_slice_ebzip2(zio=%d, location=%ld, \
+zipped_slice_size=%ld)",
+	(int)zio->id, (long)location, (long)zipped_slice_size));
 
+#ifdef HAVE_ZSTD
     if (zio->slice_size == zipped_slice_size) {
 	/*
 	 * The input slice is not compressed.
 	 * Read the target page in the slice.
 	 */
-	if (zio_read_raw(zio, out_buffer, zipped_slice_size) != zipped_slice_size)
+	if (zipped_slice != NULL)
+	    memcpy(out_buffer, zipped_slice, zipped_slice_size);
+	else if (zio_pread_raw(zio, location, out_buffer, zipped_slice_size)
+	    != zipped_slice_size)
 	    goto failed;
 
     } else {
 	/*
 	 * The input slice is compressed.
-	 * Read and uncompress the target page in the slice.
+	 * Read the whole slice at once (unless the file is mapped into
+	 * memory), and uncompress it with the dictionary of the file.
 	 */
-	stream.zalloc = NULL;
-	stream.zfree = NULL;
-	stream.opaque = NULL;
+	inflater = zio_get_inflater();
+	if (inflater == NULL)
+	    goto failed;
+	if (inflater->zstd_context == NULL) {
+	    inflater->zstd_context = ZSTD_createDCtx();
+	    if (inflater->zstd_context == NULL)
+		goto failed;
+	}
+	if (zipped_slice != NULL) {
+	    in_buffer = zipped_slice;
+	} else if (zio->map != NULL && location + zipped_slice_size
+	    <= (off_t) zio->map_length) {
+	    in_buffer = zio->map + location;
+	} else {
+	    if (zio_pread_raw(zio, location, inflater->in_buffer,
+		zipped_slice_size) != zipped_slice_size)
+		goto failed;
+	    in_buffer = inflater->in_buffer;
+	}
+
+	if (zio->dictionary != NULL) {
+	    result = ZSTD_decompress_usingDDict(inflater->zstd_context,
+		out_buffer, zio->slice_size, in_buffer, zipped_slice_size,
+		(const ZSTD_DDict *) zio->dictionary);
+	} else {
+	    result = ZSTD_decompressDCtx(inflater->zstd_context,
+		out_buffer, zio->slice_size, in_buffer, zipped_slice_size);
+	}
+	if (ZSTD_isError(result) || result != zio->slice_size)
+	    goto failed;
+    }
+
+    LOG(("out: zio_unzip_slice_ebzip2() = %d", 0));
+    return 0;
+
+    /*
+     * An error occurs...
+     */
+  failed:
+#endif
+    LOG(("out: zio_unzip_slice_ebzip2() = %d", -1));
+    return -1;
+}
+
+
+/*
+ * Get the inflater of the current thread.  It is allocated at the
+ * first call in each thread.
+ */
+static Zio_Inflater *
+zio_get_inflater(void)
+{
+    Zio_Inflater *inflater;
+
+#ifdef ENABLE_PTHREAD
+    pthread_once(&inflater_key_once, zio_create_inflater_key);
+    inflater = (Zio_Inflater *) pthread_getspecific(inflater_key);
+#else
+    inflater = thread_inflater;
+#endif
+    if (inflater != NULL)
+	return inflater;
+
+    inflater = (Zio_Inflater *) malloc(sizeof(Zio_Inflater));
+    if (inflater == NULL)
+	return NULL;
+    inflater->stream.zalloc = NULL;
+    inflater->stream.zfree = NULL;
+    inflater->stream.opaque = NULL;
+    inflater->stream.next_in = NULL;
+    inflater->stream.avail_in = 0;
+    if (inflateInit(&inflater->stream) != Z_OK) {
+	free(inflater);
+	return NULL;
+    }
+#ifdef HAVE_ZSTD
+    inflater->zstd_context = NULL;
+#endif
+#ifdef ZIO_USE_IO_URING
+    inflater->ring = NULL;
+#endif
+
+#ifdef ENABLE_PTHREAD
+    if (pthread_setspecific(inflater_key, inflater) != 0) {
+	zio_destroy_inflater(inflater);
+	return NULL;
+    }
+#else
+    thread_inflater = inflater;
+#endif
+
+    return inflater;
+}
+
+
+/*
+ * Free the inflater of the current thread, if it has been allocated.
+ * (Inflaters of other threads are freed when the threads exit.)
+ */
+static void
+zio_release_inflater(void)
+{
+    Zio_Inflater *inflater;
+
+#ifdef ENABLE_PTHREAD
+    pthread_once(&inflater_key_once, zio_create_inflater_key);
+    inflater = (Zio_Inflater *) pthread_getspecific(inflater_key);
+    pthread_setspecific(inflater_key, NULL);
+#else
+    inflater = thread_inflater;
+    thread_inflater = NULL;
+#endif
+    if (inflater != NULL)
+	zio_destroy_inflater(inflater);
+}
+
+
+#ifdef ENABLE_PTHREAD
+/*
+ * Create the key of per-thread inflaters.
+ */
+static void
+zio_create_inflater_key(void)
+{
+    pthread_key_create(&inflater_key, zio_destroy_inflater);
+}
+#endif
 
-	if (inflateInit(&stream) != Z_OK)
-	    goto failed;
 
-	stream.next_in = (Bytef *) in_buffer;
-	stream.avail_in = 0;
-	stream.next_out = (Bytef *) out_buffer;
-	stream.avail_out = zio->slice_size;
+/*
+ * Free an inflater.
+ */
+static void
+zio_destroy_inflater(void *inflater)
+{
+    inflateEnd(&((Zio_Inflater *) inflater)->stream);
+#ifdef HAVE_ZSTD
+    if (((Zio_Inflater *) inflater)->zstd_context != NULL)
+	ZSTD_freeDCtx(((Zio_Inflater *) inflater)->zstd_context);
+#endif
+#ifdef ZIO_USE_IO_URING
+    if (((Zio_Inflater *) inflater)->ring != NULL)
+	zio_close_ring(((Zio_Inflater *) inflater)->ring);
+#endif
+    free(inflater);
+}
 
-	while (stream.total_out < zio->slice_size) {
-	    if (0 < stream.avail_in)
-		memmove(in_buffer, stream.next_in, stream.avail_in);
 
-	    if (zipped_slice_size - stream.total_in < ZIO_SIZE_PAGE) {
-		read_length = zipped_slice_size - stream.total_in
-		    - stream.avail_in;
-	    } else {
-	        read_length = ZIO_SIZE_PAGE - stream.avail_in;
-	    }
+/*
+ * Start reading a bit stream at `location' in `zio->file'.
+ */
+static void
+zio_open_bit_stream(Zio_Bit_Stream *stream, Zio *zio, off_t location)
+{
+    stream->zio = zio;
+    stream->location = location;
+    stream->buffer_p = stream->buffer;
+    stream->buffer_end = stream->buffer;
+    stream->bits = 0;
+    stream->bit_count = 0;
+    stream->is_eof = 0;
+}
 
-	    if (zio_read_raw(zio, in_buffer + stream.avail_in,
-		read_length) != read_length)
-		goto failed;
 
-	    stream.next_in = (Bytef *) in_buffer;
-	    stream.avail_in += read_length;
-	    stream.avail_out = zio->slice_size - stream.total_out;
+/*
+ * Append bytes to `stream->bits' until it holds more than 24 bits.
+ * If no data is left in the input buffer, read next chunk.
+ * (Bits are not appended at the end of file, or after a read error.)
+ */
+static void
+zio_fill_bit_stream(Zio_Bit_Stream *stream)
+{
+    ssize_t read_length;
 
-	    z_result = inflate(&stream, Z_SYNC_FLUSH);
-	    if (z_result == Z_STREAM_END) {
+    while (stream->bit_count <= 24) {
+	if (stream->buffer_end <= stream->buffer_p) {
+	    if (stream->is_eof)
+		break;
+	    if (stream->zio->map != NULL) {
+		/*
+		 * Take the rest of the mapped file as the input buffer.
+		 */
+		stream->is_eof = 1;
+		if ((off_t) stream->zio->map_length <= stream->location)
+		    break;
+		stream->buffer_p = (unsigned char *) stream->zio->map
+		    + stream->location;
+		stream->buffer_end = (unsigned char *) stream->zio->map
+		    + stream->zio->map_length;
+		stream->location = stream->zio->map_length;
+		continue;
+	    }
+	    read_length = zio_pread_raw(stream->zio, stream->location,
+		stream->buffer, ZIO_SIZE_PAGE);
+	    if (read_length <= 0) {
+		stream->is_eof = 1;
 		break;
-	    } else if (z_result != Z_OK && z_result != Z_BUF_ERROR) {
-		goto failed;
 	    }
+	    stream->location += read_length;
+	    stream->buffer_p = stream->buffer;
+	    stream->buffer_end = stream->buffer + read_length;
 	}
+	stream->bits = (stream->bits << 8) | *stream->buffer_p++;
+	stream->bit_count += 8;
+    }
+}
+
+
+/*
+ * Decode a huffman code in `stream', and return the leaf node.
+ * ZIO_HUFFMAN_TABLE_BITS bits are decoded at once with the lookup
+ * table.  If the code is longer than that, or the stream is near the
+ * end, the rest of the code is decoded bit by bit.
+ * It returns NULL if the stream is broken.
+ */
+static Zio_Huffman_Node *
+zio_decode_huffman(Zio_Bit_Stream *stream)
+{
+    Zio_Huffman_Entry *entry_p;
+    Zio_Huffman_Node *node_p;
 
-	inflateEnd(&stream);
+    if (stream->bit_count < ZIO_HUFFMAN_TABLE_BITS)
+	zio_fill_bit_stream(stream);
+
+    if (ZIO_HUFFMAN_TABLE_BITS <= stream->bit_count) {
+	entry_p = stream->zio->huffman_table
+	    + ((stream->bits >> (stream->bit_count - ZIO_HUFFMAN_TABLE_BITS))
+		& ((1 << ZIO_HUFFMAN_TABLE_BITS) - 1));
+	node_p = entry_p->node;
+	stream->bit_count -= entry_p->length;
+    } else {
+	node_p = stream->zio->huffman_root;
     }
 
-    LOG(("out: zio_unzip_slice_ebzip1() = %d", 0));
-    return 0;
+    while (node_p != NULL && node_p->type == ZIO_HUFFMAN_NODE_INTERMEDIATE) {
+	if (stream->bit_count == 0) {
+	    zio_fill_bit_stream(stream);
+	    if (stream->bit_count == 0)
+		return NULL;
+	}
+	stream->bit_count--;
+	if ((stream->bits >> stream->bit_count) & 0x01)
+	    node_p = node_p->left;
+	else
+	    node_p = node_p->right;
+    }
 
-    /*
-     * An error occurs...
-     */
-  failed:
-    LOG(("out: zio_unzip_slice_ebzip1() = %d", -1));
-    inflateEnd(&stream);
-    return -1;
+    return node_p;
 }
 
 
 /*
- * Uncompress an EPWING compressed slice.
- * The offset of `zio->file' must points to the beginning of the compressed
- * slice.  Uncompressed data are put into `out_buffer'.
+ * Uncompress an EPWING compressed slice located at `location' in
+ * `zio->file'.  Uncompressed data are put into `out_buffer'.
  *
  * If it succeeds, 0 is returned.  Otherwise, -1 is returned.
  */
 static int
-zio_unzip_slice_epwing(Zio *zio, char *out_buffer)
+zio_unzip_slice_epwing(Zio *zio, off_t location, char *out_buffer)
 {
     Zio_Huffman_Node *node_p;
-    int bit;
-    char in_buffer[ZIO_SIZE_PAGE];
-    unsigned char *in_buffer_p;
-    ssize_t in_read_length;
-    int in_bit_index;
+    Zio_Bit_Stream stream;
     unsigned char *out_buffer_p;
     size_t out_length;
 
-    LOG(("in: zio_unzip_slice_epwing(zio=%d)", (int)zio->id));
+    LOG(("in: zio_unzip_slice_epwing(zio=%d, location=%ld)", (int)zio->id,
+	(long)location));
 
-    in_buffer_p = (unsigned char *)in_buffer;
-    in_bit_index = 7;
-    in_read_length = 0;
+    zio_open_bit_stream(&stream, zio, location);
     out_buffer_p = (unsigned char *)out_buffer;
     out_length = 0;
 
@@ -1584,38 +5660,9 @@ zio_unzip_slice_epwing(Zio *zio, char *out_buffer)
 	/*
 	 * Descend the huffman tree until reached to the leaf node.
 	 */
-	node_p = zio->huffman_root;
-	while (node_p->type == ZIO_HUFFMAN_NODE_INTERMEDIATE) {
-
-	    /*
-	     * If no data is left in the input buffer, read next chunk.
-	     */
-	    if ((unsigned char *)in_buffer + in_read_length <= in_buffer_p) {
-		in_read_length = zio_read_raw(zio, in_buffer, ZIO_SIZE_PAGE);
-		if (in_read_length <= 0)
-		    goto failed;
-		in_buffer_p = (unsigned char *)in_buffer;
-	    }
-
-	    /*
-	     * Step to a child.
-	     */
-	    bit = (*in_buffer_p >> in_bit_index) & 0x01;
-
-	    if (bit == 1)
-		node_p = node_p->left;
-	    else
-		node_p = node_p->right;
-	    if (node_p == NULL)
-		goto failed;
-
-	    if (0 < in_bit_index)
-		in_bit_index--;
-	    else {
-		in_bit_index = 7;
-		in_buffer_p++;
-	    }
-	}
+	node_p = zio_decode_huffman(&stream);
+	if (node_p == NULL)
+	    goto failed;
 
 	if (node_p->type == ZIO_HUFFMAN_NODE_EOF) {
 	    /*
@@ -1668,45 +5715,42 @@ zio_unzip_slice_epwing(Zio *zio, char *out_buffer)
 
 
 /*
- * Uncompress an EPWING V6 compressed slice.
- * The offset of `zio->file' must points to the beginning of the compressed
- * slice.  Uncompressed data are put into `out_buffer'.
+ * Uncompress an EPWING V6 compressed slice located at `location' in
+ * `zio->file'.  Uncompressed data are put into `out_buffer'.
  *
  * If it succeeds, 0 is returned.  Otherwise, -1 is returned.
  */
 static int
-zio_unzip_slice_epwing6(Zio *zio, char *out_buffer)
+zio_unzip_slice_epwing6(Zio *zio, off_t location, char *out_buffer)
 {
     Zio_Huffman_Node *node_p;
-    int bit;
-    char in_buffer[ZIO_SIZE_PAGE];
-    unsigned char *in_buffer_p;
-    ssize_t in_read_length;
-    int in_bit_index;
+    Zio_Bit_Stream stream;
+    char type_buffer[1];
     unsigned char *out_buffer_p;
     size_t out_length;
     int compression_type;
 
-    LOG(("in: zio_unzip_slice_epwing6(zio=%d)", (int)zio->id));
+    LOG(("in: zio_unzip_slice_epwing6(zio=%d, location=%ld)", (int)zio->id,
+	(long)location));
 
-    in_buffer_p = (unsigned char *)in_buffer;
-    in_bit_index = 7;
-    in_read_length = 0;
     out_buffer_p = (unsigned char *)out_buffer;
     out_length = 0;
 
     /*
      * Get compression type.
      */
-    if (zio_read_raw(zio, in_buffer, 1) != 1)
+    if (zio_pread_raw(zio, location, type_buffer, 1) != 1)
 	goto failed;
-    compression_type = zio_uint1(in_buffer);
+    compression_type = zio_uint1(type_buffer);
+    location++;
+    zio_open_bit_stream(&stream, zio, location);
 
     /*
      * If compression type is not 0, this page is not compressed.
      */
     if (compression_type != 0) {
-	if (zio_read_raw(zio, out_buffer, ZIO_SIZE_PAGE) != ZIO_SIZE_PAGE)
+	if (zio_pread_raw(zio, location, out_buffer, ZIO_SIZE_PAGE)
+	    != ZIO_SIZE_PAGE)
 	    goto failed;
 	goto succeeded;
     }
@@ -1715,38 +5759,9 @@ zio_unzip_slice_epwing6(Zio *zio, char *out_buffer)
 	/*
 	 * Descend the huffman tree until reached to the leaf node.
 	 */
-	node_p = zio->huffman_root;
-	while (node_p->type == ZIO_HUFFMAN_NODE_INTERMEDIATE) {
-
-	    /*
-	     * If no data is left in the input buffer, read next chunk.
-	     */
-	    if ((unsigned char *)in_buffer + in_read_length <= in_buffer_p) {
-		in_read_length = zio_read_raw(zio, in_buffer, ZIO_SIZE_PAGE);
-		if (in_read_length <= 0)
-		    goto failed;
-		in_buffer_p = (unsigned char *)in_buffer;
-	    }
-
-	    /*
-	     * Step to a child.
-	     */
-	    bit = (*in_buffer_p >> in_bit_index) & 0x01;
-
-	    if (bit == 1)
-		node_p = node_p->left;
-	    else
-		node_p = node_p->right;
-	    if (node_p == NULL)
-		goto failed;
-
-	    if (0 < in_bit_index)
-		in_bit_index--;
-	    else {
-		in_bit_index = 7;
-		in_buffer_p++;
-	    }
-	}
+	node_p = zio_decode_huffman(&stream);
+	if (node_p == NULL)
+	    goto failed;
 
 	if (node_p->type == ZIO_HUFFMAN_NODE_EOF) {
 	    /*
@@ -1816,18 +5831,17 @@ zio_unzip_slice_epwing6(Zio *zio, char *out_buffer)
 }
 
 /*
- * Uncompress an S-EBXA compressed slice.
- * The offset of `zio->file' must points to the beginning of the compressed
- * slice.  Uncompressed data are put into `out_buffer'.
+ * Uncompress an S-EBXA compressed slice located at `location' in
+ * `zio->file'.  Uncompressed data are put into `out_buffer'.
  *
  * If it succeeds, 0 is returned.  Otherwise, -1 is returned.
  */
 static int
-zio_unzip_slice_sebxa(Zio *zio, char *out_buffer)
+zio_unzip_slice_sebxa(Zio *zio, off_t location, char *out_buffer)
 {
     char in_buffer[ZIO_SEBXA_SLICE_LENGTH];
     unsigned char *in_buffer_p;
-    size_t in_read_rest;
+    ssize_t in_read_rest;
     unsigned char *out_buffer_p;
     size_t out_length;
     int compression_flags[8];
@@ -1835,7 +5849,8 @@ zio_unzip_slice_sebxa(Zio *zio, char *out_buffer)
     int copy_length;
     int i, j;
 
-    LOG(("in: zio_unzip_slice_sebxa(zio=%d)", (int)zio->id));
+    LOG(("in: zio_unzip_slice_sebxa(zio=%d, location=%ld)", (int)zio->id,
+	(long)location));
 
     in_buffer_p = (unsigned char *)in_buffer;
     in_read_rest = 0;
@@ -1847,10 +5862,11 @@ zio_unzip_slice_sebxa(Zio *zio, char *out_buffer)
 	 * If no data is left in the input buffer, read next chunk.
 	 */
 	if (in_read_rest <= 0) {
-	    in_read_rest = zio_read_raw(zio, in_buffer,
+	    in_read_rest = zio_pread_raw(zio, location, in_buffer,
 		ZIO_SEBXA_SLICE_LENGTH);
 	    if (in_read_rest <= 0)
 		goto failed;
+	    location += in_read_rest;
 	    in_buffer_p = (unsigned char *)in_buffer;
 	}
 
@@ -1964,6 +5980,12 @@ zio_unzip_slice_sebxa(Zio *zio, char *out_buffer)
 static int
 zio_open_raw(Zio *zio, const char *file_name)
 {
+    struct stat st;
+#ifdef HAVE_MMAP
+    void *map;
+    int flag;
+#endif
+
 #ifdef ENABLE_EBNET
     if (is_ebnet_url(file_name)) {
 	zio->is_ebnet = 1;
@@ -1976,6 +5998,36 @@ zio_open_raw(Zio *zio, const char *file_name)
     zio->file = open(file_name, O_RDONLY | O_BINARY);
 #endif
 
+    /*
+     * Get the identity of the file, and map the file into memory, if
+     * requested.  (It is not an error that the file cannot be mapped.)
+     */
+    zio->file_device = 0;
+    zio->file_inode = 0;
+    zio->file_mtime = 0;
+    zio->map = NULL;
+    zio->map_length = 0;
+    if (0 <= zio->file && !zio->is_ebnet && fstat(zio->file, &st) == 0) {
+	zio->file_device = st.st_dev;
+	zio->file_inode = st.st_ino;
+	zio->file_mtime = st.st_mtime;
+#ifdef HAVE_MMAP
+	pthread_mutex_lock(&zio_mutex);
+	flag = mmap_mode;
+	pthread_mutex_unlock(&zio_mutex);
+
+	if (flag && 0 < st.st_size
+	    && (off_t)(size_t) st.st_size == st.st_size) {
+	    map = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_SHARED,
+		zio->file, 0);
+	    if (map != MAP_FAILED) {
+		zio->map = (char *) map;
+		zio->map_length = (size_t) st.st_size;
+	    }
+	}
+#endif
+    }
+
     return zio->file;
 }
 
@@ -1997,6 +6049,13 @@ zio_close_raw(Zio *zio)
 #else
 	close(zio->file);
 #endif
+
+#ifdef HAVE_MMAP
+    if (zio->map != NULL)
+	munmap(zio->map, zio->map_length);
+#endif
+    zio->map = NULL;
+    zio->map_length = 0;
 }
 
 
@@ -2036,9 +6095,14 @@ zio_read_raw(Zio *zio, void *buffer, size_t length)
 {
     char *buffer_p = buffer;
     ssize_t result;
+    unsigned long long start_time;
+    int read_count;
 
     LOG(("in: zio_read_raw(file=%d, length=%ld)", zio->file, (long)length));
 
+    start_time = zio_clock();
+    read_count = 0;
+
     if (zio->is_ebnet) {
 	/*
 	 * Read from a remote server.
@@ -2048,6 +6112,7 @@ zio_read_raw(Zio *zio, void *buffer, size_t length)
 #else
 	result = -1;
 #endif
+	read_count++;
     } else {
 	/*
 	 * Read from a local file.
@@ -2058,6 +6123,7 @@ zio_read_raw(Zio *zio, void *buffer, size_t length)
 	while (0 < rest_length) {
 	    errno = 0;
 	    n = read(zio->file, buffer_p, rest_length);
+	    read_count++;
 	    if (n < 0) {
 		if (errno == EINTR)
 		    continue;
@@ -2073,6 +6139,9 @@ zio_read_raw(Zio *zio, void *buffer, size_t length)
 	result = length - rest_length;
     }
 
+    if (0 < result)
+	zio_count_raw_read(zio, result, read_count, zio_elapsed(start_time));
+
     LOG(("out: zio_read_raw() = %ld", (long)result));
     return result;
 
@@ -2085,3 +6154,400 @@ zio_read_raw(Zio *zio, void *buffer, size_t length)
 }
 
 
+/*
+ * Low-level positional read function.
+ *
+ * It reads data at `location' without changing the offset of the file
+ * descriptor, so that threads can share `zio->file'.  If `zio->file'
+ * is socket, or pread() is not available, it emulates the positional
+ * read with seek and read under the lock of `zio_mutex'.
+ */
+static ssize_t
+zio_pread_raw(Zio *zio, off_t location, void *buffer, size_t length)
+{
+    char *buffer_p = buffer;
+    ssize_t result;
+
+    LOG(("in: zio_pread_raw(file=%d, location=%ld, length=%ld)", zio->file,
+	(long)location, (long)length));
+
+    if (zio->map != NULL) {
+	if (location < 0)
+	    goto failed;
+	if ((off_t) zio->map_length <= location)
+	    result = 0;
+	else if (zio->map_length - location < length)
+	    result = zio->map_length - location;
+	else
+	    result = length;
+	memcpy(buffer, zio->map + location, result);
+	zio_count_raw_read(zio, result, 0, 0);
+	goto succeeded;
+    }
+
+#ifdef HAVE_PREAD
+    if (!zio->is_ebnet) {
+	ssize_t rest_length = length;
+	ssize_t n;
+	unsigned long long start_time;
+	int read_count = 0;
+
+	start_time = zio_clock();
+	while (0 < rest_length) {
+	    errno = 0;
+	    n = pread(zio->file, buffer_p, rest_length, location);
+	    read_count++;
+	    if (n < 0) {
+		if (errno == EINTR)
+		    continue;
+		goto failed;
+	    } else if (n == 0)
+		break;
+	    else {
+		rest_length -= n;
+		buffer_p += n;
+		location += n;
+	    }
+	}
+
+	result = length - rest_length;
+	zio_count_raw_read(zio, result, read_count, zio_elapsed(start_time));
+	goto succeeded;
+    }
+#endif
+
+    pthread_mutex_lock(&zio_mutex);
+    if (zio_lseek_raw(zio, location, SEEK_SET) < 0) {
+	pthread_mutex_unlock(&zio_mutex);
+	goto failed;
+    }
+    result = zio_read_raw(zio, buffer, length);
+    pthread_mutex_unlock(&zio_mutex);
+
+  succeeded:
+    LOG(("out: zio_pread_raw() = %ld", (long)result));
+    return result;
+
+    /*
+     * An error occurs...
+     */
+  failed:
+    LOG(("out: zio_pread_raw() = %ld", (long)-1));
+    return -1;
+}
+
+
+/*
+ * Read the raw reads in `requests' from `zio->file'.  If io_uring is
+ * available, they are submitted by a system call, and the library
+ * waits for all of them.  Otherwise, they are read one by one.
+ * `result' of each request is set.
+ *
+ * If all requests are read entirely, 0 is returned.  Otherwise, -1 is
+ * returned.
+ */
+static int
+zio_pread_raw_batch(Zio *zio, Zio_Read_Request *requests, int request_count)
+{
+    Zio_Read_Request *request;
+    ssize_t n;
+    int submitted_count = 0;
+    int failed = 0;
+    int i;
+
+    LOG(("in: zio_pread_raw_batch(file=%d, request_count=%d)", zio->file,
+	request_count));
+
+#ifdef ZIO_USE_IO_URING
+    if (1 < request_count && zio->map == NULL && !zio->is_ebnet) {
+	Zio_Ring *ring;
+	int count;
+
+	ring = zio_get_ring();
+	while (ring != NULL && submitted_count < request_count) {
+	    count = request_count - submitted_count;
+	    if (ring->entry_count < count)
+		count = ring->entry_count;
+	    if (zio_submit_ring(ring, zio, requests + submitted_count, count)
+		< 0)
+		break;
+	    submitted_count += count;
+	}
+    }
+#endif
+
+    /*
+     * Read the requests not submitted, and the rest of short reads.
+     */
+    for (i = 0, request = requests; i < request_count; i++, request++) {
+	if (submitted_count <= i || request->result < 0)
+	    request->result = 0;
+	if (request->result < request->length) {
+	    n = zio_pread_raw(zio, request->location + request->result,
+		request->buffer + request->result,
+		request->length - request->result);
+	    if (n < 0)
+		request->result = -1;
+	    else
+		request->result += n;
+	}
+	if (request->result != request->length)
+	    failed = 1;
+    }
+
+    if (failed) {
+	LOG(("out: zio_pread_raw_batch() = %d", -1));
+	return -1;
+    }
+
+    LOG(("out: zio_pread_raw_batch() = %d", 0));
+    return 0;
+}
+
+
+#ifdef ZIO_USE_IO_URING
+/*
+ * Get the io_uring instance of the current thread.  It is set up at
+ * the first call in each thread.  If io_uring is not available, NULL
+ * is returned.
+ */
+static Zio_Ring *
+zio_get_ring(void)
+{
+    Zio_Inflater *inflater;
+    int unavailable;
+
+    inflater = zio_get_inflater();
+    if (inflater == NULL)
+	return NULL;
+    if (inflater->ring != NULL)
+	return inflater->ring->broken ? NULL : inflater->ring;
+
+    pthread_mutex_lock(&zio_mutex);
+    unavailable = ring_unavailable;
+    pthread_mutex_unlock(&zio_mutex);
+    if (unavailable)
+	return NULL;
+
+    inflater->ring = zio_open_ring();
+    if (inflater->ring == NULL) {
+	pthread_mutex_lock(&zio_mutex);
+	ring_unavailable = 1;
+	pthread_mutex_unlock(&zio_mutex);
+    }
+
+    return inflater->ring;
+}
+
+
+/*
+ * Set up an io_uring instance, and map its queues into memory.
+ *
+ * If it succeeds, the instance is returned.  Otherwise, NULL is
+ * returned.
+ */
+static Zio_Ring *
+zio_open_ring(void)
+{
+    struct io_uring_params parameters;
+    Zio_Ring *ring;
+
+    LOG(("in: zio_open_ring()"));
+
+    ring = (Zio_Ring *) malloc(sizeof(Zio_Ring));
+    if (ring == NULL)
+	goto failed;
+    ring->sq_map = MAP_FAILED;
+    ring->cq_map = MAP_FAILED;
+    ring->sqes = MAP_FAILED;
+    ring->broken = 0;
+
+    memset(&parameters, 0, sizeof(parameters));
+    ring->file = syscall(__NR_io_uring_setup, ZIO_RING_ENTRIES, &parameters);
+    if (ring->file < 0)
+	goto failed;
+    ring->entry_count = parameters.sq_entries;
+
+    ring->sq_map_length = parameters.sq_off.array
+	+ parameters.sq_entries * sizeof(unsigned int);
+    ring->sq_map = mmap(NULL, ring->sq_map_length, PROT_READ | PROT_WRITE,
+	MAP_SHARED, ring->file, IORING_OFF_SQ_RING);
+    if (ring->sq_map == MAP_FAILED)
+	goto failed;
+
+    ring->cq_map_length = parameters.cq_off.cqes
+	+ parameters.cq_entries * sizeof(struct io_uring_cqe);
+    ring->cq_map = mmap(NULL, ring->cq_map_length, PROT_READ | PROT_WRITE,
+	MAP_SHARED, ring->file, IORING_OFF_CQ_RING);
+    if (ring->cq_map == MAP_FAILED)
+	goto failed;
+
+    ring->sqes_length = parameters.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = (struct io_uring_sqe *) mmap(NULL, ring->sqes_length,
+	PROT_READ | PROT_WRITE, MAP_SHARED, ring->file, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED)
+	goto failed;
+
+    ring->sq_head = (unsigned int *) ((char *) ring->sq_map
+	+ parameters.sq_off.head);
+    ring->sq_tail = (unsigned int *) ((char *) ring->sq_map
+	+ parameters.sq_off.tail);
+    ring->sq_mask = (unsigned int *) ((char *) ring->sq_map
+	+ parameters.sq_off.ring_mask);
+    ring->sq_array = (unsigned int *) ((char *) ring->sq_map
+	+ parameters.sq_off.array);
+    ring->cq_head = (unsigned int *) ((char *) ring->cq_map
+	+ parameters.cq_off.head);
+    ring->cq_tail = (unsigned int *) ((char *) ring->cq_map
+	+ parameters.cq_off.tail);
+    ring->cq_mask = (unsigned int *) ((char *) ring->cq_map
+	+ parameters.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *) ((char *) ring->cq_map
+	+ parameters.cq_off.cqes);
+
+    LOG(("out: zio_open_ring() = %d", ring->file));
+    return ring;
+
+    /*
+     * An error occurs...
+     */
+  failed:
+    if (ring != NULL)
+	zio_close_ring(ring);
+    LOG(("out: zio_open_ring() = %d", -1));
+    return NULL;
+}
+
+
+/*
+ * Unmap the queues of `ring', and close it.
+ */
+static void
+zio_close_ring(Zio_Ring *ring)
+{
+    if (ring->sqes != MAP_FAILED)
+	munmap((void *) ring->sqes, ring->sqes_length);
+    if (ring->cq_map != MAP_FAILED)
+	munmap(ring->cq_map, ring->cq_map_length);
+    if (ring->sq_map != MAP_FAILED)
+	munmap(ring->sq_map, ring->sq_map_length);
+    if (0 <= ring->file)
+	close(ring->file);
+    free(ring);
+}
+
+
+/*
+ * Submit the raw reads in `requests' to `ring' by a system call, and
+ * wait for all of them.  `request_count' must not exceed the number of
+ * entries of the submission queue.  `result' of each request is set
+ * to the number of bytes read, or a negative value on an error.
+ *
+ * If it succeeds, 0 is returned.  If the requests cannot be submitted,
+ * or io_uring_enter() keeps failing, -1 is returned.  In that case, the
+ * caller must read all the requests again by itself.  If some of them
+ * are still in flight, `ring' is marked broken and is never used again.
+ */
+static int
+zio_submit_ring(Zio_Ring *ring, Zio *zio, Zio_Read_Request *requests,
+    int request_count)
+{
+    struct io_uring_sqe *sqe;
+    struct io_uring_cqe *cqe;
+    unsigned int sq_tail;
+    unsigned int cq_head;
+    unsigned int cq_tail;
+    unsigned int index;
+    size_t read_length = 0;
+    int submit_count;
+    int complete_count = 0;
+    int enter_count = 0;
+    int target_count;
+    int retry_count = 0;
+    int failed = 0;
+    int n;
+    int i;
+    unsigned long long start_time;
+
+    start_time = zio_clock();
+
+    /*
+     * Put the requests into the submission queue.
+     */
+    sq_tail = *ring->sq_tail;
+    for (i = 0; i < request_count; i++) {
+	index = sq_tail & *ring->sq_mask;
+	sqe = ring->sqes + index;
+	memset(sqe, 0, sizeof(struct io_uring_sqe));
+	sqe->opcode = IORING_OP_READ;
+	sqe->fd = zio->file;
+	sqe->off = requests[i].location;
+	sqe->addr = (unsigned long) requests[i].buffer;
+	sqe->len = requests[i].length;
+	sqe->user_data = i;
+	ring->sq_array[index] = index;
+	requests[i].result = -1;
+	sq_tail++;
+    }
+    __atomic_store_n(ring->sq_tail, sq_tail, __ATOMIC_RELEASE);
+
+    /*
+     * Submit them, and reap their completions.
+     */
+    submit_count = request_count;
+    target_count = request_count;
+    while (complete_count < target_count) {
+	n = syscall(__NR_io_uring_enter, ring->file, submit_count,
+	    target_count - complete_count, IORING_ENTER_GETEVENTS, NULL, 0);
+	enter_count++;
+	if (n < 0) {
+	    if ((errno == EINTR || errno == EAGAIN || errno == EBUSY)
+		&& retry_count++ < ZIO_MAX_RING_RETRIES)
+		continue;
+	    /*
+	     * Take back the requests not submitted yet.
+	     */
+	    sq_tail -= submit_count;
+	    __atomic_store_n(ring->sq_tail, sq_tail, __ATOMIC_RELEASE);
+	    target_count -= submit_count;
+	    submit_count = 0;
+	    if (complete_count == target_count)
+		return -1;
+	    if (failed && ZIO_MAX_RING_RETRIES <= retry_count++) {
+		/*
+		 * Give up the requests in flight.  The kernel may
+		 * complete them later, so that `ring' is never used
+		 * again.
+		 */
+		ring->broken = 1;
+		return -1;
+	    }
+	    /*
+	     * Some requests are in flight.  Wait for them.
+	     */
+	    failed = 1;
+	    continue;
+	}
+	submit_count -= n;
+
+	cq_head = *ring->cq_head;
+	cq_tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+	while (cq_head != cq_tail) {
+	    cqe = ring->cqes + (cq_head & *ring->cq_mask);
+	    if (cqe->user_data < (unsigned int) request_count) {
+		requests[cqe->user_data].result = cqe->res;
+		if (0 < cqe->res)
+		    read_length += cqe->res;
+		complete_count++;
+	    }
+	    cq_head++;
+	}
+	__atomic_store_n(ring->cq_head, cq_head, __ATOMIC_RELEASE);
+    }
+
+    zio_count_raw_read(zio, read_length, enter_count,
+	zio_elapsed(start_time));
+
+    return failed ? -1 : 0;
+}
+#endif
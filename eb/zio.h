@@ -53,6 +53,22 @@ extern "C" {
  */
 #define ZIO_MAX_EBZIP_LEVEL		5
 
+/*
+ * Maximum length of a dictionary in an ebzip2 compression file.
+ */
+#define ZIO_MAX_EBZIP2_DICTIONARY_LENGTH	(1024 * 1024)
+
+/*
+ * Default number of slices read ahead.  (See zio_set_read_ahead().)
+ */
+#define ZIO_DEFAULT_READ_AHEAD_COUNT	8
+
+/*
+ * Default total size of files materialized in memory, in bytes.
+ * (See zio_materialize().)
+ */
+#define ZIO_DEFAULT_MATERIALIZE_BUDGET	(256 * 1024 * 1024)
+
 /*
  * Huffman node types.
  */
@@ -70,6 +86,7 @@ extern "C" {
 #define ZIO_EPWING			2
 #define ZIO_EPWING6			3
 #define ZIO_SEBXA			4
+#define ZIO_EBZIP2			5
 #define ZIO_INVALID        		-1
 #define ZIO_REOPEN			-2
 
@@ -110,6 +127,67 @@ struct Zio_Huffman_Node_Struct {
     Zio_Huffman_Node *right;
 };
 
+/*
+ * An entry of the Huffman lookup table.  `node' is the node reached
+ * by descending the tree with the leading `length' bits of the index
+ * of the entry.  It is an intermediate node if the code is longer
+ * than the index.
+ */
+typedef struct Zio_Huffman_Entry_Struct Zio_Huffman_Entry;
+
+struct Zio_Huffman_Entry_Struct {
+    Zio_Huffman_Node *node;
+    int length;
+};
+
+/*
+ * I/O statistics of a Zio, or of all Zio objects.
+ */
+typedef struct Zio_Stats_Struct Zio_Stats;
+
+struct Zio_Stats_Struct {
+    /*
+     * The number of bytes read from files, the number of system calls
+     * to read them, and the time spent in reading, in nanoseconds.
+     */
+    unsigned long long raw_read_bytes;
+    unsigned long long raw_read_count;
+    unsigned long long raw_read_nanoseconds;
+
+    /*
+     * The number of slices uncompressed, for each compression type.
+     */
+    unsigned long long ebzip_slice_count;
+    unsigned long long ebzip2_slice_count;
+    unsigned long long epwing_slice_count;
+    unsigned long long epwing6_slice_count;
+    unsigned long long sebxa_slice_count;
+
+    /*
+     * Time spent in uncompressing slices, in nanoseconds.
+     * (It includes the time to read compressed data.)
+     */
+    unsigned long long decode_nanoseconds;
+
+    /*
+     * The number of hits and misses of the slice cache.
+     */
+    unsigned long long cache_hit_count;
+    unsigned long long cache_miss_count;
+
+    /*
+     * The number of slices copied from the shared slice cache.
+     * (They are counted as misses of the slice cache.)
+     */
+    unsigned long long shared_cache_hit_count;
+
+    /*
+     * The number of slices read from the disk cache.
+     * (They are counted as misses of the slice cache.)
+     */
+    unsigned long long disk_cache_hit_count;
+};
+
 /*
  * Compression information of a book.
  */
@@ -122,7 +200,7 @@ struct Zio_Struct {
     int id;
 
     /*
-     * Zio type. (PLAIN, EBZIP, EPWING, EPWING6 or SEBXA)
+     * Zio type. (PLAIN, EBZIP, EBZIP2, EPWING, EPWING6 or SEBXA)
      */
     Zio_Code code;
 
@@ -166,6 +244,12 @@ struct Zio_Struct {
      */
     time_t mtime;
 
+    /*
+     * Dictionary to uncompress slices.  It is a `ZSTD_DDict', or NULL
+     * if the file has no dictionary. (EBZIP2 compression only)
+     */
+    void *dictionary;
+
     /*
      * Location of an index table. (EPWING and S-EBXA compression only)
      */
@@ -176,6 +260,14 @@ struct Zio_Struct {
      */
     size_t index_length;
 
+    /*
+     * In-memory copy of an index table, and its length in bytes.
+     * `index_table' is NULL if the table is not loaded.
+     * (EBZIP and EPWING compression only)
+     */
+    char *index_table;
+    size_t index_table_length;
+
     /*
      * Location of a frequency table. (EPWING compression only)
      */
@@ -196,6 +288,11 @@ struct Zio_Struct {
      */
     Zio_Huffman_Node *huffman_root;
 
+    /*
+     * Lookup table to decode a Huffman code. (EPWING compression only)
+     */
+    Zio_Huffman_Entry *huffman_table;
+
     /*
      * Region of compressed pages. (S-EBXA compression only)
      */
@@ -211,6 +308,47 @@ struct Zio_Struct {
      * ebnet mode flag.
      */
     int is_ebnet;
+
+    /*
+     * Identity of the file: device, i-node and mtime.
+     * They are 0 if the identity is unknown (e.g. an ebnet file).
+     */
+    dev_t file_device;
+    ino_t file_inode;
+    time_t file_mtime;
+
+    /*
+     * Memory mapping of the file, and its length.
+     * `map' is NULL if the file is not mapped.
+     */
+    char *map;
+    size_t map_length;
+
+    /*
+     * The number of slices to read ahead, the end of the last read,
+     * and the location up to which slices have been requested to read
+     * ahead.
+     */
+    int read_ahead_count;
+    off_t read_ahead_last;
+    off_t read_ahead_location;
+
+    /*
+     * Uncompressed contents of the whole file in memory.
+     * It is NULL if zio_materialize() has not been called.
+     */
+    void *materialized;
+
+    /*
+     * The disk cache of uncompressed slices.
+     * It is NULL if the disk cache is not used.
+     */
+    void *disk_cache;
+
+    /*
+     * I/O statistics.
+     */
+    Zio_Stats stats;
 };
 
 /*
@@ -218,7 +356,14 @@ struct Zio_Struct {
  */
 /* zio.c */
 int zio_initialize_library(void);
+int zio_initialize_library2(size_t cache_size);
 void zio_finalize_library(void);
+void zio_cache_statistics(unsigned long *hit_count,
+    unsigned long *miss_count);
+void zio_set_index_cache_size(size_t cache_size);
+int zio_attach_shared_cache(const char *path, size_t size);
+void zio_detach_shared_cache(void);
+int zio_set_disk_cache_directory(const char *directory);
 void zio_initialize(Zio *zio);
 void zio_finalize(Zio *zio);
 int zio_set_sebxa_mode(Zio *zio, off_t index_location, off_t index_base,
@@ -229,6 +374,15 @@ int zio_file(Zio *zio);
 Zio_Code zio_mode(Zio *zio);
 off_t zio_lseek(Zio *zio, off_t offset, int whence);
 ssize_t zio_read(Zio *zio, char *buffer, size_t length);
+ssize_t zio_pread(Zio *zio, off_t location, char *buffer, size_t length);
+int zio_set_read_ahead(Zio *zio, int slice_count);
+void zio_set_mmap_mode(int flag);
+const char *zio_map_range(Zio *zio, off_t location, size_t length);
+int zio_materialize(Zio *zio);
+void zio_discard_materialized(Zio *zio);
+void zio_set_materialize_budget(size_t budget);
+void zio_set_stats_timing(int flag);
+void zio_get_stats(Zio *zio, Zio_Stats *stats);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,174 @@
+/*                                                            -*- C -*-
+ * Copyright (c) 2026  The EB Library contributors
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the project nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE PROJECT AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Usage:
+ *     ziotest
+ * Description:
+ *     Check zio_map_range() with a plain file and an ebzip file,
+ *     with and without mmap mode.  It exits with 0 on success.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "zio.h"
+
+#define ZIOTEST_FILE_LENGTH	10000
+
+static int failure_count = 0;
+
+static void
+check(int condition, const char *message)
+{
+    if (!condition) {
+	fprintf(stderr, "ziotest: FAIL: %s\n", message);
+	failure_count++;
+    }
+}
+
+/*
+ * Create a temporary file with `length' bytes of `data'.
+ * The file name is stored in `file_name'.
+ */
+static int
+make_file(char *file_name, const char *data, size_t length)
+{
+    const char *directory;
+    int file;
+
+    directory = getenv("TMPDIR");
+    if (directory == NULL || *directory == '\0')
+	directory = "/tmp";
+    sprintf(file_name, "%s/ziotestXXXXXX", directory);
+    file = mkstemp(file_name);
+    if (file < 0)
+	return -1;
+    if (write(file, data, length) != (ssize_t) length) {
+	close(file);
+	unlink(file_name);
+	return -1;
+    }
+    close(file);
+    return 0;
+}
+
+int
+main(void)
+{
+    static char data[ZIOTEST_FILE_LENGTH];
+    char ebzip_data[24];
+    char plain_name[1024];
+    char ebzip_name[1024];
+    char buffer[64];
+    const char *view;
+    Zio zio;
+    int i;
+
+    if (zio_initialize_library() < 0) {
+	fprintf(stderr, "ziotest: failed to initialize zio\n");
+	exit(1);
+    }
+
+    for (i = 0; i < ZIOTEST_FILE_LENGTH; i++)
+	data[i] = (char) (i * 7 + i / 256);
+
+    /*
+     * An empty ebzip1 file: a header of 22 bytes, then an index
+     * table with a single 2-byte entry pointing to its own end.
+     */
+    memset(ebzip_data, 0, sizeof(ebzip_data));
+    memcpy(ebzip_data, "EBZip", 5);
+    ebzip_data[5] = 1 << 4;
+    ebzip_data[23] = 24;
+
+    if (make_file(plain_name, data, sizeof(data)) < 0
+	|| make_file(ebzip_name, ebzip_data, sizeof(ebzip_data)) < 0) {
+	fprintf(stderr, "ziotest: failed to create a temporary file\n");
+	exit(1);
+    }
+
+    /*
+     * Without mmap mode, no view is available.
+     */
+    zio_set_mmap_mode(0);
+    zio_initialize(&zio);
+    check(zio_open(&zio, plain_name, ZIO_PLAIN) >= 0, "open plain");
+    check(zio_map_range(&zio, 0, 16) == NULL, "view of an unmapped file");
+    check(zio_pread(&zio, 100, buffer, 16) == 16
+	&& memcmp(buffer, data + 100, 16) == 0, "pread of an unmapped file");
+    zio_close(&zio);
+
+    /*
+     * With mmap mode, a view points to the contents of a plain file.
+     */
+    zio_set_mmap_mode(1);
+    check(zio_open(&zio, plain_name, ZIO_PLAIN) >= 0, "open mapped plain");
+    view = zio_map_range(&zio, 0, ZIOTEST_FILE_LENGTH);
+#ifdef HAVE_MMAP
+    check(view != NULL && memcmp(view, data, ZIOTEST_FILE_LENGTH) == 0,
+	"view of the whole file");
+    view = zio_map_range(&zio, 4095, 64);
+    check(view != NULL && memcmp(view, data + 4095, 64) == 0,
+	"view across a page boundary");
+    check(zio_map_range(&zio, ZIOTEST_FILE_LENGTH, 0) != NULL,
+	"empty view at the end of the file");
+#else
+    check(view == NULL, "view without mmap()");
+#endif
+    check(zio_map_range(&zio, ZIOTEST_FILE_LENGTH - 10, 11) == NULL,
+	"view beyond the end of the file");
+    check(zio_map_range(&zio, ZIOTEST_FILE_LENGTH + 1, 0) == NULL,
+	"view after the end of the file");
+    check(zio_map_range(&zio, -1, 1) == NULL, "view at a negative location");
+    zio_close(&zio);
+    check(zio_map_range(&zio, 0, 1) == NULL, "view of a closed file");
+
+    /*
+     * A compressed file has no view, even if it is mapped.
+     */
+    check(zio_open(&zio, ebzip_name, ZIO_EBZIP1) >= 0, "open ebzip");
+    check(zio_map_range(&zio, 0, 0) == NULL, "view of a compressed file");
+    zio_close(&zio);
+
+    zio_finalize(&zio);
+    zio_set_mmap_mode(0);
+    zio_finalize_library();
+    unlink(plain_name);
+    unlink(ebzip_name);
+
+    if (0 < failure_count)
+	exit(1);
+    printf("ziotest: PASS\n");
+    exit(0);
+}
@@ -70,8 +70,10 @@
  */
 static void output_error_message(EB_Error_Code error_code);
 static EB_Error_Code output_booklist(const char *url);
-static EB_Error_Code output_information(const char *book_path, int multi_flag);
+static EB_Error_Code output_information(const char *book_path, int multi_flag,
+    int io_stats_flag);
 static EB_Error_Code output_multi_information(EB_Book *book);
+static EB_Error_Code output_io_stats(EB_Book *book);
 static void output_help(void);
 
 /*
@@ -84,11 +86,12 @@ static const char *invoked_name;
 /*
  * Command line options.
  */
-static const char *short_options = "hlmv";
+static const char *short_options = "hlmsv";
 static struct option long_options[] = {
   {"help",         no_argument, NULL, 'h'},
   {"book-list",    no_argument, NULL, 'l'},
   {"multi-search", no_argument, NULL, 'm'},
+  {"io-stats",     no_argument, NULL, 's'},
   {"version",      no_argument, NULL, 'v'},
   {NULL, 0, NULL, 0}
 };
@@ -106,6 +109,7 @@ main(int argc, char *argv[])
     char *book_path;
     int booklist_flag;
     int multi_flag;
+    int io_stats_flag;
 
     invoked_name = argv[0];
 
@@ -124,6 +128,7 @@ main(int argc, char *argv[])
      * Parse command line options.
      */
     multi_flag = 0;
+    io_stats_flag = 0;
     booklist_flag = 0;
 
     for (;;) {
@@ -152,6 +157,15 @@ main(int argc, char *argv[])
 	    multi_flag = 1;
 	    break;
 
+	case 's':
+	    /*
+	     * Option `-s'.  Also output I/O statistics, including time
+	     * spent in reading and uncompressing.
+	     */
+	    io_stats_flag = 1;
+	    zio_set_stats_timing(1);
+	    break;
+
 	case 'v':
 	    /*
 	     * Option `-v'.  Display version number, then exit.
@@ -185,7 +199,7 @@ main(int argc, char *argv[])
     if (booklist_flag)
 	error_code = output_booklist(book_path);
     else
-	error_code = output_information(book_path, multi_flag);
+	error_code = output_information(book_path, multi_flag, io_stats_flag);
     if (error_code != EB_SUCCESS)
 	exit(1);
 
@@ -271,9 +285,10 @@ output_booklist(const char *url)
 /*
  * Output information about the book at `path'.
  * If `multi_flag' is enabled, multi-search information are also output.
+ * If `io_stats_flag' is enabled, I/O statistics are also output.
  */
 static EB_Error_Code
-output_information(const char *book_path, int multi_flag)
+output_information(const char *book_path, int multi_flag, int io_stats_flag)
 {
     EB_Book book;
     EB_Error_Code return_code = EB_SUCCESS;
@@ -502,6 +517,12 @@ output_information(const char *book_path, int multi_flag)
 	}
 	fputc('\n', stdout);
     }
+
+    if (io_stats_flag) {
+	error_code = output_io_stats(&book);
+	if (error_code != EB_SUCCESS)
+	    return_code = error_code;
+    }
     fflush(stdout);
 
     /*
@@ -598,6 +619,51 @@ output_multi_information(EB_Book *book)
 }
 
 
+/*
+ * Output I/O statistics of files read while the information about
+ * `book' is output.
+ */
+static EB_Error_Code
+output_io_stats(EB_Book *book)
+{
+    EB_Error_Code error_code;
+    Zio_Stats stats;
+
+    error_code = eb_get_io_stats(book, &stats);
+    if (error_code != EB_SUCCESS) {
+	output_error_message(error_code);
+	return error_code;
+    }
+
+    printf(_("I/O statistics:\n"));
+    printf(_("  read: %lu bytes, %lu system calls, %lu usec\n"),
+	(unsigned long)stats.raw_read_bytes,
+	(unsigned long)stats.raw_read_count,
+	(unsigned long)(stats.raw_read_nanoseconds / 1000));
+    printf(_("  uncompressed slices: ebzip %lu, ebzip2 %lu, epwing %lu, epwing6 %lu, s-ebxa %lu\n"),
+	(unsigned long)stats.ebzip_slice_count,
+	(unsigned long)stats.ebzip2_slice_count,
+	(unsigned long)stats.epwing_slice_count,
+	(unsigned long)stats.epwing6_slice_count,
+	(unsigned long)stats.sebxa_slice_count);
+    printf(_("  uncompression time: %lu usec\n"),
+	(unsigned long)(stats.decode_nanoseconds / 1000));
+    printf(_("  slice cache: %lu hits, %lu misses\n"),
+	(unsigned long)stats.cache_hit_count,
+	(unsigned long)stats.cache_miss_count);
+    if (0 < stats.shared_cache_hit_count) {
+	printf(_("  shared slice cache: %lu hits\n"),
+	    (unsigned long)stats.shared_cache_hit_count);
+    }
+    if (0 < stats.disk_cache_hit_count) {
+	printf(_("  disk cache: %lu hits\n"),
+	    (unsigned long)stats.disk_cache_hit_count);
+    }
+
+    return EB_SUCCESS;
+}
+
+
 /*
  * Output help message to stdandard out.
  */
@@ -610,6 +676,7 @@ output_help(void)
     printf(_("  -h  --help                 display this help, then exit\n"));
     printf(_("  -l  --book-list            output a list of books on an EBENT server\n"));
     printf(_("  -m  --multi-search         also output multi-search information\n"));
+    printf(_("  -s  --io-stats             also output I/O statistics\n"));
     printf(_("  -v  --version              display version number, then exit\n"));
     printf(_("\nArgument:\n"));
     printf(_("  book-directory             top directory of a CD-ROM book\n"));
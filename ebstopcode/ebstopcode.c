@@ -520,6 +520,13 @@ scan_subbook_text(const char *book_directory, const char *subbook_name,
         goto die;
     }
 
+    /*
+     * The text is read from the beginning to the end.
+     * Uncompress following slices in background, if possible.
+     */
+    zio_set_read_ahead(&book.subbook_current->text_zio,
+	ZIO_DEFAULT_READ_AHEAD_COUNT);
+
     /*
      * Set stop-code manually.
      * (we hack `appendix' directly.)
@@ -72,6 +72,11 @@ static struct option long_options[] = {
  */
 int ebzip_level = EBZIP_DEFAULT_LEVEL;
 
+/*
+ * Compression format.  (ZIO_EBZIP1 or ZIO_EBZIP2)
+ */
+Zio_Code ebzip_zio_code = EBZIP_DEFAULT_ZIO_CODE;
+
 /*
  * Keep mode flag.
  */
@@ -124,7 +129,8 @@ static int subbook_name_count = 0;
 /*
  * Unexported functions.
  */
-static int parse_zip_level(const char *argument, int *zip_level);
+static int parse_zip_level(const char *argument, int *zip_level,
+    Zio_Code *zio_code);
 static int parse_skip_content_argument(const char *argument);
 static void output_help(void);
 
@@ -253,7 +259,7 @@ main(int argc, char *argv[])
             /*
              * Option `-l'.  Specify compression level.
              */
-	    if (parse_zip_level(optarg, &ebzip_level) < 0)
+	    if (parse_zip_level(optarg, &ebzip_level, &ebzip_zio_code) < 0)
 		exit(1);
 	    break;
 
@@ -429,17 +435,26 @@ main(int argc, char *argv[])
 
 /*
  * Parse an argument to option `--level (-l)'.
+ * The argument is a level number, optionally preceded by `z' to
+ * select the ebzip2 (zstd) compression format.
  * If the argument is valid form, 0 is returned.
  * Otherwise -1 is returned.
  */
 static int
-parse_zip_level(const char *argument, int *zip_level)
+parse_zip_level(const char *argument, int *zip_level, Zio_Code *zio_code)
 {
+    const char *argument_p = argument;
     char *end_p;
     int level;
+    Zio_Code code = ZIO_EBZIP1;
 
-    level = (int)strtol(argument, &end_p, 10);
-    if (!ASCII_ISDIGIT(*argument) || *end_p != '\0'
+    if (*argument_p == 'z' || *argument_p == 'Z') {
+	code = ZIO_EBZIP2;
+	argument_p++;
+    }
+
+    level = (int)strtol(argument_p, &end_p, 10);
+    if (!ASCII_ISDIGIT(*argument_p) || *end_p != '\0'
 	|| level < 0 || ZIO_MAX_EBZIP_LEVEL < level) {
 	fprintf(stderr, _("%s: invalid compression level `%s'\n"),
 	    invoked_name, argument);
@@ -447,7 +462,17 @@ parse_zip_level(const char *argument, int *zip_level)
 	return -1;
     }
 
+#ifndef HAVE_ZSTD
+    if (code == ZIO_EBZIP2) {
+	fprintf(stderr, _("%s: zstd compression is not supported: `%s'\n"),
+	    invoked_name, argument);
+	fflush(stderr);
+	return -1;
+    }
+#endif
+
     *zip_level = level;
+    *zio_code = code;
 
     return 0;
 }
@@ -529,6 +554,10 @@ output_help(void)
     printf(_("  -l INTEGER  --level INTEGER\n"));
     printf(_("                             compression level; 0..%d\n"),
 	ZIO_MAX_EBZIP_LEVEL);
+#ifdef HAVE_ZSTD
+    printf(_("                             (z0..z%d: zstd compression)\n"),
+	ZIO_MAX_EBZIP_LEVEL);
+#endif
     printf(_("                             (default: %d)\n"),
 	EBZIP_DEFAULT_LEVEL);
     printf(_("  -n  --no-overwrite         set overwrite mode to `no'\n"));
@@ -159,6 +159,7 @@ int strncasecmp(const char *, const char *, size_t);
  * Defaults.
  */
 #define EBZIP_DEFAULT_LEVEL		0
+#define EBZIP_DEFAULT_ZIO_CODE		ZIO_EBZIP1
 #define EBZIP_DEFAULT_KEEP		0
 #define EBZIP_DEFAULT_QUIET		0
 #define EBZIP_DEFAULT_TEST		0
@@ -193,6 +194,7 @@ extern const char *program_version;
 extern const char *invoked_name;
 
 extern int ebzip_level;
+extern Zio_Code ebzip_zio_code;
 extern int ebzip_keep_flag;
 extern int ebzip_quiet_flag;
 extern int ebzip_test_flag;
@@ -217,6 +219,14 @@ int ebzip_copy_files_in_directory(const char *out_directory_name,
 int ebzip1_slice(char *out_buffer, size_t *out_byte_length, char *in_buffer,
     size_t in_byte_length);
 
+/* ebzip2.c */
+int ebzip2_train_dictionary(char *dictionary, size_t *dictionary_length,
+    Zio *zio);
+int ebzip2_start(const char *dictionary, size_t dictionary_length);
+void ebzip2_end(void);
+int ebzip2_slice(char *out_buffer, size_t *out_byte_length, char *in_buffer,
+    size_t in_byte_length);
+
 /* sebxa.c */
 int rewrite_sebxa_start(const char *file_name, int index_page);
 int get_sebxa_indexes(const char *file_name, int index_page,
@@ -0,0 +1,250 @@
+/*                                                            -*- C -*-
+ * Copyright (c) 2026  The EB Library contributors
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the project nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE PROJECT AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/types.h>
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#include <zdict.h>
+#endif
+
+#include "eb/eb.h"
+
+/*
+ * Maximum length of a dictionary trained by ebzip2_train_dictionary().
+ * It must not exceed ZIO_MAX_EBZIP2_DICTIONARY_LENGTH.
+ */
+#define EBZIP2_DICTIONARY_LENGTH	(64 * 1024)
+
+/*
+ * Maximum total length of samples to train a dictionary.
+ */
+#define EBZIP2_SAMPLE_LENGTH		(8 * 1024 * 1024)
+
+/*
+ * Length of a sample.
+ */
+#define EBZIP2_SAMPLE_UNIT		2048
+
+/*
+ * zstd compression level.
+ */
+#define EBZIP2_ZSTD_LEVEL		19
+
+#ifdef HAVE_ZSTD
+/*
+ * Compression context and dictionary used by ebzip2_slice().
+ */
+static ZSTD_CCtx *compression_context = NULL;
+static ZSTD_CDict *compression_dictionary = NULL;
+#endif
+
+/*
+ * Train a dictionary from the contents of `zio', and put it into
+ * `dictionary'.  The buffer `dictionary' must have
+ * ZIO_MAX_EBZIP2_DICTIONARY_LENGTH bytes.  The length of the dictionary
+ * is put into `dictionary_length'.  It is 0 if the file is too small to
+ * train a dictionary worth storing.
+ *
+ * If it succeeds, 0 is returned.  Otherwise, -1 is returned.
+ */
+int
+ebzip2_train_dictionary(char *dictionary, size_t *dictionary_length,
+    Zio *zio)
+{
+#ifdef HAVE_ZSTD
+    char *samples = NULL;
+    size_t *sample_lengths = NULL;
+    size_t capacity;
+    size_t result;
+    off_t unit_count;
+    ssize_t n;
+    int sample_count;
+    int i;
+
+    *dictionary_length = 0;
+
+    /*
+     * A dictionary pays only when it is much smaller than the file.
+     */
+    capacity = zio->file_size / 16;
+    if (EBZIP2_DICTIONARY_LENGTH < capacity)
+	capacity = EBZIP2_DICTIONARY_LENGTH;
+    if (capacity < 1024)
+	return 0;
+
+    /*
+     * Take samples evenly from the whole file.
+     */
+    unit_count = zio->file_size / EBZIP2_SAMPLE_UNIT;
+    if (EBZIP2_SAMPLE_LENGTH / EBZIP2_SAMPLE_UNIT < unit_count)
+	sample_count = EBZIP2_SAMPLE_LENGTH / EBZIP2_SAMPLE_UNIT;
+    else
+	sample_count = unit_count;
+
+    samples = (char *) malloc(sample_count * EBZIP2_SAMPLE_UNIT);
+    sample_lengths = (size_t *) malloc(sample_count * sizeof(size_t));
+    if (samples == NULL || sample_lengths == NULL)
+	goto failed;
+
+    for (i = 0; i < sample_count; i++) {
+	n = zio_pread(zio, (unit_count * i / sample_count)
+	    * EBZIP2_SAMPLE_UNIT, samples + i * EBZIP2_SAMPLE_UNIT,
+	    EBZIP2_SAMPLE_UNIT);
+	if (n != EBZIP2_SAMPLE_UNIT)
+	    goto failed;
+	sample_lengths[i] = EBZIP2_SAMPLE_UNIT;
+    }
+
+    /*
+     * Train a dictionary.  If samples are too few or too uniform to
+     * train, the file is compressed without a dictionary.
+     */
+    result = ZDICT_trainFromBuffer(dictionary, capacity, samples,
+	sample_lengths, sample_count);
+    if (!ZDICT_isError(result))
+	*dictionary_length = result;
+
+    free(samples);
+    free(sample_lengths);
+    return 0;
+
+    /*
+     * An error occurs...
+     */
+  failed:
+    if (samples != NULL)
+	free(samples);
+    if (sample_lengths != NULL)
+	free(sample_lengths);
+#else
+    (void) dictionary;
+    (void) dictionary_length;
+    (void) zio;
+#endif
+    return -1;
+}
+
+/*
+ * Release the context and dictionary allocated by ebzip2_start().
+ */
+void
+ebzip2_end(void)
+{
+#ifdef HAVE_ZSTD
+    if (compression_context != NULL)
+	ZSTD_freeCCtx(compression_context);
+    if (compression_dictionary != NULL)
+	ZSTD_freeCDict(compression_dictionary);
+    compression_context = NULL;
+    compression_dictionary = NULL;
+#endif
+}
+
+/*
+ * Prepare to compress slices with the dictionary `dictionary' of
+ * `dictionary_length' bytes.  If `dictionary_length' is 0, slices
+ * are compressed without a dictionary.
+ *
+ * If it succeeds, 0 is returned.  Otherwise, -1 is returned.
+ */
+int
+ebzip2_start(const char *dictionary, size_t dictionary_length)
+{
+#ifdef HAVE_ZSTD
+    ebzip2_end();
+
+    compression_context = ZSTD_createCCtx();
+    if (compression_context == NULL)
+	goto failed;
+    if (0 < dictionary_length) {
+	compression_dictionary = ZSTD_createCDict(dictionary,
+	    dictionary_length, EBZIP2_ZSTD_LEVEL);
+	if (compression_dictionary == NULL)
+	    goto failed;
+    }
+
+    return 0;
+
+    /*
+     * An error occurs...
+     */
+  failed:
+    ebzip2_end();
+#else
+    (void) dictionary;
+    (void) dictionary_length;
+#endif
+    return -1;
+}
+
+/*
+ * Compress a slice with the ebzip2 compression format.
+ * If the compressed slice is not shorter than the original,
+ * `in_byte_length' is put into `out_byte_length'.
+ *
+ * If it succeeds, 0 is returned.  Otherwise, -1 is returned.
+ */
+int
+ebzip2_slice(char *out_buffer, size_t *out_byte_length, char *in_buffer,
+    size_t in_byte_length)
+{
+#ifdef HAVE_ZSTD
+    size_t result;
+
+    if (compression_context == NULL)
+	return -1;
+
+    if (compression_dictionary != NULL) {
+	result = ZSTD_compress_usingCDict(compression_context, out_buffer,
+	    in_byte_length, in_buffer, in_byte_length,
+	    compression_dictionary);
+    } else {
+	result = ZSTD_compressCCtx(compression_context, out_buffer,
+	    in_byte_length, in_buffer, in_byte_length, EBZIP2_ZSTD_LEVEL);
+    }
+
+    if (ZSTD_isError(result))
+	*out_byte_length = in_byte_length;
+    else
+	*out_byte_length = result;
+    return 0;
+#else
+    (void) out_buffer;
+    (void) out_byte_length;
+    (void) in_buffer;
+    (void) in_byte_length;
+    return -1;
+#endif
+}
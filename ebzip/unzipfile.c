@@ -205,6 +205,12 @@ ebzip_unzip_file_internal(const char *out_file_name, const char *in_file_name,
 	    zio_start_location, zio_end_location);
     }
 
+    /*
+     * The file is read from the beginning to the end.
+     * Uncompress following slices in background, if possible.
+     */
+    zio_set_read_ahead(&in_zio, ZIO_DEFAULT_READ_AHEAD_COUNT);
+
     if (!ebzip_test_flag) {
 	trap_file_name = out_file_name;
 #ifdef SIGHUP
@@ -271,7 +277,7 @@ ebzip_unzip_file_internal(const char *out_file_name, const char *in_file_name,
 	/*
 	 * Update CRC.  (Calculate adler32 again.)
 	 */
-	if (in_zio.code == ZIO_EBZIP1)
+	if (in_zio.code == ZIO_EBZIP1 || in_zio.code == ZIO_EBZIP2)
 	    crc = adler32((uLong)crc, (Bytef *)buffer, (uInt)length);
 
 	/*
@@ -356,7 +362,8 @@ ebzip_unzip_file_internal(const char *out_file_name, const char *in_file_name,
     /*
      * Check for CRC.
      */
-    if (in_zio.code == ZIO_EBZIP1 && in_zio.crc != crc) {
+    if ((in_zio.code == ZIO_EBZIP1 || in_zio.code == ZIO_EBZIP2)
+	&& in_zio.crc != crc) {
 	fprintf(stderr, _("%s: CRC error: %s\n"), invoked_name, out_file_name);
 	goto failed;
     }
@@ -83,6 +83,8 @@ ebzip_zip_file_internal(const char *out_file_name, const char *in_file_name,
 {
     Zio in_zio, out_zio;
     unsigned char *in_buffer = NULL, *out_buffer = NULL;
+    char *dictionary = NULL;
+    size_t dictionary_length = 0;
     off_t in_total_length, out_total_length;
     ssize_t in_length;
     size_t out_length;
@@ -225,7 +227,7 @@ ebzip_zip_file_internal(const char *out_file_name, const char *in_file_name,
     /*
      * Initialize `zip'.
      */
-    out_zio.code = ZIO_EBZIP1;
+    out_zio.code = ebzip_zio_code;
     out_zio.slice_size = EB_SIZE_PAGE << ebzip_level;
     out_zio.file_size = in_zio.file_size;
     out_zio.crc = 1;
@@ -266,6 +268,29 @@ ebzip_zip_file_internal(const char *out_file_name, const char *in_file_name,
     total_slices = (out_zio.file_size + out_zio.slice_size - 1)
 	/ out_zio.slice_size;
     index_length = (total_slices + 1) * out_zio.index_width;
+
+    /*
+     * The ebzip2 format has a dictionary trained from the original
+     * file, between the index and the first compressed slice.
+     */
+    if (out_zio.code == ZIO_EBZIP2) {
+	dictionary = (char *) malloc(ZIO_MAX_EBZIP2_DICTIONARY_LENGTH);
+	if (dictionary == NULL) {
+	    fprintf(stderr, _("%s: memory exhausted\n"), invoked_name);
+	    goto failed;
+	}
+	if (ebzip2_train_dictionary(dictionary, &dictionary_length, &in_zio)
+	    < 0) {
+	    fprintf(stderr, _("%s: failed to read from the file: %s\n"),
+		invoked_name, in_file_name);
+	    goto failed;
+	}
+	if (ebzip2_start(dictionary, dictionary_length) < 0) {
+	    fprintf(stderr, _("%s: memory exhausted\n"), invoked_name);
+	    goto failed;
+	}
+    }
+
     memset(out_buffer, '\0', out_zio.slice_size);
 
     if (!ebzip_test_flag) {
@@ -285,6 +310,14 @@ ebzip_zip_file_internal(const char *out_file_name, const char *in_file_name,
 		goto failed;
 	    }
 	}
+	if (0 < dictionary_length) {
+	    if (write(out_zio.file, dictionary, dictionary_length)
+		!= dictionary_length) {
+		fprintf(stderr, _("%s: failed to write to the file: %s\n"),
+		    invoked_name, out_file_name);
+		goto failed;
+	    }
+	}
     }
 
     /*
@@ -292,7 +325,7 @@ ebzip_zip_file_internal(const char *out_file_name, const char *in_file_name,
      * write it to the output file.
      */
     in_total_length = 0;
-    out_total_length = 0;
+    out_total_length = dictionary_length;
     progress_interval = EBZIP_PROGRESS_INTERVAL_FACTOR >> ebzip_level;
     if (((total_slices + 999) / 1000) > progress_interval)
 	progress_interval = ((total_slices + 999) / 1000);
@@ -344,6 +377,12 @@ ebzip_zip_file_internal(const char *out_file_name, const char *in_file_name,
 	if (speedup != NULL
 	    && ebzip_is_speedup_slice(speedup, i, ebzip_level)) {
 	    out_length = out_zio.slice_size;
+	} else if (out_zio.code == ZIO_EBZIP2) {
+	    if (ebzip2_slice((char *)out_buffer, &out_length,
+		(char *)in_buffer, out_zio.slice_size) < 0) {
+		fprintf(stderr, _("%s: memory exhausted\n"), invoked_name);
+		goto failed;
+	    }
 	} else if (ebzip1_slice((char *)out_buffer, &out_length,
 	    (char *)in_buffer, out_zio.slice_size) < 0) {
 	    fprintf(stderr, _("%s: memory exhausted\n"), invoked_name);
@@ -468,6 +507,10 @@ ebzip_zip_file_internal(const char *out_file_name, const char *in_file_name,
      *     file_size		4   bytes  (10 ... 13)
      *     crc			4   bytes  (14 ... 17)
      *     mtime		4   bytes  (18 ... 21)
+     *
+     * The zip-mode is 1 (or 2 for a file larger than 4GB) for the
+     * ebzip format, and 3 (or 4) for the ebzip2 format.  In the ebzip2
+     * format, the first 3 reserved bytes are the dictionary length.
      */
     memcpy(out_buffer, "EBZip", 5);
 
@@ -475,9 +518,11 @@ ebzip_zip_file_internal(const char *out_file_name, const char *in_file_name,
 	out_buffer[5] = (1 << 4) + (ebzip_level & 0x0f);
     else
 	out_buffer[5] = (2 << 4) + (ebzip_level & 0x0f);
-    out_buffer[ 6] = 0;
-    out_buffer[ 7] = 0;
-    out_buffer[ 8] = 0;
+    if (out_zio.code == ZIO_EBZIP2)
+	out_buffer[5] += 2 << 4;
+    out_buffer[ 6] = (dictionary_length >> 16) & 0xff;
+    out_buffer[ 7] = (dictionary_length >> 8) & 0xff;
+    out_buffer[ 8] = dictionary_length & 0xff;
     out_buffer[ 9] = (out_zio.file_size >> 32) & 0xff;
     out_buffer[10] = (out_zio.file_size >> 24) & 0xff;
     out_buffer[11] = (out_zio.file_size >> 16) & 0xff;
@@ -605,6 +650,9 @@ ebzip_zip_file_internal(const char *out_file_name, const char *in_file_name,
      */
     free(in_buffer);
     free(out_buffer);
+    if (dictionary != NULL)
+	free(dictionary);
+    ebzip2_end();
 
     return 0;
 
@@ -616,6 +664,9 @@ ebzip_zip_file_internal(const char *out_file_name, const char *in_file_name,
 	free(in_buffer);
     if (out_buffer != NULL)
 	free(out_buffer);
+    if (dictionary != NULL)
+	free(dictionary);
+    ebzip2_end();
 
     zio_close(&in_zio);
     zio_finalize(&in_zio);
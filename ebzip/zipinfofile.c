@@ -160,6 +160,8 @@ ebzip_zipinfo_file_internal(const char *in_file_name, Zio_Code in_zio_code,
 	}
 	if (in_zio.code == ZIO_EBZIP1)
 	    printf(_("ebzip level %d compression)\n"), in_zio.zip_level);
+	else if (in_zio.code == ZIO_EBZIP2)
+	    printf(_("ebzip2 level %d compression)\n"), in_zio.zip_level);
 	else if (in_zio.code == ZIO_SEBXA)
 	    printf(_("S-EBXA compression)\n"));
 	else